@@ -0,0 +1,130 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#if ! defined HEADLESS_HPP_
+#define HEADLESS_HPP_
+
+
+#include <string>
+#include <cstdio>
+#include "inkview.h"
+
+
+/******************************************
+ * Extra functions of the headless libinkview backend, for tools that
+ * want to look at what pbterm did (they don't exist on a real device)
+ ******************************************/
+
+namespace Headless
+{
+
+// Counters for calls into the backend
+
+struct Stats
+{
+    unsigned long draw_string;
+    unsigned long string_width;
+    unsigned long char_width;
+    unsigned long fill_area;
+    unsigned long clear_screen;
+    unsigned long full_updates;
+    unsigned long soft_updates;
+    unsigned long partial_updates;
+    unsigned long dynamic_updates;
+    unsigned long long updated_pixels;
+    unsigned long events;
+    unsigned long timers;
+};
+
+
+// Sets up the backend and sends the EVT_INIT event to the handler
+
+void
+start( iv_handler handler );
+
+
+// Delivers the next event that's due or waits for it (but not longer
+// than 'max_wait' ms if that's not negative), returns false once the
+// application is to be closed
+
+bool
+process( int max_wait );
+
+
+// Returns if there's something process() can deliver without waiting
+
+bool
+has_due_events( );
+
+
+// Sends the EVT_EXIT event
+
+void
+finish( );
+
+
+// Makes DrawString() look out for a text (an empty string stops it)
+
+void
+watch_text( std::string const & text );
+
+
+// Returns if the text looked out for has been drawn
+
+bool
+watched_text_drawn( );
+
+
+// Returns the counters
+
+Stats const &
+stats( );
+
+
+// Sets all counters back to 0
+
+void
+reset_stats( );
+
+
+// Writes the counters in a single line to a stream
+
+void
+print_stats( std::FILE * fp );
+
+
+// Writes the content of the framebuffer to a file in PGM format,
+// returns false on failure
+
+bool
+dump_screen( std::string const & file_name );
+
+}
+
+
+#endif
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,1215 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/******************************************
+ * Headless implementation of the part of libinkview used by pbterm. It
+ * draws into an in-memory framebuffer, uses a font with fixed, easily
+ * predictable metrics (every character is 3/5 of the font size wide)
+ * and runs an event loop that gets its events from a script instead of
+ * a touch screen. This allows to build, run and profile the complete
+ * program on any Linux box. The following environment variables are
+ * used:
+ *
+ *  PBTERM_HEADLESS_SCRIPT  name of the script file (see below)
+ *  PBTERM_HEADLESS_SCREEN  screen size as "<width>x<height>" (default
+ *                          is 600x800)
+ *  PBTERM_HEADLESS_CLOCK   if set to "virtual" time doesn't really pass
+ *                          while waiting, but jumps to the next timer
+ *  PBTERM_HEADLESS_STATS   if set the counters of calls into the backend
+ *                          are printed to stderr on exit
+ *
+ * Lines of the script (empty lines and lines starting with '#' are
+ * ignored) are one of
+ *
+ *  wait <ms>                  do nothing for that time
+ *  tap <x> <y>                touch the screen for a moment
+ *  long <x> <y>               touch the screen for a long time
+ *  swipe <x1> <y1> <x2> <y2> [<steps> [<ms>]]
+ *                             move a finger over the screen
+ *  key <code>                 press and release a key
+ *  type <text>                enter text into the open keyboard
+ *  menu <index or text>       select a menu item
+ *  rotate <direction>         select an orientation in the rotate box
+ *  cancel                     close keyboard, menu or rotate box
+ *  dump <file>                write the screen to a PGM file
+ *  stats                      print counters to stderr
+ *  quit                       close the application
+ ******************************************/
+
+
+#include "inkview.h"
+#include "Headless.hpp"
+#include <string>
+#include <vector>
+#include <deque>
+#include <list>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <sys/time.h>
+
+
+namespace
+{
+
+// A timer waiting to expire
+
+struct Timer
+{
+    std::string name;
+    iv_timerproc proc;
+    unsigned long long due;
+};
+
+
+// An event waiting to be delivered (due time in ms)
+
+struct Event
+{
+    int type,
+        par1,
+        par2;
+    unsigned long long due;
+};
+
+
+// Handler function passed to InkViewMain()
+
+iv_handler s_handler;
+
+
+// Flags, set when the application is to be closed or redrawn
+
+bool s_quit;
+bool s_show_pending;
+
+
+// Screen size in the default orientation and current orientation
+
+int s_base_width  = 600;
+int s_base_height = 800;
+int s_orientation = ROTATE0;
+
+
+// The framebuffer (one byte per pixel)
+
+std::vector< unsigned char > s_fb;
+
+
+// Current font and the color to draw text with
+
+ifont * s_font;
+unsigned char s_text_color;
+
+
+// Timers and events
+
+std::list< Timer > s_timers;
+std::deque< Event > s_events;
+
+
+// Clock, either real time or a virtual one that jumps forward when
+// waiting
+
+bool s_virtual_clock;
+unsigned long long s_virtual_now;
+
+
+// Lines of the script, the next to be executed and when
+
+std::vector< std::string > s_script;
+std::size_t s_script_pos;
+unsigned long long s_script_due;
+
+
+// State of keyboard, menu and rotate box while open
+
+char * s_kbd_buffer;
+int s_kbd_maxlen;
+iv_keyboardhandler s_kbd_handler;
+
+imenu * s_menu;
+iv_menuhandler s_menu_handler;
+
+iv_rotatehandler s_rotate_handler;
+
+
+// Counters of calls
+
+Headless::Stats s_stats;
+
+
+// Text DrawString() is to look out for and flag, set when it was drawn
+
+std::string s_watched_text;
+bool s_watched_text_drawn;
+
+
+/******************************************
+ * Returns the current time in ms
+ ******************************************/
+
+unsigned long long
+now( )
+{
+    if ( s_virtual_clock )
+        return s_virtual_now;
+
+    struct timeval tv;
+    gettimeofday( &tv, 0 );
+    return tv.tv_sec * 1000ULL + tv.tv_usec / 1000;
+}
+
+
+/******************************************
+ * Waits until the given time
+ ******************************************/
+
+void
+wait_until( unsigned long long t )
+{
+    if ( s_virtual_clock )
+    {
+        s_virtual_now = std::max( s_virtual_now, t );
+        return;
+    }
+
+    unsigned long long n = now( );
+    if ( t > n )
+        usleep( ( t - n ) * 1000 );
+}
+
+
+/******************************************
+ * Converts a color to a gray value
+ ******************************************/
+
+unsigned char
+gray( int color )
+{
+    return (   ( ( color >> 16 ) & 0xff )
+             + ( ( color >>  8 ) & 0xff )
+             + (   color         & 0xff ) ) / 3;
+}
+
+
+/******************************************
+ * Fills a rectangle (clipped to the screen) with a gray value
+ ******************************************/
+
+void
+fill( int           x,
+      int           y,
+      int           w,
+      int           h,
+      unsigned char g )
+{
+    int sw = ScreenWidth( ),
+        sh = ScreenHeight( );
+
+    int x1 = std::max( x, 0 ),
+        y1 = std::max( y, 0 ),
+        x2 = std::min( x + w, sw ),
+        y2 = std::min( y + h, sh );
+
+    if ( x1 >= x2 )
+        return;
+
+    for ( int j = y1; j < y2; ++j )
+        std::fill( s_fb.begin( ) + j * sw + x1, s_fb.begin( ) + j * sw + x2,
+                   g );
+}
+
+
+/******************************************
+ * Width of a character in the current font
+ ******************************************/
+
+int
+advance( )
+{
+    return s_font ? std::max( ( s_font->size * 3 + 2 ) / 5, 1 ) : 1;
+}
+
+
+/******************************************
+ * Counts the characters in an UTF-8 string
+ ******************************************/
+
+int
+char_count( char const * s )
+{
+    int cnt = 0;
+
+    for ( ; *s; ++s )
+        if ( ( *s & 0xc0 ) != 0x80 )
+            cnt++;
+
+    return cnt;
+}
+
+
+/******************************************
+ * Appends an event to the queue
+ ******************************************/
+
+void
+queue_event( int                type,
+             int                par1,
+             int                par2,
+             unsigned long long due )
+{
+    Event e = { type, par1, par2, due };
+    s_events.push_back( e );
+}
+
+
+/******************************************
+ * Removes a timer with the given name or function
+ ******************************************/
+
+void
+remove_timer( char const * name,
+              iv_timerproc proc )
+{
+    for ( std::list< Timer >::iterator it = s_timers.begin( );
+          it != s_timers.end( ); )
+        if ( it->proc == proc || ( name && it->name == name ) )
+            it = s_timers.erase( it );
+        else
+            ++it;
+}
+
+
+/******************************************
+ * Starts a timer
+ ******************************************/
+
+void
+set_timer( char const * name,
+           iv_timerproc proc,
+           int          ms )
+{
+    remove_timer( name, proc );
+
+    Timer t = { name ? name : "", proc, now( ) + std::max( ms, 0 ) };
+    s_timers.push_back( t );
+}
+
+
+/******************************************
+ * Runs the timer that's expired first (if any), returns if there was one
+ ******************************************/
+
+bool
+run_timer( unsigned long long t )
+{
+    std::list< Timer >::iterator first = s_timers.end( );
+
+    for ( std::list< Timer >::iterator it = s_timers.begin( );
+          it != s_timers.end( ); ++it )
+        if (    it->due <= t
+             && ( first == s_timers.end( ) || it->due < first->due ) )
+            first = it;
+
+    if ( first == s_timers.end( ) )
+        return false;
+
+    iv_timerproc proc = first->proc;
+    s_timers.erase( first );
+    s_stats.timers++;
+    proc( );
+
+    return true;
+}
+
+
+/******************************************
+ * Searches a menu (and its submenus) for an item with the given text
+ ******************************************/
+
+imenu const *
+find_menu_item( imenu const       * menu,
+                std::string const & text )
+{
+    for ( ; menu && menu->type; ++menu )
+    {
+        if ( menu->text && text == menu->text && menu->type != ITEM_SUBMENU )
+            return menu;
+
+        if ( menu->type == ITEM_SUBMENU )
+        {
+            imenu const * item = find_menu_item( menu->submenu, text );
+            if ( item )
+                return item;
+        }
+    }
+
+    return 0;
+}
+
+
+/******************************************
+ * Executes the next line of the script
+ ******************************************/
+
+void
+run_script_line( )
+{
+    std::string line = s_script[ s_script_pos++ ];
+    std::istringstream is( line );
+    std::string cmd;
+    unsigned long long t = now( );
+
+    is >> cmd;
+
+    if ( cmd.empty( ) || cmd[ 0 ] == '#' )
+        return;
+
+    std::string rest;
+    std::getline( is >> std::ws, rest );
+
+    if ( cmd == "wait" )
+        s_script_due = t + std::strtoul( rest.c_str( ), 0, 10 );
+    else if ( cmd == "tap" || cmd == "long" )
+    {
+        int x = 0,
+            y = 0;
+        std::istringstream( rest ) >> x >> y;
+
+        queue_event( EVT_POINTERDOWN, x, y, t );
+        if ( cmd == "long" )
+            queue_event( EVT_POINTERLONG, x, y, t + 1000 );
+        queue_event( EVT_POINTERUP, x, y, t + ( cmd == "long" ? 1500 : 100 ) );
+    }
+    else if ( cmd == "swipe" )
+    {
+        int x1 = 0, y1 = 0, x2 = 0, y2 = 0,
+            steps = 10,
+            ms = 500;
+        std::istringstream( rest ) >> x1 >> y1 >> x2 >> y2 >> steps >> ms;
+        steps = std::max( steps, 1 );
+
+        queue_event( EVT_POINTERDOWN, x1, y1, t );
+        for ( int i = 1; i <= steps; ++i )
+            queue_event( EVT_POINTERMOVE,
+                         x1 + ( x2 - x1 ) * i / steps,
+                         y1 + ( y2 - y1 ) * i / steps,
+                         t + static_cast< unsigned long long >( ms ) * i
+                             / steps );
+        queue_event( EVT_POINTERUP, x2, y2, t + ms );
+    }
+    else if ( cmd == "key" )
+    {
+        int code = std::strtol( rest.c_str( ), 0, 0 );
+        queue_event( EVT_KEYPRESS, code, 0, t );
+        queue_event( EVT_KEYRELEASE, code, 0, t + 100 );
+    }
+    else if ( cmd == "type" )
+    {
+        if ( ! s_kbd_handler )
+        {
+            std::fprintf( stderr, "headless: no keyboard open for '%s'\n",
+                          line.c_str( ) );
+            return;
+        }
+
+        iv_keyboardhandler h = s_kbd_handler;
+        s_kbd_handler = 0;
+        std::strncpy( s_kbd_buffer, rest.c_str( ), s_kbd_maxlen );
+        s_kbd_buffer[ s_kbd_maxlen ] = '\0';
+        h( s_kbd_buffer );
+    }
+    else if ( cmd == "menu" )
+    {
+        if ( ! s_menu_handler )
+        {
+            std::fprintf( stderr, "headless: no menu open for '%s'\n",
+                          line.c_str( ) );
+            return;
+        }
+
+        char * end;
+        int index = std::strtol( rest.c_str( ), &end, 10 );
+
+        if ( *end != '\0' || rest.empty( ) )
+        {
+            imenu const * item = find_menu_item( s_menu, rest );
+            if ( ! item )
+            {
+                std::fprintf( stderr, "headless: no menu item '%s'\n",
+                              rest.c_str( ) );
+                return;
+            }
+            index = item->index;
+        }
+
+        iv_menuhandler h = s_menu_handler;
+        s_menu_handler = 0;
+        s_menu = 0;
+        h( index );
+    }
+    else if ( cmd == "rotate" )
+    {
+        if ( ! s_rotate_handler )
+        {
+            std::fprintf( stderr, "headless: no rotate box open for '%s'\n",
+                          line.c_str( ) );
+            return;
+        }
+
+        iv_rotatehandler h = s_rotate_handler;
+        s_rotate_handler = 0;
+        h( std::strtol( rest.c_str( ), 0, 10 ) );
+    }
+    else if ( cmd == "cancel" )
+    {
+        if ( s_kbd_handler )
+        {
+            iv_keyboardhandler h = s_kbd_handler;
+            s_kbd_handler = 0;
+            h( 0 );
+        }
+
+        if ( s_menu_handler )
+        {
+            iv_menuhandler h = s_menu_handler;
+            s_menu_handler = 0;
+            s_menu = 0;
+            h( -1 );
+        }
+
+        if ( s_rotate_handler )
+        {
+            iv_rotatehandler h = s_rotate_handler;
+            s_rotate_handler = 0;
+            h( -1 );
+        }
+    }
+    else if ( cmd == "dump" )
+    {
+        if ( ! Headless::dump_screen( rest ) )
+            std::fprintf( stderr, "headless: can't write '%s'\n",
+                          rest.c_str( ) );
+    }
+    else if ( cmd == "stats" )
+        Headless::print_stats( stderr );
+    else if ( cmd == "quit" )
+        CloseApp( );
+    else
+        std::fprintf( stderr, "headless: invalid script line '%s'\n",
+                      line.c_str( ) );
+}
+
+
+/******************************************
+ * Reads in the script file (if there's one)
+ ******************************************/
+
+void
+load_script( )
+{
+    char const * name = std::getenv( "PBTERM_HEADLESS_SCRIPT" );
+    if ( ! name )
+        return;
+
+    std::ifstream f( name );
+    if ( ! f )
+    {
+        std::fprintf( stderr, "headless: can't open script '%s'\n", name );
+        return;
+    }
+
+    std::string line;
+    while ( std::getline( f, line ) )
+        s_script.push_back( line );
+}
+
+
+/******************************************
+ * Evaluates the environment variables for screen size and clock
+ ******************************************/
+
+void
+setup( )
+{
+    char const * screen = std::getenv( "PBTERM_HEADLESS_SCREEN" );
+    int w,
+        h;
+
+    if ( screen && std::sscanf( screen, "%dx%d", &w, &h ) == 2
+         && w > 0 && h > 0 )
+    {
+        s_base_width  = w;
+        s_base_height = h;
+    }
+
+    char const * clock = std::getenv( "PBTERM_HEADLESS_CLOCK" );
+    s_virtual_clock = clock && ! std::strcmp( clock, "virtual" );
+
+    s_fb.assign( s_base_width * s_base_height, 0xff );
+}
+
+}   // unnamed namespace
+
+
+namespace Headless
+{
+
+/******************************************
+ ******************************************/
+
+Stats const &
+stats( )
+{
+    return s_stats;
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+reset_stats( )
+{
+    std::memset( &s_stats, 0, sizeof s_stats );
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+print_stats( std::FILE * fp )
+{
+    std::fprintf( fp, "draw_string=%lu string_width=%lu char_width=%lu "
+                  "fill_area=%lu clear_screen=%lu full_updates=%lu "
+                  "soft_updates=%lu partial_updates=%lu dynamic_updates=%lu "
+                  "updated_pixels=%llu events=%lu timers=%lu\n",
+                  s_stats.draw_string, s_stats.string_width,
+                  s_stats.char_width, s_stats.fill_area,
+                  s_stats.clear_screen, s_stats.full_updates,
+                  s_stats.soft_updates, s_stats.partial_updates,
+                  s_stats.dynamic_updates, s_stats.updated_pixels,
+                  s_stats.events, s_stats.timers );
+}
+
+
+/******************************************
+ ******************************************/
+
+bool
+dump_screen( std::string const & file_name )
+{
+    std::FILE * fp = std::fopen( file_name.c_str( ), "wb" );
+    if ( ! fp )
+        return false;
+
+    std::fprintf( fp, "P5\n%d %d\n255\n", ScreenWidth( ), ScreenHeight( ) );
+    bool ok = std::fwrite( &s_fb[ 0 ], 1, s_fb.size( ), fp ) == s_fb.size( );
+
+    return std::fclose( fp ) == 0 && ok;
+}
+
+/******************************************
+ * Sets up the backend and sends the EVT_INIT event
+ ******************************************/
+
+void
+start( iv_handler handler )
+{
+    setup( );
+    load_script( );
+
+    s_handler = handler;
+    s_quit = false;
+    s_script_due = now( );
+    s_handler( EVT_INIT, 0, 0 );
+    s_show_pending = true;
+}
+
+
+/******************************************
+ * Delivers the next event (an EVT_SHOW, a queued event, an expired timer
+ * or the next line of the script) if one is due. Otherwise waits for the
+ * next one, but not longer than 'max_wait' ms (unless it's negative).
+ * Returns false when the application asked to be closed or, when not
+ * restricted in how long to wait, nothing is left that could happen.
+ ******************************************/
+
+bool
+process( int max_wait )
+{
+    if ( s_quit )
+        return false;
+
+    unsigned long long t = now( );
+
+    if ( s_show_pending )
+    {
+        s_show_pending = false;
+        s_stats.events++;
+        s_handler( EVT_SHOW, 0, 0 );
+        return true;
+    }
+
+    if ( ! s_events.empty( ) && s_events.front( ).due <= t )
+    {
+        Event e = s_events.front( );
+        s_events.pop_front( );
+        s_stats.events++;
+        s_handler( e.type, e.par1, e.par2 );
+        return true;
+    }
+
+    if ( run_timer( t ) )
+        return true;
+
+    bool script_pending = s_script_pos < s_script.size( );
+
+    if ( script_pending && s_events.empty( ) && s_script_due <= t )
+    {
+        run_script_line( );
+        return true;
+    }
+
+    // Nothing to do right now, wait for whatever comes next
+
+    unsigned long long next = 0;
+    bool has_next = false;
+
+    if ( ! s_events.empty( ) )
+    {
+        next = s_events.front( ).due;
+        has_next = true;
+    }
+    else if ( script_pending )
+    {
+        next = s_script_due;
+        has_next = true;
+    }
+
+    for ( std::list< Timer >::const_iterator it = s_timers.begin( );
+          it != s_timers.end( ); ++it )
+        if ( ! has_next || it->due < next )
+        {
+            next = it->due;
+            has_next = true;
+        }
+
+    if ( max_wait >= 0 && ( ! has_next || next > t + max_wait ) )
+    {
+        next = t + max_wait;
+        has_next = true;
+    }
+
+    if ( ! has_next )
+        return false;
+
+    wait_until( next );
+    return true;
+}
+
+
+/******************************************
+ ******************************************/
+
+bool
+has_due_events( )
+{
+    unsigned long long t = now( );
+
+    if (    s_show_pending
+         || ( ! s_events.empty( ) && s_events.front( ).due <= t ) )
+        return true;
+
+    for ( std::list< Timer >::const_iterator it = s_timers.begin( );
+          it != s_timers.end( ); ++it )
+        if ( it->due <= t )
+            return true;
+
+    return    s_script_pos < s_script.size( )
+           && s_events.empty( )
+           && s_script_due <= t;
+}
+
+
+/******************************************
+ * Sends the EVT_EXIT event
+ ******************************************/
+
+void
+finish( )
+{
+    s_handler( EVT_EXIT, 0, 0 );
+
+    if ( std::getenv( "PBTERM_HEADLESS_STATS" ) )
+        print_stats( stderr );
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+watch_text( std::string const & text )
+{
+    s_watched_text = text;
+    s_watched_text_drawn = false;
+}
+
+
+/******************************************
+ ******************************************/
+
+bool
+watched_text_drawn( )
+{
+    return s_watched_text_drawn;
+}
+
+
+}   // namespace Headless
+
+
+/******************************************
+ * The event loop: after the EVT_INIT event the application gets events
+ * from the script, timer expirations and EVT_SHOW events (after calls of
+ * Repaint()) until it calls CloseApp() or there's nothing left that could
+ * happen.
+ ******************************************/
+
+void
+InkViewMain( iv_handler handler )
+{
+    Headless::start( handler );
+
+    while ( Headless::process( -1 ) )
+        /* empty */ ;
+
+    Headless::finish( );
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+CloseApp( void )
+{
+    s_quit = true;
+}
+
+
+/******************************************
+ ******************************************/
+
+int
+ScreenWidth( void )
+{
+    return s_orientation == ROTATE90 || s_orientation == ROTATE270 ?
+           s_base_height : s_base_width;
+}
+
+
+/******************************************
+ ******************************************/
+
+int
+ScreenHeight( void )
+{
+    return s_orientation == ROTATE90 || s_orientation == ROTATE270 ?
+           s_base_width : s_base_height;
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+SetOrientation( int n )
+{
+    if ( n < ROTATE0 || n > ROTATE180 )
+        return;
+
+    s_orientation = n;
+    s_fb.assign( s_base_width * s_base_height, 0xff );
+}
+
+
+/******************************************
+ ******************************************/
+
+int
+GetOrientation( void )
+{
+    return s_orientation;
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+OpenScreen( void )
+{
+    if ( s_fb.empty( ) )
+        setup( );
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+ClearScreen( void )
+{
+    s_stats.clear_screen++;
+    std::fill( s_fb.begin( ), s_fb.end( ), 0xff );
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+FullUpdate( void )
+{
+    s_stats.full_updates++;
+    s_stats.updated_pixels += s_fb.size( );
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+SoftUpdate( void )
+{
+    s_stats.soft_updates++;
+    s_stats.updated_pixels += s_fb.size( );
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+PartialUpdate( int,
+               int,
+               int w,
+               int h )
+{
+    s_stats.partial_updates++;
+    s_stats.updated_pixels += static_cast< unsigned long long >( w ) * h;
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+DynamicUpdate( int,
+               int,
+               int w,
+               int h )
+{
+    s_stats.dynamic_updates++;
+    s_stats.updated_pixels += static_cast< unsigned long long >( w ) * h;
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+Repaint( void )
+{
+    s_show_pending = true;
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+DrawLine( int x1,
+          int y1,
+          int x2,
+          int y2,
+          int color )
+{
+    int dx = std::abs( x2 - x1 ),
+        dy = std::abs( y2 - y1 ),
+        n  = std::max( dx, dy );
+
+    for ( int i = 0; i <= n; ++i )
+    {
+        int x = n ? x1 + ( x2 - x1 ) * i / n : x1,
+            y = n ? y1 + ( y2 - y1 ) * i / n : y1;
+        fill( x, y, 1, 1, gray( color ) );
+    }
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+FillArea( int x,
+          int y,
+          int w,
+          int h,
+          int color )
+{
+    s_stats.fill_area++;
+    fill( x, y, w, h, gray( color ) );
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+InvertArea( int x,
+            int y,
+            int w,
+            int h )
+{
+    int sw = ScreenWidth( ),
+        sh = ScreenHeight( );
+
+    for ( int j = std::max( y, 0 ); j < std::min( y + h, sh ); ++j )
+        for ( int i = std::max( x, 0 ); i < std::min( x + w, sw ); ++i )
+            s_fb[ j * sw + i ] = 0xff - s_fb[ j * sw + i ];
+}
+
+
+/******************************************
+ * Opens a font - every font exists in every size
+ ******************************************/
+
+ifont *
+OpenFont( const char * name,
+          int          size,
+          int          aa )
+{
+    if ( size <= 0 )
+        return 0;
+
+    ifont * f = new ifont;
+    std::memset( f, 0, sizeof *f );
+
+    f->name        = strdup( name ? name : "" );
+    f->size        = size;
+    f->aa          = aa;
+    f->height      = size;
+    f->linespacing = size;
+    f->baseline    = size * 4 / 5;
+
+    return f;
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+CloseFont( ifont * font )
+{
+    if ( ! font )
+        return;
+
+    if ( font == s_font )
+        s_font = 0;
+
+    std::free( font->name );
+    delete font;
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+SetFont( ifont * font,
+         int     color )
+{
+    s_font = font;
+    s_text_color = gray( color );
+}
+
+
+/******************************************
+ * Draws a string, each character (except spaces) as a filled box
+ ******************************************/
+
+void
+DrawString( int          x,
+            int          y,
+            const char * s )
+{
+    s_stats.draw_string++;
+
+    if (    ! s_watched_text.empty( )
+         && std::strstr( s, s_watched_text.c_str( ) ) )
+        s_watched_text_drawn = true;
+
+    if ( ! s_font )
+        return;
+
+    int w = advance( ),
+        h = s_font->size;
+
+    for ( ; *s; ++s )
+    {
+        if ( ( *s & 0xc0 ) == 0x80 )
+            continue;
+
+        if ( *s != ' ' )
+            fill( x + 1, y + h / 4, std::max( w - 2, 1 ), std::max( h / 2, 1 ),
+                  s_text_color );
+        x += w;
+    }
+}
+
+
+/******************************************
+ ******************************************/
+
+int
+StringWidth( const char * s )
+{
+    s_stats.string_width++;
+    return char_count( s ) * advance( );
+}
+
+
+/******************************************
+ ******************************************/
+
+int
+CharWidth( unsigned short )
+{
+    s_stats.char_width++;
+    return advance( );
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+SetWeakTimer( const char * name,
+              iv_timerproc tproc,
+              int          ms )
+{
+    set_timer( name, tproc, ms );
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+SetHardTimer( const char * name,
+              iv_timerproc tproc,
+              int          ms )
+{
+    set_timer( name, tproc, ms );
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+ClearTimer( iv_timerproc tproc )
+{
+    remove_timer( 0, tproc );
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+OpenKeyboard( const char *       ,
+              char *             buffer,
+              int                maxlen,
+              int                ,
+              iv_keyboardhandler hproc )
+{
+    s_kbd_buffer  = buffer;
+    s_kbd_maxlen  = maxlen;
+    s_kbd_handler = hproc;
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+OpenCustomKeyboard( const char *       ,
+                    const char *       title,
+                    char *             buffer,
+                    int                maxlen,
+                    int                flags,
+                    iv_keyboardhandler hproc )
+{
+    OpenKeyboard( title, buffer, maxlen, flags, hproc );
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+OpenMenu( imenu *        menu,
+          int            ,
+          int            ,
+          int            ,
+          iv_menuhandler hproc )
+{
+    s_menu         = menu;
+    s_menu_handler = hproc;
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+OpenRotateBox( iv_rotatehandler hproc )
+{
+    s_rotate_handler = hproc;
+}
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,197 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#if ! defined HEADLESS_INKVIEW_H_
+#define HEADLESS_INKVIEW_H_
+
+
+/******************************************
+ * Stand-in for the inkview.h file from the PocketBook SDK, declaring just
+ * the part of the libinkview interface pbterm uses. It's only used for the
+ * "Headless" build, where these functions are implemented by a backend
+ * drawing into an in-memory framebuffer (see Inkview_Headless.cpp). Values
+ * of constants are those of the SDK.
+ ******************************************/
+
+// The inkview.h file from the SDK pulls in these system headers and
+// pbterm relies on that
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+
+#if defined __cplusplus
+extern "C" {
+#endif
+
+
+typedef struct ifont_s
+{
+    char * name;
+    char * family;
+    int size;
+    unsigned char aa;
+    unsigned char isbold;
+    unsigned char isitalic;
+    unsigned char _r1;
+    unsigned short charset;
+    unsigned short _r2;
+    int color;
+    int height;
+    int linespacing;
+    int baseline;
+    void * fdata;
+} ifont;
+
+
+typedef struct irect_s
+{
+    int x,
+        y,
+        w,
+        h,
+        flags;
+} irect;
+
+
+typedef struct imenu_s
+{
+    short type;
+    short index;
+    char * text;
+    struct imenu_s * submenu;
+} imenu;
+
+
+typedef int ( * iv_handler )( int type, int par1, int par2 );
+typedef void ( * iv_timerproc )( void );
+typedef void ( * iv_keyboardhandler )( char * text );
+typedef void ( * iv_menuhandler )( int index );
+typedef void ( * iv_rotatehandler )( int direction );
+
+
+#define DEFAULTFONTM  "LiberationMono"
+
+
+#define BLACK  0x000000
+#define DGRAY  0x555555
+#define LGRAY  0xaaaaaa
+#define WHITE  0xffffff
+
+
+#define ITEM_HEADER     1
+#define ITEM_ACTIVE     2
+#define ITEM_INACTIVE   3
+#define ITEM_SUBMENU    5
+#define ITEM_SEPARATOR  6
+#define ITEM_BULLET     7
+
+
+#define EVT_INIT         21
+#define EVT_EXIT         22
+#define EVT_SHOW         23
+#define EVT_HIDE         24
+#define EVT_KEYPRESS     25
+#define EVT_KEYRELEASE   26
+#define EVT_KEYUP        26
+#define EVT_KEYREPEAT    28
+#define EVT_POINTERUP    29
+#define EVT_POINTERDOWN  30
+#define EVT_POINTERMOVE  31
+#define EVT_POINTERLONG  34
+#define EVT_POINTERHOLD  35
+
+
+#define ISKEYEVENT( x )  ( ( x ) >= 25 && ( x ) <= 28 )
+#define ISPOINTEREVENT( x )  (    ( ( x ) >= 29 && ( x ) <= 31 )  \
+                               || ( ( x ) >= 34 && ( x ) <= 35 ) )
+
+
+#define KEY_MENU  0x17
+#define KEY_PREV  0x18
+#define KEY_NEXT  0x19
+
+
+#define ROTATE0    0
+#define ROTATE90   1
+#define ROTATE270  2
+#define ROTATE180  3
+
+
+void InkViewMain( iv_handler handler );
+void CloseApp( void );
+
+int ScreenWidth( void );
+int ScreenHeight( void );
+void SetOrientation( int n );
+int GetOrientation( void );
+
+void OpenScreen( void );
+void ClearScreen( void );
+void FullUpdate( void );
+void SoftUpdate( void );
+void PartialUpdate( int x, int y, int w, int h );
+void DynamicUpdate( int x, int y, int w, int h );
+void Repaint( void );
+
+void DrawLine( int x1, int y1, int x2, int y2, int color );
+void FillArea( int x, int y, int w, int h, int color );
+void InvertArea( int x, int y, int w, int h );
+
+ifont * OpenFont( const char * name, int size, int aa );
+void CloseFont( ifont * font );
+void SetFont( ifont * font, int color );
+void DrawString( int x, int y, const char * s );
+int StringWidth( const char * s );
+int CharWidth( unsigned short c );
+
+void SetWeakTimer( const char * name, iv_timerproc tproc, int ms );
+void SetHardTimer( const char * name, iv_timerproc tproc, int ms );
+void ClearTimer( iv_timerproc tproc );
+
+void OpenKeyboard( const char * title, char * buffer, int maxlen, int flags,
+                   iv_keyboardhandler hproc );
+void OpenCustomKeyboard( const char * filename, const char * title,
+                         char * buffer, int maxlen, int flags,
+                         iv_keyboardhandler hproc );
+void OpenMenu( imenu * menu, int pos, int x, int y, iv_menuhandler hproc );
+void OpenRotateBox( iv_rotatehandler hproc );
+
+
+#if defined __cplusplus
+}
+#endif
+
+
+#endif
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,278 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "Alloc_Profile.hpp"
+#include "Utils.hpp"
+#include <iomanip>
+#include <new>
+#include <cstdlib>
+
+
+#if defined ALLOC_PROFILE
+
+namespace
+{
+
+char const * const Tag_Names[ ] = { "other",
+                                    "shell output",
+                                    "split_string",
+                                    "line store",
+                                    "redraw",
+                                    "submenus" };
+
+
+// Counters for allocations and bytes per tag
+
+unsigned long s_allocs[ Alloc_Profile::Num_Tags ];
+unsigned long long s_bytes[ Alloc_Profile::Num_Tags ];
+
+
+// Tag for allocations made by the current thread
+
+__thread Alloc_Profile::Tag s_current_tag = Alloc_Profile::Other;
+
+}
+
+#endif
+
+
+#if defined ALLOC_PROFILE
+
+/******************************************
+ ******************************************/
+
+Alloc_Profile::Scope::Scope( Tag tag )
+    : m_previous( s_current_tag )
+{
+    s_current_tag = tag;
+}
+
+
+/******************************************
+ ******************************************/
+
+Alloc_Profile::Scope::~Scope( )
+{
+    s_current_tag = m_previous;
+}
+
+#endif
+
+
+/******************************************
+ * A new baseline has all counters at zero (i.e. as they are at the start
+ * of the program)
+ ******************************************/
+
+Alloc_Profile::Baseline::Baseline( )
+    : time( Utils::microseconds( ) )
+{
+    for ( int i = 0; i < Num_Tags; ++i )
+    {
+        allocs[ i ] = 0;
+        bytes[ i ]  = 0;
+    }
+}
+
+
+/******************************************
+ ******************************************/
+
+bool
+Alloc_Profile::is_enabled( )
+{
+#if defined ALLOC_PROFILE
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+/******************************************
+ ******************************************/
+
+unsigned long
+Alloc_Profile::allocations( Tag tag )
+{
+#if defined ALLOC_PROFILE
+    return s_allocs[ tag ];
+#else
+    ( void ) tag;
+    return 0;
+#endif
+}
+
+
+/******************************************
+ ******************************************/
+
+unsigned long long
+Alloc_Profile::bytes( Tag tag )
+{
+#if defined ALLOC_PROFILE
+    return s_bytes[ tag ];
+#else
+    ( void ) tag;
+    return 0;
+#endif
+}
+
+
+/******************************************
+ ******************************************/
+
+unsigned long
+Alloc_Profile::total_allocations( )
+{
+    unsigned long sum = 0;
+
+    for ( int i = 0; i < Num_Tags; ++i )
+        sum += allocations( static_cast< Tag >( i ) );
+    return sum;
+}
+
+
+/******************************************
+ ******************************************/
+
+unsigned long long
+Alloc_Profile::total_bytes( )
+{
+    unsigned long long sum = 0;
+
+    for ( int i = 0; i < Num_Tags; ++i )
+        sum += bytes( static_cast< Tag >( i ) );
+    return sum;
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+Alloc_Profile::write( std::ostream & out,
+                      Baseline     & baseline )
+{
+#if defined ALLOC_PROFILE
+    unsigned long long now = Utils::microseconds( );
+    double secs = ( now - baseline.time ) / 1.0e6;
+
+    if ( secs <= 0 )
+        secs = 1.0e-6;
+
+    out << "Allocations                  count    per s        bytes"
+           "      per s\n";
+
+    for ( int i = 0; i < Num_Tags; ++i )
+    {
+        unsigned long allocs = s_allocs[ i ];
+        unsigned long long bytes = s_bytes[ i ];
+
+        out << std::left << std::setw( 24 ) << Tag_Names[ i ] << std::right
+            << std::setw( 11 ) << allocs
+            << std::setw( 9 )
+            << static_cast< unsigned long >(
+                                    ( allocs - baseline.allocs[ i ] ) / secs )
+            << std::setw( 13 ) << bytes
+            << std::setw( 11 )
+            << static_cast< unsigned long long >(
+                                      ( bytes - baseline.bytes[ i ] ) / secs )
+            << '\n';
+
+        baseline.allocs[ i ] = allocs;
+        baseline.bytes[ i ]  = bytes;
+    }
+
+    baseline.time = now;
+#else
+    ( void ) out;
+    ( void ) baseline;
+#endif
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+Alloc_Profile::record( std::size_t size )
+{
+#if defined ALLOC_PROFILE
+    __sync_fetch_and_add( s_allocs + s_current_tag, 1 );
+    __sync_fetch_and_add( s_bytes + s_current_tag, size );
+#else
+    ( void ) size;
+#endif
+}
+
+
+#if defined ALLOC_PROFILE
+
+/******************************************
+ * Replacements for the global operator new and delete (the array versions
+ * of the standard library call these)
+ ******************************************/
+
+void *
+operator new( std::size_t size ) throw( std::bad_alloc )
+{
+    Alloc_Profile::record( size );
+
+    void * p = std::malloc( size ? size : 1 );
+    if ( ! p )
+        throw std::bad_alloc( );
+    return p;
+}
+
+
+void *
+operator new( std::size_t             size,
+              std::nothrow_t const & ) throw( )
+{
+    Alloc_Profile::record( size );
+    return std::malloc( size ? size : 1 );
+}
+
+
+void
+operator delete( void * p ) throw( )
+{
+    std::free( p );
+}
+
+
+void
+operator delete( void                 * p,
+                 std::nothrow_t const & ) throw( )
+{
+    std::free( p );
+}
+
+#endif
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
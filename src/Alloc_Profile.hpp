@@ -0,0 +1,152 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#if ! defined ALLOC_PROFILE_HPP_
+#define ALLOC_PROFILE_HPP_
+
+
+#include <ostream>
+#include <cstddef>
+
+
+/******************************************
+ * Allocation profiler, only available when built with ALLOC_PROFILE
+ * defined (e.g. by running cmake with '-DALLOC_PROFILE=ON'). It replaces
+ * the global operator new and delete and attributes each allocation to
+ * the subsystem that was active when it was made. Subsystems mark the
+ * code they run by creating a scope object, e.g.
+ *
+ *   Alloc_Profile::Scope scope( Alloc_Profile::Line_Store );
+ *
+ * which sets the tag for the current thread until it goes out of scope
+ * (scopes can be nested, the innermost one wins). In normal builds the
+ * scope objects do nothing and cost nothing.
+ ******************************************/
+
+class Alloc_Profile
+{
+  public :
+
+    // The subsystems allocations get attributed to
+
+    enum Tag
+    {
+        Other,
+        Shell_Output,
+        Split_String,
+        Line_Store,
+        Redraw,
+        Submenus,
+        Num_Tags
+    };
+
+
+    // Sets the tag for the current thread while it exists
+
+    class Scope
+    {
+      public :
+
+#if defined ALLOC_PROFILE
+        explicit
+        Scope( Tag tag );
+
+
+        ~Scope( );
+
+
+      private :
+
+        Tag m_previous;
+#else
+        explicit
+        Scope( Tag )
+        { }
+#endif
+    };
+
+
+    // Counter values and time (in microseconds) of a report, for the
+    // rates in the next one. Each user of write() needs one of its own,
+    // the rates are otherwise for the time since someone else's report.
+
+    struct Baseline
+    {
+        Baseline( );
+
+        unsigned long allocs[ Num_Tags ];
+        unsigned long long bytes[ Num_Tags ];
+        unsigned long long time;
+    };
+
+
+    // Returns if the profiler was compiled in
+
+    static bool
+    is_enabled( );
+
+
+    // Returns the number of allocations made and the number of bytes
+    // requested for a tag
+
+    static unsigned long
+    allocations( Tag tag );
+
+
+    static unsigned long long
+    bytes( Tag tag );
+
+
+    // Returns the number of allocations made for all tags together
+
+    static unsigned long
+    total_allocations( );
+
+
+    static unsigned long long
+    total_bytes( );
+
+
+    // Writes a line per tag with the number of allocations and bytes
+    // and how many of them there were per second since the values in
+    // the baseline, which then gets set to the current ones
+
+    static void
+    write( std::ostream & out,
+           Baseline     & baseline );
+
+
+    // Counts an allocation, called from operator new
+
+    static void
+    record( std::size_t size );
+};
+
+
+#endif
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
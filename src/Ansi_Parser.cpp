@@ -0,0 +1,247 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "Ansi_Parser.hpp"
+
+
+// Maximum number of parameters of a control sequence we keep and the
+// maximum value a parameter can have (more or larger ones are bogus)
+
+#define MAX_CSI_PARAMS  16
+#define MAX_CSI_VALUE   9999
+
+
+/******************************************
+ ******************************************/
+
+Ansi_Parser::Ansi_Parser( )
+    : m_state( Ground )
+    , m_utf8_missing( 0 )
+    , m_utf8_start( 0 )
+    , m_private( '\0' )
+{ }
+
+
+/******************************************
+ ******************************************/
+
+void
+Ansi_Parser::reset( )
+{
+    m_state = Ground;
+    m_text.clear( );
+    m_utf8_missing = 0;
+    m_private = '\0';
+    m_params.clear( );
+}
+
+
+/******************************************
+ * Goes through the new data character by character. At the end all
+ * text collected is passed on, except for an incomplete UTF-8 sequence
+ * at the very end, which has to wait for the rest of it to arrive.
+ ******************************************/
+
+void
+Ansi_Parser::feed( std::string const & data,
+                   Ansi_Sink         & sink )
+{
+    for ( std::string::const_iterator it = data.begin( );
+          it != data.end( ); ++it )
+    {
+        unsigned char c = *it;
+
+        switch ( m_state )
+        {
+            case Ground :
+                ground( c, sink );
+                break;
+
+            case Escape :
+                if ( c == '[' )
+                {
+                    m_state = Csi;
+                    m_private = '\0';
+                    m_params.clear( );
+                }
+                else if ( c == ']' )
+                    m_state = Osc;
+                else if ( c == '(' || c == ')' || c == '*' || c == '+' )
+                    m_state = Charset;
+                else if ( c == 0x1b )
+                    ;                  // a second ESC starts all over again
+                else if ( c < 0x20 )
+                    sink.control( c ); // controls get executed in between
+                else
+                {
+                    m_state = Ground;
+                    sink.escape( c );
+                }
+                break;
+
+            case Csi :
+                csi_char( c, sink );
+                break;
+
+            case Osc :                 // operating system commands (e.g.
+                if ( c == 0x07 )       // setting the window title) end with
+                    m_state = Ground;  // either BEL or ST ("ESC \") and get
+                else if ( c == 0x1b )  // ignored
+                    m_state = Osc_Escape;
+                break;
+
+            case Osc_Escape :
+                m_state = c == 0x1b ? Osc_Escape : Ground;
+                break;
+
+            case Charset :             // character set selections are
+                m_state = Ground;      // ignored, we only do UTF-8
+                break;
+        }
+    }
+
+    flush_text( sink, false );
+}
+
+
+/******************************************
+ * Deals with a character while not within an escape sequence
+ ******************************************/
+
+void
+Ansi_Parser::ground( unsigned char c,
+                     Ansi_Sink   & sink )
+{
+    if ( c >= 0x20 && c != 0x7f )
+    {
+        if ( c < 0x80 )
+            m_utf8_missing = 0;
+        else if ( c < 0xc0 )
+        {
+            if ( m_utf8_missing > 0 )
+                m_utf8_missing--;
+        }
+        else
+        {
+            m_utf8_start = m_text.size( );
+            if ( c < 0xe0 )
+                m_utf8_missing = 1;
+            else if ( c < 0xf0 )
+                m_utf8_missing = 2;
+            else if ( c < 0xf8 )
+                m_utf8_missing = 3;
+            else
+                m_utf8_missing = 0;
+        }
+
+        m_text += c;
+        return;
+    }
+
+    flush_text( sink, true );
+
+    if ( c == 0x1b )
+        m_state = Escape;
+    else if ( c != 0x7f )
+        sink.control( c );
+}
+
+
+/******************************************
+ * Deals with a character within a control sequence
+ ******************************************/
+
+void
+Ansi_Parser::csi_char( unsigned char c,
+                       Ansi_Sink   & sink )
+{
+    if ( c >= '0' && c <= '9' )
+    {
+        if ( m_params.empty( ) )
+            m_params.push_back( -1 );
+
+        int & p = m_params.back( );
+        p = p < 0 ? c - '0' : p * 10 + c - '0';
+        if ( p > MAX_CSI_VALUE )
+            p = MAX_CSI_VALUE;
+    }
+    else if ( c == ';' || c == ':' )
+    {
+        if ( m_params.empty( ) )
+            m_params.push_back( -1 );
+        if ( m_params.size( ) < MAX_CSI_PARAMS )
+            m_params.push_back( -1 );
+    }
+    else if ( c >= '<' && c <= '?' )
+    {
+        if ( m_params.empty( ) )
+            m_private = c;
+    }
+    else if ( c >= 0x20 && c <= 0x2f )
+        ;                              // intermediate characters get ignored
+    else if ( c >= 0x40 && c <= 0x7e )
+    {
+        m_state = Ground;
+        sink.csi( m_private, m_params, c );
+    }
+    else if ( c == 0x1b )
+        m_state = Escape;              // broken sequence, start a new one
+    else if ( c < 0x20 )
+        sink.control( c );
+    else
+        m_state = Ground;
+}
+
+
+/******************************************
+ * Passes the text collected so far on. If 'all' isn't set an incomplete
+ * UTF-8 sequence at the end is kept back.
+ ******************************************/
+
+void
+Ansi_Parser::flush_text( Ansi_Sink & sink,
+                         bool        all )
+{
+    if ( m_text.empty( ) )
+        return;
+
+    if ( all || m_utf8_missing == 0 )
+    {
+        sink.text( m_text );
+        m_text.clear( );
+        m_utf8_missing = 0;
+        return;
+    }
+
+    if ( m_utf8_start > 0 )
+    {
+        sink.text( m_text.substr( 0, m_utf8_start ) );
+        m_text.erase( 0, m_utf8_start );
+        m_utf8_start = 0;
+    }
+}
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
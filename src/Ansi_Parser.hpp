@@ -0,0 +1,169 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#if ! defined ANSI_PARSER_HPP_
+#define ANSI_PARSER_HPP_
+
+
+#include <string>
+#include <vector>
+
+
+/******************************************
+ * Interface for objects receiving what the Ansi_Parser found in the
+ * output of the shell
+ ******************************************/
+
+class Ansi_Sink
+{
+  public :
+
+    virtual
+    ~Ansi_Sink( )
+    { }
+
+
+    // Called with a run of printable text (only containing complete
+    // UTF-8 sequences)
+
+    virtual void
+    text( std::string const & txt ) = 0;
+
+
+    // Called for control characters (with the exception of ESC)
+
+    virtual void
+    control( char c ) = 0;
+
+
+    // Called for escape sequences consisting of ESC and a single character
+
+    virtual void
+    escape( char c ) = 0;
+
+
+    // Called for control sequences ("ESC [ ..."), 'priv' is the private
+    // marker character (e.g. '?') or '\0', missing parameters are -1
+
+    virtual void
+    csi( char                       priv,
+         std::vector< int > const & params,
+         char                       final ) = 0;
+};
+
+
+/******************************************
+ * Class for splitting the output of the shell into text, control
+ * characters and escape sequences. Since data arrive in chunks of
+ * arbitrary size incomplete escape sequences and UTF-8 sequences at
+ * the end of a chunk are kept until the next chunk arrives.
+ ******************************************/
+
+class Ansi_Parser
+{
+  public :
+
+    Ansi_Parser( );
+
+
+    // Parses new data, passing the results on to the sink
+
+    void
+    feed( std::string const & data,
+          Ansi_Sink         & sink );
+
+
+    // Returns if the parser isn't in the middle of a sequence
+
+    bool
+    is_idle( ) const  { return m_state == Ground && m_text.empty( ); }
+
+
+    // Forgets about everything not yet completely parsed
+
+    void
+    reset( );
+
+
+  private :
+
+    enum State
+    {
+        Ground,
+        Escape,
+        Csi,
+        Osc,
+        Osc_Escape,
+        Charset
+    };
+
+
+    void
+    ground( unsigned char c,
+            Ansi_Sink   & sink );
+
+
+    void
+    csi_char( unsigned char c,
+              Ansi_Sink   & sink );
+
+
+    void
+    flush_text( Ansi_Sink & sink,
+                bool        all );
+
+
+    // Current state of the parser
+
+    State m_state;
+
+
+    // Text collected but not yet passed on
+
+    std::string m_text;
+
+
+    // Number of UTF-8 continuation bytes still expected and position
+    // in 'm_text' where the incomplete sequence starts
+
+    int m_utf8_missing;
+
+
+    std::size_t m_utf8_start;
+
+
+    // Private marker and parameters of the control sequence being parsed
+
+    char m_private;
+
+
+    std::vector< int > m_params;
+};
+
+
+#endif
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,587 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "Async_Writer.hpp"
+#include "Defaults.hpp"
+#include "Metrics.hpp"
+#include "Utils.hpp"
+#include <sstream>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <sys/time.h>
+#include <zlib.h>
+
+
+namespace
+{
+
+Metrics::Counter & s_log_bytes  = Metrics::counter( "log bytes written" );
+Metrics::Counter & s_log_writes = Metrics::counter( "log blocks written" );
+Metrics::Counter & s_log_drops  = Metrics::counter( "log bytes dropped" );
+Metrics::Counter & s_rotations  = Metrics::counter( "log files rotated" );
+Metrics::Counter & s_rot_fails  = Metrics::counter( "log rotations failed" );
+
+
+/******************************************
+ * Returns the name of an old file
+ ******************************************/
+
+std::string
+old_file_name( std::string const & file_name,
+               int                 number,
+               bool                is_compressed = true )
+{
+    std::ostringstream name;
+
+    name << file_name << '.' << number << ( is_compressed ? ".gz" : "" );
+    return name.str( );
+}
+
+}
+
+
+/******************************************
+ * Constructor, the thread only gets started once the file is open
+ ******************************************/
+
+Async_Writer::Async_Writer( )
+    : m_fp( 0 )
+    , m_file_size( 0 )
+    , m_max_size( 0 )
+    , m_max_files( 0 )
+    , m_has_compressor( false )
+    , m_has_thread( false )
+    , m_appended( 0 )
+    , m_written( 0 )
+    , m_dropped( 0 )
+    , m_is_urgent( false )
+    , m_quit( false )
+{
+    pthread_mutex_init( &m_mutex, 0 );
+    pthread_cond_init( &m_wakeup, 0 );
+    pthread_cond_init( &m_written_cond, 0 );
+}
+
+
+/******************************************
+ * Destructor, has the thread write out everything still pending before
+ * it exits
+ ******************************************/
+
+Async_Writer::~Async_Writer( )
+{
+    pthread_mutex_lock( &m_mutex );
+    m_quit = true;
+    pthread_cond_signal( &m_wakeup );
+    pthread_mutex_unlock( &m_mutex );
+
+    if ( m_has_thread )
+        pthread_join( m_thread, 0 );
+
+    wait_for_compression( );
+
+    if ( m_fp )
+        std::fclose( m_fp );
+
+    pthread_cond_destroy( &m_written_cond );
+    pthread_cond_destroy( &m_wakeup );
+    pthread_mutex_destroy( &m_mutex );
+}
+
+
+/******************************************
+ * Creates the file (and all directories leading to it) and starts the
+ * thread. When files get rotated an existing file is treated as one that
+ * has become too large.
+ ******************************************/
+
+bool
+Async_Writer::open( std::string const & file_name,
+                    std::size_t         max_size,
+                    int                 max_files,
+                    std::string const & header )
+{
+    if ( m_fp )
+        return false;
+
+    m_file_name = Utils::prepare_file_creation( file_name );
+    m_max_size  = max_size;
+    m_max_files = max_files;
+    m_header    = header;
+
+    if ( m_file_name.empty( ) )
+        return false;
+
+    std::FILE * fp;
+    if (    m_max_size
+         && ( fp = std::fopen( m_file_name.c_str( ), "r" ) ) )
+    {
+        bool is_empty = std::fgetc( fp ) == EOF;
+        std::fclose( fp );
+
+        if ( is_empty )
+            start_new_file( );
+        else if ( ! rotate( ) )
+            return false;
+    }
+    else
+        start_new_file( );
+
+    return start_thread( );
+}
+
+
+/******************************************
+ * Opens a file for appending to it (creating it and all directories
+ * leading to it if necessary) and starts the thread. The file never
+ * gets rotated.
+ ******************************************/
+
+bool
+Async_Writer::append_to( std::string const & file_name )
+{
+    if ( m_fp )
+        return false;
+
+    m_file_name = Utils::prepare_file_creation( file_name );
+
+    if (    m_file_name.empty( )
+         || ! ( m_fp = std::fopen( m_file_name.c_str( ), "a" ) ) )
+        return false;
+
+    std::setvbuf( m_fp, 0, _IONBF, 0 );
+    return start_thread( );
+}
+
+
+/******************************************
+ * Starts the thread once the file is open, closes the file again if
+ * that fails
+ ******************************************/
+
+bool
+Async_Writer::start_thread( )
+{
+    if ( ! m_fp )
+        return false;
+
+    if ( pthread_create( &m_thread, 0, thread_func, this ) != 0 )
+    {
+        std::fclose( m_fp );
+        m_fp = 0;
+        return false;
+    }
+
+    m_has_thread = true;
+    return true;
+}
+
+
+/******************************************
+ * Appends data to the buffer. The thread only gets woken up when the
+ * buffer was empty (to start waiting for the time limit) or has just
+ * become large enough to be written out.
+ ******************************************/
+
+void
+Async_Writer::write( char const  * data,
+                     std::size_t   len )
+{
+    if ( ! len || ! m_has_thread )
+        return;
+
+    pthread_mutex_lock( &m_mutex );
+
+    std::size_t old_size = m_pending.size( );
+    m_appended += len;
+
+    if ( old_size + len > LOG_MAX_PENDING )
+    {
+        m_dropped += len;
+        m_written += len;
+        s_log_drops.add( len );
+    }
+    else
+    {
+        m_pending.append( data, len );
+
+        if (    old_size == 0
+             || (    old_size < LOG_FLUSH_SIZE
+                  && old_size + len >= LOG_FLUSH_SIZE ) )
+            pthread_cond_signal( &m_wakeup );
+    }
+
+    pthread_mutex_unlock( &m_mutex );
+}
+
+
+/******************************************
+ * Has the thread write out everything immediately and waits for it
+ ******************************************/
+
+void
+Async_Writer::flush( )
+{
+    if ( ! m_has_thread )
+        return;
+
+    pthread_mutex_lock( &m_mutex );
+
+    unsigned long long target = m_appended;
+
+    if ( m_written < target )
+    {
+        m_is_urgent = true;
+        pthread_cond_signal( &m_wakeup );
+
+        while ( m_written < target )
+            pthread_cond_wait( &m_written_cond, &m_mutex );
+    }
+
+    pthread_mutex_unlock( &m_mutex );
+}
+
+
+/******************************************
+ * Function the thread gets started with, just redirects to run()
+ ******************************************/
+
+void *
+Async_Writer::thread_func( void * arg )
+{
+    static_cast< Async_Writer * >( arg )->run( );
+    return 0;
+}
+
+
+/******************************************
+ * Main loop of the thread: waits for data to be written, then swaps the
+ * buffer with its own (empty) one and writes it out without holding the
+ * lock. Since the two buffers get swapped back and forth both keep their
+ * memory, so there's no allocation once they've grown large enough.
+ ******************************************/
+
+void
+Async_Writer::run( )
+{
+    std::string block;
+
+    pthread_mutex_lock( &m_mutex );
+
+    while ( 1 )
+    {
+        wait_for_data( );
+
+        if ( m_pending.empty( ) && m_quit )
+            break;
+
+        std::size_t len = m_pending.size( );
+        unsigned long long dropped = m_dropped;
+
+        block.swap( m_pending );
+        m_dropped = 0;
+        m_is_urgent = false;
+
+        pthread_mutex_unlock( &m_mutex );
+
+        if ( dropped && m_fp )
+        {
+            std::ostringstream note;
+            note << "\n[" << dropped << " bytes dropped]\n";
+            std::fputs( note.str( ).c_str( ), m_fp );
+        }
+
+        if ( len )
+            write_block( block );
+
+        block.clear( );
+
+        pthread_mutex_lock( &m_mutex );
+
+        m_written += len;
+        pthread_cond_broadcast( &m_written_cond );
+    }
+
+    pthread_mutex_unlock( &m_mutex );
+}
+
+
+/******************************************
+ * Waits (with the mutex locked) until there's something to write and
+ * it's time to do so: enough data have accumulated, the oldest of them
+ * have waited for long enough, someone is waiting for them to be written
+ * or the thread is to exit.
+ ******************************************/
+
+void
+Async_Writer::wait_for_data( )
+{
+    while ( m_pending.empty( ) && ! m_dropped && ! m_quit )
+        pthread_cond_wait( &m_wakeup, &m_mutex );
+
+    struct timeval tv;
+    gettimeofday( &tv, 0 );
+
+    unsigned long long usec =   tv.tv_usec
+                              + 1000ULL * LOG_FLUSH_INTERVAL;
+    struct timespec deadline;
+    deadline.tv_sec  = tv.tv_sec + usec / 1000000;
+    deadline.tv_nsec = ( usec % 1000000 ) * 1000;
+
+    while (    ! m_quit
+            && ! m_is_urgent
+            && m_pending.size( ) < LOG_FLUSH_SIZE )
+        if ( pthread_cond_timedwait( &m_wakeup, &m_mutex, &deadline )
+                                                                == ETIMEDOUT )
+            break;
+}
+
+
+/******************************************
+ * Writes a block to the file. If the file would become too large the part
+ * up to the last line end that still fits gets written, then the file
+ * gets rotated and the rest goes to the new one. A single line too long
+ * for the file gets written as a whole.
+ ******************************************/
+
+void
+Async_Writer::write_block( std::string const & block )
+{
+    std::size_t start = 0;
+
+    while ( m_fp && start < block.size( ) )
+    {
+        std::size_t len = block.size( ) - start;
+
+        if ( m_max_size && m_file_size + len > m_max_size )
+        {
+            std::size_t room = m_file_size < m_max_size ?
+                               m_max_size - m_file_size : 0;
+            std::size_t pos = room ?
+                              block.rfind( '\n', start + room - 1 ) :
+                              std::string::npos;
+
+            if ( pos != std::string::npos && pos >= start )
+                len = pos + 1 - start;
+            else if ( m_file_size > m_header.size( ) )
+            {
+                if ( ! rotate( ) && ! m_fp )
+                    break;
+                continue;
+            }
+            else if (    ( pos = block.find( '\n', start + room ) )
+                                                        != std::string::npos )
+                len = pos + 1 - start;
+        }
+
+        std::fwrite( block.data( ) + start, 1, len, m_fp );
+        m_file_size += len;
+        start += len;
+
+        s_log_bytes.add( len );
+        s_log_writes.add( );
+
+        if ( start < block.size( ) && ! rotate( ) && ! m_fp )
+            break;
+    }
+
+    // Only happens if there's no file left to write to at all
+
+    if ( start < block.size( ) )
+        s_log_drops.add( block.size( ) - start );
+}
+
+
+/******************************************
+ * Moves the current file out of the way (or just deletes it if no old
+ * files are to be kept), with all older ones getting renamed to make
+ * room for it, and starts a new one. The file moved out of the way gets
+ * compressed in the background. Returns false if the file couldn't be
+ * renamed, in which case writing continues with the current file.
+ ******************************************/
+
+bool
+Async_Writer::rotate( )
+{
+    if ( m_fp )
+        std::fclose( m_fp );
+    m_fp = 0;
+
+    s_rotations.add( );
+
+    // The oldest files can only be renamed once compressing the latest one
+    // is finished
+
+    wait_for_compression( );
+
+    if ( m_max_files <= 0 )
+        std::remove( m_file_name.c_str( ) );
+    else
+    {
+        std::remove( old_file_name( m_file_name, m_max_files ).c_str( ) );
+
+        for ( int i = m_max_files - 1; i > 0; --i )
+            std::rename( old_file_name( m_file_name, i ).c_str( ),
+                         old_file_name( m_file_name, i + 1 ).c_str( ) );
+
+        std::string old_name( old_file_name( m_file_name, 1, false ) );
+
+        if ( std::rename( m_file_name.c_str( ), old_name.c_str( ) ) )
+        {
+            int err = errno;
+            s_rot_fails.add( );
+            reopen( err );
+            return false;
+        }
+
+        std::string * arg = new std::string( old_name );
+        if ( pthread_create( &m_compressor, 0, compress_func, arg ) == 0 )
+            m_has_compressor = true;
+        else
+        {
+            delete arg;
+            compress( old_name );
+        }
+    }
+
+    start_new_file( );
+    return m_fp != 0;
+}
+
+
+/******************************************
+ * Reopens the current file for appending after it couldn't be renamed
+ * (or starts it anew if even that fails) and notes the error in it. The
+ * file then counts as new again, so the next attempt at rotating it only
+ * gets made after it has grown by the maximum size once more, instead of
+ * on every write.
+ ******************************************/
+
+void
+Async_Writer::reopen( int err )
+{
+    if ( ( m_fp = std::fopen( m_file_name.c_str( ), "a" ) ) )
+    {
+        std::setvbuf( m_fp, 0, _IONBF, 0 );
+        m_file_size = m_header.size( );
+    }
+    else
+        start_new_file( );
+
+    if ( m_fp )
+    {
+        std::ostringstream note;
+        note << "\n[rotating file failed: " << std::strerror( err ) << "]\n";
+        std::fputs( note.str( ).c_str( ), m_fp );
+    }
+}
+
+
+/******************************************
+ * Creates a new file (overwriting an existing one) and writes the header.
+ * The stdio buffer isn't needed since only large blocks get written.
+ ******************************************/
+
+void
+Async_Writer::start_new_file( )
+{
+    if ( ! ( m_fp = std::fopen( m_file_name.c_str( ), "w" ) ) )
+        return;
+
+    std::setvbuf( m_fp, 0, _IONBF, 0 );
+
+    std::fwrite( m_header.data( ), 1, m_header.size( ), m_fp );
+    m_file_size = m_header.size( );
+}
+
+
+/******************************************
+ * Function the compressing thread gets started with
+ ******************************************/
+
+void *
+Async_Writer::compress_func( void * arg )
+{
+    std::string * file_name = static_cast< std::string * >( arg );
+
+    compress( *file_name );
+    delete file_name;
+    return 0;
+}
+
+
+/******************************************
+ * Compresses a file with gzip, replacing it by a file with '.gz' appended
+ * to its name. A temporary file is used, so a compressed file that exists
+ * is always complete.
+ ******************************************/
+
+void
+Async_Writer::compress( std::string const & file_name )
+{
+    std::string gz_name( file_name + ".gz" );
+    std::string tmp_name( gz_name + ".tmp" );
+
+    std::FILE * in = std::fopen( file_name.c_str( ), "rb" );
+    if ( ! in )
+        return;
+
+    gzFile out = gzopen( tmp_name.c_str( ), "wb" );
+    bool is_ok = out != 0;
+
+    char buf[ 65536 ];
+    std::size_t len;
+
+    while ( is_ok && ( len = std::fread( buf, 1, sizeof buf, in ) ) > 0 )
+        is_ok = gzwrite( out, buf, len ) == static_cast< int >( len );
+
+    std::fclose( in );
+
+    if ( out && gzclose( out ) != Z_OK )
+        is_ok = false;
+
+    if ( is_ok && ! std::rename( tmp_name.c_str( ), gz_name.c_str( ) ) )
+        std::remove( file_name.c_str( ) );
+    else
+        std::remove( tmp_name.c_str( ) );
+}
+
+
+/******************************************
+ * Waits for the thread compressing an old file to finish
+ ******************************************/
+
+void
+Async_Writer::wait_for_compression( )
+{
+    if ( m_has_compressor )
+        pthread_join( m_compressor, 0 );
+    m_has_compressor = false;
+}
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
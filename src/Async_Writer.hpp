@@ -0,0 +1,241 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#if ! defined ASYNC_WRITER_HPP_
+#define ASYNC_WRITER_HPP_
+
+
+#include <string>
+#include <cstdio>
+#include <pthread.h>
+
+
+/******************************************
+ * Class for writing to a file from a thread of its own, so that whoever
+ * writes never has to wait for the (possibly slow) storage. Data get
+ * appended to a buffer in memory and the thread writes them out in large
+ * blocks, once enough have accumulated or the oldest of them have waited
+ * for long enough. Writing a block only needs the lock for swapping the
+ * buffer with an empty one. When the thread can't keep up, data exceeding
+ * the limit for what's pending get dropped (and a note about it written
+ * to the file instead).
+ *
+ * The size of the file can be limited: when it would grow too large it
+ * gets renamed to '<name>.1' and a new one started. The old file then
+ * gets compressed to '<name>.1.gz' by yet another thread, so the writing
+ * thread doesn't have to wait for that. Older files move up to '.2.gz'
+ * etc., the oldest one getting deleted when there are too many. Files
+ * only get cut at the end of a line.
+ ******************************************/
+
+class Async_Writer
+{
+  public :
+
+    Async_Writer( );
+
+
+    // Writes out everything still pending, stops the thread and closes
+    // the file
+
+    ~Async_Writer( );
+
+
+    // Creates the file, returns false on failure. Can only be called once.
+    // With a maximum size (in bytes) the file gets rotated when it grows
+    // larger, keeping at most 'max_files' old (compressed) ones - also an
+    // existing file gets rotated instead of being overwritten then. The
+    // header gets written at the start of each new file.
+
+    bool
+    open( std::string const & file_name,
+          std::size_t         max_size = 0,
+          int                 max_files = 0,
+          std::string const & header = "" );
+
+
+    // Opens an existing file (or creates a new one) for appending to it,
+    // returns false on failure. The file never gets rotated.
+
+    bool
+    append_to( std::string const & file_name );
+
+
+    // Appends data to what's to be written
+
+    void
+    write( char const  * data,
+           std::size_t   len );
+
+
+    // Returns once everything passed to write() has been written to the
+    // file
+
+    void
+    flush( );
+
+
+  private :
+
+    // Copying or assigning a writer makes no sense
+
+    Async_Writer( Async_Writer const & );
+
+
+    Async_Writer &
+    operator = ( Async_Writer const & );
+
+
+    bool
+    start_thread( );
+
+
+    static void *
+    thread_func( void * arg );
+
+
+    void
+    run( );
+
+
+    void
+    wait_for_data( );
+
+
+    void
+    write_block( std::string const & block );
+
+
+    bool
+    rotate( );
+
+
+    void
+    reopen( int err );
+
+
+    void
+    start_new_file( );
+
+
+    static void *
+    compress_func( void * arg );
+
+
+    static void
+    compress( std::string const & file_name );
+
+
+    void
+    wait_for_compression( );
+
+
+    // File written to, its name and how much has been written to it
+
+    std::FILE * m_fp;
+
+
+    std::string m_file_name;
+
+
+    unsigned long long m_file_size;
+
+
+    // Maximum size of a file (0 if unlimited), maximum number of old files
+    // kept and what each file starts with
+
+    std::size_t m_max_size;
+
+
+    int m_max_files;
+
+
+    std::string m_header;
+
+
+    // Thread compressing an old file (if there's one)
+
+    pthread_t m_compressor;
+
+
+    bool m_has_compressor;
+
+
+    // Thread doing the writing
+
+    pthread_t m_thread;
+
+
+    bool m_has_thread;
+
+
+    // Mutex and condition variables (for waking up the thread and for
+    // signaling that a block was written) protecting all of the following
+    // members
+
+    pthread_mutex_t m_mutex;
+
+
+    pthread_cond_t m_wakeup;
+
+
+    pthread_cond_t m_written_cond;
+
+
+    // Data waiting to be written
+
+    std::string m_pending;
+
+
+    // Number of bytes passed to write() and number of those written or
+    // dropped
+
+    unsigned long long m_appended;
+
+
+    unsigned long long m_written;
+
+
+    // Number of bytes dropped since the last block was written
+
+    unsigned long long m_dropped;
+
+
+    // Flag, set when someone waits for everything to be written
+
+    bool m_is_urgent;
+
+
+    // Flag, set when the thread is to exit
+
+    bool m_quit;
+};
+
+
+#endif
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
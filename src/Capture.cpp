@@ -0,0 +1,225 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "Capture.hpp"
+#include "Utils.hpp"
+#include <cstring>
+#include <sys/stat.h>
+
+
+namespace
+{
+
+char const Magic[ ] = "PBTCAP1\n";
+std::size_t const Magic_Len = sizeof Magic - 1;
+
+
+/******************************************
+ * Reads a variable length integer, returns false at the end of the file
+ ******************************************/
+
+bool
+read_number( std::FILE         * fp,
+             unsigned long long & n )
+{
+    int c;
+    int shift = 0;
+
+    n = 0;
+
+    do
+    {
+        if ( ( c = std::getc( fp ) ) == EOF || shift > 63 )
+            return false;
+
+        n |= static_cast< unsigned long long >( c & 0x7f ) << shift;
+        shift += 7;
+    } while ( c & 0x80 );
+
+    return true;
+}
+
+}
+
+
+/******************************************
+ ******************************************/
+
+Capture::Capture( )
+    : m_fp( 0 )
+    , m_last( 0 )
+{
+}
+
+
+/******************************************
+ ******************************************/
+
+Capture::~Capture( )
+{
+    close( );
+}
+
+
+/******************************************
+ ******************************************/
+
+bool
+Capture::open( std::string const & file_name )
+{
+    close( );
+
+    // Create all necessary directories (if possible)
+
+    std::string path( Utils::prepare_file_creation( file_name ) );
+
+    if ( path.empty( ) || ! ( m_fp = std::fopen( path.c_str( ), "wb" ) ) )
+        return false;
+
+    if ( std::fwrite( Magic, 1, Magic_Len, m_fp ) != Magic_Len )
+    {
+        close( );
+        return false;
+    }
+
+    m_last = Utils::monotonic_microseconds( );
+    return true;
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+Capture::close( )
+{
+    if ( m_fp )
+        std::fclose( m_fp );
+    m_fp = 0;
+}
+
+
+/******************************************
+ * Writes a record for a chunk. The monotonic clock gets used, so setting
+ * the system time doesn't result in pauses when the capture is replayed.
+ ******************************************/
+
+void
+Capture::add( std::string const & data )
+{
+    if ( ! m_fp )
+        return;
+
+    unsigned long long now = Utils::monotonic_microseconds( );
+
+    write_number( now - m_last );
+    write_number( data.size( ) );
+    std::fwrite( data.data( ), 1, data.size( ), m_fp );
+
+    m_last = now;
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+Capture::write_number( unsigned long long n )
+{
+    do
+    {
+        int c = n & 0x7f;
+        if ( n >>= 7 )
+            c |= 0x80;
+        std::putc( c, m_fp );
+    } while ( n );
+}
+
+
+/******************************************
+ ******************************************/
+
+bool
+Capture::load( std::string const    & file_name,
+               std::vector< Chunk > & chunks )
+{
+    std::FILE * fp = std::fopen( file_name.c_str( ), "rb" );
+    if ( ! fp )
+        return false;
+
+    char magic[ Magic_Len ];
+
+    if (    std::fread( magic, 1, Magic_Len, fp ) != Magic_Len
+         || std::memcmp( magic, Magic, Magic_Len ) )
+    {
+        std::fclose( fp );
+        return false;
+    }
+
+    // The length of a record can't be more than what's left of the file,
+    // otherwise the file is corrupt
+
+    struct stat st;
+    if ( fstat( fileno( fp ), &st ) )
+    {
+        std::fclose( fp );
+        return false;
+    }
+
+    chunks.clear( );
+
+    Chunk chunk;
+    unsigned long long delta,
+                       len;
+
+    chunk.time = 0;
+
+    while ( read_number( fp, delta ) && read_number( fp, len ) )
+    {
+        long pos = std::ftell( fp );
+
+        if ( pos < 0 || len > static_cast< unsigned long long >(
+                                                       st.st_size - pos ) )
+        {
+            std::fclose( fp );
+            return false;
+        }
+
+        chunk.time += delta;
+        chunk.data.resize( len );
+
+        if (    len
+             && std::fread( &chunk.data[ 0 ], 1, len, fp ) != len )
+            break;
+
+        chunks.push_back( chunk );
+    }
+
+    std::fclose( fp );
+    return true;
+}
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,122 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#if ! defined CAPTURE_HPP_
+#define CAPTURE_HPP_
+
+
+#include <string>
+#include <vector>
+#include <cstdio>
+
+
+/******************************************
+ * Class for writing each chunk of output read from the shell, together
+ * with the time it arrived, to a file (and reading such files back in),
+ * so that what happened on a device can be replayed later on.
+ *
+ * The file starts with an 8 byte magic string, followed by a record per
+ * chunk: the time in microseconds since the previous chunk (or opening
+ * the file for the first one) and the length of the chunk, both as
+ * variable length integers (7 bits per byte, least significant first,
+ * the high bit set when more bytes follow), and then the chunk's data.
+ ******************************************/
+
+class Capture
+{
+  public :
+
+    // A chunk read back in, with its time (in microseconds) relative to
+    // the start of the capture
+
+    struct Chunk
+    {
+        unsigned long long time;
+        std::string data;
+    };
+
+
+    Capture( );
+
+
+    ~Capture( );
+
+
+    // Creates the file and writes the header, returns false on failure
+
+    bool
+    open( std::string const & file_name );
+
+
+    void
+    close( );
+
+
+    bool
+    is_open( ) const  { return m_fp != 0; }
+
+
+    // Appends a chunk, stamped with the current time
+
+    void
+    add( std::string const & data );
+
+
+    // Reads in a capture file, returns false if it can't be opened, isn't
+    // a capture file or a record is longer than what's left of the file
+
+    static bool
+    load( std::string const   & file_name,
+          std::vector< Chunk > & chunks );
+
+
+  private :
+
+    // Copying isn't allowed
+
+    Capture( Capture const & );
+
+
+    Capture &
+    operator = ( Capture const & );
+
+
+    void
+    write_number( unsigned long long n );
+
+
+    std::FILE * m_fp;
+
+
+    // Time the previous chunk was written (in microseconds)
+
+    unsigned long long m_last;
+};
+
+
+#endif
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,99 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "Command_History.hpp"
+
+
+/******************************************
+ ******************************************/
+
+Command_History::Command_History( std::size_t max_size )
+    : m_max_size( max_size )
+    , m_version( 0 )
+{
+}
+
+
+/******************************************
+ * An already existing command only needs its pointer in the list to be
+ * moved to the end (splicing doesn't invalidate the iterator stored for
+ * it in the map). Otherwise the oldest command may have to be removed
+ * before the new one can be stored.
+ ******************************************/
+
+void
+Command_History::add( std::string const & cmd )
+{
+    if ( ! m_max_size )
+        return;
+
+    ++m_version;
+    m_search_index.add( cmd );
+
+    Index::iterator it = m_index.find( cmd );
+
+    if ( it != m_index.end( ) )
+    {
+        m_order.splice( m_order.end( ), m_order, it->second );
+        return;
+    }
+
+    if ( m_index.size( ) >= m_max_size )
+    {
+        m_search_index.remove( *m_order.front( ) );
+        m_index.erase( *m_order.front( ) );
+        m_order.pop_front( );
+    }
+
+    it = m_index.insert( Index::value_type( cmd, m_order.end( ) ) ).first;
+    it->second = m_order.insert( m_order.end( ), &it->first );
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+Command_History::clear( )
+{
+    ++m_version;
+    m_order.clear( );
+    m_index.clear( );
+    m_search_index.clear( );
+}
+
+
+/******************************************
+ ******************************************/
+
+std::string
+Command_History::last( ) const
+{
+    return m_order.empty( ) ? "" : *m_order.back( );
+}
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,248 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#if ! defined COMMAND_HISTORY_HPP_
+#define COMMAND_HISTORY_HPP_
+
+
+#include "History_Index.hpp"
+#include <string>
+#include <vector>
+#include <list>
+#include <iterator>
+#include <cstddef>
+#include <tr1/unordered_map>
+
+
+/******************************************
+ * Class for the list of commands sent to the shell, with each command in
+ * it only once and ordered by when it was last used, the oldest first.
+ * When it's full the oldest command gets dropped. The commands are kept
+ * as keys of a hash map, with the order given by a list of pointers to
+ * them, and each map entry knowing where in that list it is. So adding a
+ * command, moving an existing one to the end or dropping the oldest one
+ * all take constant time, independent of the length of the history.
+ * An index for searching the history is kept up to date alongside.
+ ******************************************/
+
+class Command_History
+{
+    typedef std::list< std::string const * > Order;
+
+
+    typedef std::tr1::unordered_map< std::string, Order::iterator > Index;
+
+
+  public :
+
+    // Iterator over the commands, from the oldest to the most recent one
+
+    class const_iterator
+    {
+      public :
+
+        typedef std::bidirectional_iterator_tag iterator_category;
+        typedef std::string                     value_type;
+        typedef std::ptrdiff_t                  difference_type;
+        typedef std::string const *             pointer;
+        typedef std::string const &             reference;
+
+
+        const_iterator( )
+        { }
+
+
+        explicit
+        const_iterator( Order::const_iterator it )
+            : m_it( it )
+        { }
+
+
+        reference
+        operator * ( ) const  { return **m_it; }
+
+
+        pointer
+        operator -> ( ) const  { return *m_it; }
+
+
+        const_iterator &
+        operator ++ ( )  { ++m_it; return *this; }
+
+
+        const_iterator
+        operator ++ ( int )  { return const_iterator( m_it++ ); }
+
+
+        const_iterator &
+        operator -- ( )  { --m_it; return *this; }
+
+
+        const_iterator
+        operator -- ( int )  { return const_iterator( m_it-- ); }
+
+
+        bool
+        operator == ( const_iterator const & other ) const
+        {
+            return m_it == other.m_it;
+        }
+
+
+        bool
+        operator != ( const_iterator const & other ) const
+        {
+            return m_it != other.m_it;
+        }
+
+
+      private :
+
+        Order::const_iterator m_it;
+    };
+
+
+    typedef std::reverse_iterator< const_iterator > const_reverse_iterator;
+
+
+    explicit
+    Command_History( std::size_t max_size );
+
+
+    // Adds a command as the most recent one, removing an earlier entry of
+    // it or, if the history is full, the oldest one
+
+    void
+    add( std::string const & cmd );
+
+
+    // Sets how often a command was used before, for ranking search results
+
+    void
+    set_uses( std::string const & cmd,
+              double              uses )
+    {
+        m_search_index.set_uses( cmd, uses );
+    }
+
+
+    void
+    clear( );
+
+
+    std::size_t
+    size( ) const  { return m_index.size( ); }
+
+
+    bool
+    empty( ) const  { return m_index.empty( ); }
+
+
+    std::size_t
+    max_size( ) const  { return m_max_size; }
+
+
+    // Returns a number that changes whenever the history gets modified
+
+    unsigned long
+    version( ) const  { return m_version; }
+
+
+    // Returns the commands best matching a search text (see History_Index)
+
+    void
+    search( std::string const          & query,
+            std::size_t                  max_results,
+            std::vector< std::string > & results ) const
+    {
+        m_search_index.search( query, max_results, results );
+    }
+
+
+    // Returns the most recent command (or the empty string if there's none)
+
+    std::string
+    last( ) const;
+
+
+    const_iterator
+    begin( ) const  { return const_iterator( m_order.begin( ) ); }
+
+
+    const_iterator
+    end( ) const  { return const_iterator( m_order.end( ) ); }
+
+
+    const_reverse_iterator
+    rbegin( ) const  { return const_reverse_iterator( end( ) ); }
+
+
+    const_reverse_iterator
+    rend( ) const  { return const_reverse_iterator( begin( ) ); }
+
+
+  private :
+
+    // Copying isn't allowed
+
+    Command_History( Command_History const & );
+
+
+    Command_History &
+    operator = ( Command_History const & );
+
+
+    // Maximum number of commands
+
+    std::size_t m_max_size;
+
+
+    // Counter of modifications
+
+    unsigned long m_version;
+
+
+    // Map with the commands as the keys, each with the position of the
+    // pointer to it in the list giving the order
+
+    Index m_index;
+
+
+    // List of pointers to the keys of the map, oldest command first
+
+    Order m_order;
+
+
+    // Index for searching the commands
+
+    History_Index m_search_index;
+};
+
+
+#endif
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
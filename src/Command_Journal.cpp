@@ -0,0 +1,253 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "Command_Journal.hpp"
+#include "Command_History.hpp"
+#include "Async_Writer.hpp"
+#include "Defaults.hpp"
+#include "Metrics.hpp"
+#include "Utils.hpp"
+#include <fstream>
+#include <cstdio>
+
+
+namespace
+{
+
+Metrics::Counter & s_compactions =
+                             Metrics::counter( "command file compactions" );
+
+}
+
+
+/******************************************
+ ******************************************/
+
+Command_Journal::Command_Journal( std::string const & file_name,
+                                  std::size_t         max_history )
+    : m_file_name( file_name )
+    , m_max_history( max_history )
+    , m_entries( 0 )
+    , m_has_thread( false )
+    , m_writer( 0 )
+    , m_is_rewriting( false )
+{
+    pthread_mutex_init( &m_mutex, 0 );
+}
+
+
+/******************************************
+ ******************************************/
+
+Command_Journal::~Command_Journal( )
+{
+    if ( m_has_thread )
+        pthread_join( m_thread, 0 );
+
+    delete m_writer;
+    pthread_mutex_destroy( &m_mutex );
+}
+
+
+/******************************************
+ * Reads in all entries of the file, adding them to the history in the
+ * order they were written - since adding a command takes constant time
+ * this is linear in the length of the file. Afterwards the file is opened
+ * for appending further commands (or rewritten first if it's got too
+ * long).
+ ******************************************/
+
+void
+Command_Journal::load( Command_History & history )
+{
+    history.clear( );
+
+    if ( ! m_max_history )
+        return;
+
+    std::ifstream ifs( m_file_name.c_str( ), std::ifstream::in );
+    std::string line;
+
+    while ( std::getline( ifs, line ) )
+    {
+        // Skip empty lines and comments (lines starting with a hash mark)
+
+        if ( Utils::left_trim( line ).empty( ) || line[ 0 ] == '#' )
+            continue;
+
+        history.add( line );
+        ++m_entries;
+    }
+
+    ifs.close( );
+
+    if ( m_entries > CMD_FILE_COMPACT_FACTOR * m_max_history )
+        compact( history );
+    else
+    {
+        m_writer = new Async_Writer;
+        if ( ! m_writer->append_to( m_file_name ) )
+        {
+            delete m_writer;
+            m_writer = 0;
+        }
+    }
+}
+
+
+/******************************************
+ * Appends a command to the file or, while the file is rewritten, to the
+ * list of commands to be written to it afterwards
+ ******************************************/
+
+void
+Command_Journal::append( std::string     const & cmd,
+                         Command_History const & history )
+{
+    if ( ! m_max_history )
+        return;
+
+    std::string line( cmd + '\n' );
+
+    pthread_mutex_lock( &m_mutex );
+
+    if ( m_writer )
+        m_writer->write( line.data( ), line.size( ) );
+    else if ( m_is_rewriting )
+        m_backlog += line;
+
+    pthread_mutex_unlock( &m_mutex );
+
+    if ( ++m_entries > CMD_FILE_COMPACT_FACTOR * m_max_history )
+        compact( history );
+}
+
+
+/******************************************
+ * Starts rewriting the file with the commands in the history (unless
+ * that's already under way). The object doing the appending gets
+ * deleted first, so the file is closed with everything written to it.
+ ******************************************/
+
+void
+Command_Journal::compact( Command_History const & history )
+{
+    pthread_mutex_lock( &m_mutex );
+
+    if ( m_is_rewriting )
+    {
+        pthread_mutex_unlock( &m_mutex );
+        return;
+    }
+
+    Async_Writer * writer = m_writer;
+    m_writer = 0;
+    m_is_rewriting = true;
+
+    pthread_mutex_unlock( &m_mutex );
+
+    delete writer;
+
+    if ( m_has_thread )
+    {
+        pthread_join( m_thread, 0 );
+        m_has_thread = false;
+    }
+
+    m_snapshot.assign( history.begin( ), history.end( ) );
+    m_entries = m_snapshot.size( );
+    s_compactions.add( );
+
+    if ( pthread_create( &m_thread, 0, thread_func, this ) == 0 )
+        m_has_thread = true;
+    else
+        rewrite( );
+}
+
+
+/******************************************
+ * Function the thread gets started with, just redirects to rewrite()
+ ******************************************/
+
+void *
+Command_Journal::thread_func( void * arg )
+{
+    static_cast< Command_Journal * >( arg )->rewrite( );
+    return 0;
+}
+
+
+/******************************************
+ * Writes the commands in the history to a temporary file that then
+ * replaces the old one, so there's always a complete file. Afterwards
+ * the file gets opened for appending again and the commands sent in
+ * the meantime are written to it.
+ ******************************************/
+
+void
+Command_Journal::rewrite( )
+{
+    std::string path( Utils::prepare_file_creation( m_file_name ) );
+
+    if ( ! path.empty( ) )
+    {
+        std::string tmp_name( path + ".tmp" );
+        std::ofstream ofs( tmp_name.c_str( ), std::ofstream::out );
+
+        for ( std::vector< std::string >::const_iterator
+                                                    it = m_snapshot.begin( );
+              it != m_snapshot.end( ) && ofs.good( ); ++it )
+            ofs << *it << '\n';
+
+        ofs.close( );
+
+        if ( ofs.fail( ) || std::rename( tmp_name.c_str( ), path.c_str( ) ) )
+            std::remove( tmp_name.c_str( ) );
+    }
+
+    m_snapshot.clear( );
+
+    Async_Writer * writer = new Async_Writer;
+    if ( ! writer->append_to( m_file_name ) )
+    {
+        delete writer;
+        writer = 0;
+    }
+
+    pthread_mutex_lock( &m_mutex );
+
+    if ( writer )
+        writer->write( m_backlog.data( ), m_backlog.size( ) );
+    m_backlog.clear( );
+
+    m_writer = writer;
+    m_is_rewriting = false;
+
+    pthread_mutex_unlock( &m_mutex );
+}
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
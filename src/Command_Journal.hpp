@@ -0,0 +1,154 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#if ! defined COMMAND_JOURNAL_HPP_
+#define COMMAND_JOURNAL_HPP_
+
+
+#include <string>
+#include <vector>
+#include <pthread.h>
+
+
+class Async_Writer;
+class Command_History;
+
+
+/******************************************
+ * Class for keeping the file with the command history up to date. Every
+ * command sent to the shell gets appended to the file (one per line)
+ * right away, so the history survives even if the program doesn't exit
+ * normally. Since this leaves duplicates and commands that have dropped
+ * out of the history in the file it gets rewritten with just the current
+ * history once it contains too many entries. That happens in a thread of
+ * its own, commands sent in the meantime are kept and appended to the
+ * new file when it's ready.
+ ******************************************/
+
+class Command_Journal
+{
+  public :
+
+    Command_Journal( std::string const & file_name,
+                     std::size_t         max_history );
+
+
+    // Waits for the file to be rewritten (if that's just being done) and
+    // writes out everything still pending
+
+    ~Command_Journal( );
+
+
+    // Reads in the file, filling the history with the last different
+    // commands in the order they were last used
+
+    void
+    load( Command_History & history );
+
+
+    // Appends a command to the file, rewriting it with the commands
+    // in the history if it has got too long
+
+    void
+    append( std::string     const & cmd,
+            Command_History const & history );
+
+
+  private :
+
+    // Copying or assigning a journal makes no sense
+
+    Command_Journal( Command_Journal const & );
+
+
+    Command_Journal &
+    operator = ( Command_Journal const & );
+
+
+    void
+    compact( Command_History const & history );
+
+
+    static void *
+    thread_func( void * arg );
+
+
+    void
+    rewrite( );
+
+
+    // Name of the file and the maximum length of the history
+
+    std::string m_file_name;
+
+
+    std::size_t m_max_history;
+
+
+    // Number of entries in the file
+
+    std::size_t m_entries;
+
+
+    // Thread rewriting the file (if there's one)
+
+    pthread_t m_thread;
+
+
+    bool m_has_thread;
+
+
+    // Commands the file gets rewritten with
+
+    std::vector< std::string > m_snapshot;
+
+
+    // Mutex protecting the following members (which are changed by the
+    // thread when it's done)
+
+    pthread_mutex_t m_mutex;
+
+
+    // Object doing the writing, 0 while the file is rewritten
+
+    Async_Writer * m_writer;
+
+
+    // Flag, set while the file is rewritten
+
+    bool m_is_rewriting;
+
+
+    // Commands sent while the file is being rewritten
+
+    std::string m_backlog;
+};
+
+
+#endif
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -23,11 +23,37 @@
 #include "Defaults.hpp"
 #include "Utils.hpp"
 #include <fstream>
+#include <sstream>
 #include <limits>
 #include <algorithm>
+#include <set>
 #include "Inkview.hpp"
 
 
+namespace
+{
+
+// Settings that take effect immediately when changed in the configuration
+// file while the program is running
+
+char const * const Live_Settings[ ] = { "check_interval",
+                                        "zoom_preview" };
+
+
+bool
+is_live( std::string const & key )
+{
+    for ( std::size_t i = 0;
+          i < sizeof Live_Settings / sizeof *Live_Settings; ++i )
+        if ( key == Live_Settings[ i ] )
+            return true;
+
+    return false;
+}
+
+}
+
+
 /******************************************
  ******************************************/
 
@@ -38,26 +64,51 @@ Config::Config( Logger & logger )
     , m_font_name(           DEFAULTFONTM              )
     , m_default_font_size(   DEFAULT_FONT_SIZE         )
     , m_font_step(           FONT_STEP                 )
+    , m_zoom_preview(        ZOOM_PREVIEW              )
     , m_line_spacing(        LINE_SPACING              )
     , m_tab_width(           TAB_WIDTH                 )
     , m_max_history(         DEFAULT_MAX_CMD_HISTORY   )
+    , m_suggestions(         DEFAULT_SUGGESTIONS       )
     , m_max_lines(           DEFAULT_MAX_DISPLAY_LINES )
+    , m_max_scrollback_bytes( DEFAULT_MAX_SCROLLBACK_BYTES )
+    , m_max_line_length(     DEFAULT_MAX_LINE_LENGTH   )
     , m_shell(               SHELL_PATH                )
     , m_cmd_file(            DEFAULT_CMD_FILE          )
     , m_log_file(            DEFAULT_LOG_FILE          )
     , m_keyboard_file(       KEYBOARD_FILE             ) 
     , m_user_cmd_file(       USER_CMD_FILE             )
+    , m_trace_latency(       TRACE_LATENCY             )
+    , m_stats_interval(      STATS_INTERVAL            )
+    , m_stats_file(          DEFAULT_STATS_FILE        )
+    , m_frame_profile(       FRAME_PROFILE             )
+    , m_frame_profile_file(  DEFAULT_FRAME_PROFILE_FILE )
+    , m_recording_file(      DEFAULT_RECORDING_FILE    )
+    , m_log_max_size(        LOG_MAX_SIZE              )
+    , m_log_max_files(       LOG_MAX_FILES             )
+    , m_recording_max_size(  RECORDING_MAX_SIZE        )
+    , m_recording_max_files( RECORDING_MAX_FILES       )
 {
     // Try to read in the configuration file
 
     parse_cfg_file( );
 
+    // The limits for the log file are needed before it gets opened
+
+    checked_int( "log_max_size", 0, std::numeric_limits< int >::max( ) / 1024,
+                 m_log_max_size );
+    checked_int( "log_max_files", 0, 99, m_log_max_files );
+
     set_up_logger( );
     checked_font( );
     checked_shell( );
     checked_cmd_file( );
     checked_keyboard_file( );
     checked_user_cmd_file( );
+    checked_capture_file( );
+    checked_latency_file( );
+    checked_stats_file( );
+    checked_frame_profile_file( );
+    checked_recording_file( );
 
     // Check for integer settings from the configuration file
 
@@ -65,13 +116,26 @@ Config::Config( Logger & logger )
     checked_int( "check_interval", 50, 10000, m_check_interval );
     checked_int( "font_size", 6, 72, m_default_font_size );
     checked_int( "font_step", 1, 10, m_font_step );
+    checked_bool( "zoom_preview", m_zoom_preview );
     checked_int( "line_spacing", - m_default_font_size, 100,
                  m_line_spacing );
     checked_int( "tab_width", 2, 8, m_tab_width );
     checked_int( "max_history", 0, std::numeric_limits< int >::max( ),
                  m_max_history );
+    checked_int( "suggestions", 0, 50, m_suggestions );
     checked_int( "max_lines", 20, std::numeric_limits< int >::max( ),
                  m_max_lines );
+    checked_int( "max_scrollback_bytes", 0,
+                 std::numeric_limits< int >::max( ), m_max_scrollback_bytes );
+    checked_int( "max_line_length", 0, std::numeric_limits< int >::max( ),
+                 m_max_line_length );
+    checked_bool( "trace_latency", m_trace_latency );
+    checked_int( "stats_interval", 0, 86400, m_stats_interval );
+    checked_int( "frame_profile", 0, 100000, m_frame_profile );
+    checked_int( "recording_max_size", 0,
+                 std::numeric_limits< int >::max( ) / 1024,
+                 m_recording_max_size );
+    checked_int( "recording_max_files", 0, 99, m_recording_max_files );
 
     for ( std::map< std::string, std::string >::iterator it = m_cfg.begin( );
           it != m_cfg.end( ); ++it )
@@ -81,14 +145,19 @@ Config::Config( Logger & logger )
 
 
 /******************************************
+ * Reads the key-value pairs from a configuration file, with what's wrong
+ * with it returned as messages instead of being logged (it may be called
+ * from another thread)
  ******************************************/
 
 void
-Config::parse_cfg_file( )
+Config::read_settings( std::string const          & file_name,
+                       Settings                   & settings,
+                       std::vector< std::string > & problems )
 {
     // Try to open the configuration file for reading
 
-    std::ifstream ifs( CONFIG_FILE, std::ifstream::in );
+    std::ifstream ifs( file_name.c_str( ), std::ifstream::in );
 
     std::string  line;
     int cnt = 0;
@@ -117,8 +186,10 @@ Config::parse_cfg_file( )
         std::size_t n = line.find( ':' );
         if ( n == std::string::npos )
         {
-            m_logger.warn( ) << "Line " << cnt << " of configuration file "
-                             << "is invalid (missing colon)" << std::endl;
+            std::ostringstream os;
+            os << "Line " << cnt << " of configuration file "
+               << "is invalid (missing colon)";
+            problems.push_back( os.str( ) );
             continue;
         }
 
@@ -127,8 +198,10 @@ Config::parse_cfg_file( )
 
         if ( key.empty( ) )
         {
-            m_logger.warn( ) << "Missing keyword on line " << cnt
-                             << " of configuration file" << std::endl;
+            std::ostringstream os;
+            os << "Missing keyword on line " << cnt
+               << " of configuration file";
+            problems.push_back( os.str( ) );
             continue;
         }
 
@@ -138,15 +211,99 @@ Config::parse_cfg_file( )
         std::transform( key.begin(), key.end(),
                         key.begin(), ::tolower );
 
-        if ( m_cfg.find( key ) != m_cfg.end( ) )
+        if ( settings.find( key ) != settings.end( ) )
         {
-            m_logger.warn( ) << "Redefinition of keyword '" << key
-                             << " on line " << cnt
-                             << " of configuration file, skipped" << std::endl;
+            std::ostringstream os;
+            os << "Redefinition of keyword '" << key << " on line " << cnt
+               << " of configuration file, skipped";
+            problems.push_back( os.str( ) );
         }
 
-        m_cfg[ key ] = val;
+        settings[ key ] = val;
+    }
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+Config::parse_cfg_file( )
+{
+    std::vector< std::string > problems;
+
+    read_settings( CONFIG_FILE, m_cfg, problems );
+    m_settings = m_cfg;
+
+    for ( std::size_t i = 0; i < problems.size( ); ++i )
+        m_logger.warn( ) << problems[ i ] << std::endl;
+}
+
+
+/******************************************
+ * Parses a configuration file for the file watcher
+ ******************************************/
+
+File_Content *
+Config::parse_file( std::string const & file_name )
+{
+    File_Settings * fs = new File_Settings;
+    read_settings( file_name, fs->settings, fs->problems );
+    return fs;
+}
+
+
+/******************************************
+ * Takes over the settings from a reparsed configuration file. Only some
+ * of them can be changed while the program is running, for the others
+ * the user gets told that a restart is needed.
+ ******************************************/
+
+void
+Config::update( File_Settings const & file_settings )
+{
+    Settings const & settings = file_settings.settings;
+
+    if ( settings == m_settings )
+        return;
+
+    for ( std::size_t i = 0; i < file_settings.problems.size( ); ++i )
+        m_logger.warn( ) << file_settings.problems[ i ] << std::endl;
+
+    std::set< std::string > keys;
+
+    for ( Settings::const_iterator it = m_settings.begin( );
+          it != m_settings.end( ); ++it )
+        keys.insert( it->first );
+    for ( Settings::const_iterator it = settings.begin( );
+          it != settings.end( ); ++it )
+        keys.insert( it->first );
+
+    for ( std::set< std::string >::const_iterator it = keys.begin( );
+          it != keys.end( ); ++it )
+    {
+        Settings::const_iterator o = m_settings.find( *it );
+        Settings::const_iterator n = settings.find( *it );
+
+        if (    ( o == m_settings.end( ) ) == ( n == settings.end( ) )
+             && ( o == m_settings.end( ) || o->second == n->second ) )
+            continue;
+
+        if ( ! is_live( *it ) )
+            m_logger.warn( ) << "Change of keyword '" << *it << "' in "
+                             << "configuration file only takes effect "
+                             << "after a restart" << std::endl;
     }
+
+    m_settings = settings;
+    m_cfg      = settings;
+
+    m_check_interval = DEFAULT_CHECK_INTERVAL;
+    checked_int( "check_interval", 50, 10000, m_check_interval );
+    m_zoom_preview = ZOOM_PREVIEW;
+    checked_bool( "zoom_preview", m_zoom_preview );
+
+    m_cfg.clear( );
 }
 
 
@@ -259,6 +416,74 @@ Config::checked_user_cmd_file( )
 }
 
 
+/******************************************
+ ******************************************/
+
+void
+Config::checked_capture_file( )
+{
+    m_capture_file = get_cleaned_string( "capture_file" );
+    m_cfg.erase( "capture_file" );
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+Config::checked_latency_file( )
+{
+    m_latency_file = get_cleaned_string( "latency_file" );
+    m_cfg.erase( "latency_file" );
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+Config::checked_stats_file( )
+{
+    std::string stats_file( get_cleaned_string( "stats_file" ) );
+
+    if ( ! stats_file.empty( ) )
+        m_stats_file = stats_file;
+
+    m_cfg.erase( "stats_file" );
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+Config::checked_frame_profile_file( )
+{
+    std::string frame_profile_file(
+                               get_cleaned_string( "frame_profile_file" ) );
+
+    if ( ! frame_profile_file.empty( ) )
+        m_frame_profile_file = frame_profile_file;
+
+    m_cfg.erase( "frame_profile_file" );
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+Config::checked_recording_file( )
+{
+    std::string recording_file( get_cleaned_string( "recording_file" ) );
+
+    if ( ! recording_file.empty( ) )
+        m_recording_file = recording_file;
+
+    m_cfg.erase( "recording_file" );
+}
+
+
 /******************************************
  ******************************************/
 
@@ -269,13 +494,16 @@ Config::set_up_logger( )
 
     // If user defined log file can't be opened use the default one
 
-    if ( log_file.empty( ) || ! m_logger.set_file( log_file ) )
+    std::size_t max_size = m_log_max_size * 1024UL;
+
+    if (    log_file.empty( )
+         || ! m_logger.set_file( log_file, max_size, m_log_max_files ) )
     {
         if ( ! log_file.empty( ) )
             m_logger.warn( ) << "Can't open log file '" << log_file
                              << "' requested in configuration file"
                              << std::endl;
-        m_logger.set_file( m_log_file );
+        m_logger.set_file( m_log_file, max_size, m_log_max_files );
     }
 
     m_cfg.erase( "log_file" );
@@ -350,6 +578,21 @@ Config::checked_int( std::string const & name,
 }
 
 
+/******************************************
+ * Checks and sets a property named 'name' that can only be switched
+ * on or off (i.e. must be either 0 or 1)
+ ******************************************/
+
+void
+Config::checked_bool( std::string const & name,
+                      bool              & what )
+{
+    int tmp = what;
+    checked_int( name, 0, 1, tmp );
+    what = tmp;
+}
+
+
 /*
  * Local variables:
  * tab-width: 4
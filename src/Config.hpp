@@ -23,8 +23,10 @@
 
 
 #include <string>
+#include <vector>
 #include <map>
 #include <iostream>
+#include "File_Watcher.hpp"
 #include "Inkview.hpp"
 
 
@@ -40,11 +42,37 @@ class Config
 {
   public :
 
+    typedef std::map< std::string, std::string > Settings;
+
+
+    // What the file watcher makes of the configuration file: the settings
+    // and messages about problems found
+
+    struct File_Settings : public File_Content
+    {
+        Settings settings;
+        std::vector< std::string > problems;
+    };
+
+
     // Constructor
 
     Config( Logger & logger );
 
 
+    // Parses a configuration file (may be called from another thread)
+
+    static File_Content *
+    parse_file( std::string const & file_name );
+
+
+    // Takes over the settings from a reparsed configuration file (as far
+    // as they can be changed while the program is running)
+
+    void
+    update( File_Settings const & file_settings );
+
+
     int
     default_orientation( ) const  { return m_default_orientation; }
 
@@ -67,6 +95,10 @@ class Config
     font_step( ) const  { return m_font_step; }
 
 
+    bool
+    zoom_preview( ) const  { return m_zoom_preview; }
+
+
     int
     line_spacing( ) const  { return m_line_spacing; }
 
@@ -79,10 +111,22 @@ class Config
     max_history( ) const  { return m_max_history; }
 
 
+    int
+    suggestions( ) const  { return m_suggestions; }
+
+
     int
     max_lines( ) const  { return m_max_lines; }
 
 
+    int
+    max_scrollback_bytes( ) const  { return m_max_scrollback_bytes; }
+
+
+    int
+    max_line_length( ) const  { return m_max_line_length; }
+
+
     // Returns the name of the shell to be used
 
     std::string const &
@@ -107,6 +151,63 @@ class Config
     keyboard_file( ) const  { return m_keyboard_file; }
 
 
+    // Returns the name of the file shell output gets captured to (empty
+    // if capturing is off)
+
+    std::string const &
+    capture_file( ) const  { return m_capture_file; }
+
+
+    bool
+    trace_latency( ) const  { return m_trace_latency; }
+
+
+    // Returns the name of the file the latencies get written to (empty
+    // if they're to go to the log file)
+
+    std::string const &
+    latency_file( ) const  { return m_latency_file; }
+
+
+    // Returns the time (in s) between writes of the statistics file (0 if
+    // it's not to be written)
+
+    int
+    stats_interval( ) const  { return m_stats_interval; }
+
+
+    std::string const &
+    stats_file( ) const  { return m_stats_file; }
+
+
+    // Returns the number of frames to be profiled (0 if none) and the
+    // name of the file the profile gets written to
+
+    int
+    frame_profile( ) const  { return m_frame_profile; }
+
+
+    std::string const &
+    frame_profile_file( ) const  { return m_frame_profile_file; }
+
+
+    // Returns the name of the file sessions get recorded to
+
+    std::string const &
+    recording_file( ) const  { return m_recording_file; }
+
+
+    // Returns the maximum size (in KB) of a recording file and the number
+    // of older ones kept
+
+    int
+    recording_max_size( ) const  { return m_recording_max_size; }
+
+
+    int
+    recording_max_files( ) const  { return m_recording_max_files; }
+
+
     Logger &
     logger( )  { return m_logger; }
 
@@ -119,6 +220,12 @@ class Config
     parse_cfg_file( );
 
 
+    static void
+    read_settings( std::string const          & file_name,
+                   Settings                   & settings,
+                   std::vector< std::string > & problems );
+
+
     // Sets up the font name
 
     void
@@ -149,6 +256,36 @@ class Config
     checked_user_cmd_file( );
 
 
+    // Gets the name of the file for capturing shell output
+
+    void
+    checked_capture_file( );
+
+
+    // Gets the name of the file for writing latencies to
+
+    void
+    checked_latency_file( );
+
+
+    // Gets the name of the file for writing statistics to
+
+    void
+    checked_stats_file( );
+
+
+    // Gets the name of the file for writing the frame profile to
+
+    void
+    checked_frame_profile_file( );
+
+
+    // Gets the name of the file for recording sessions
+
+    void
+    checked_recording_file( );
+
+
     // Switches logger to use a file for  logging
 
     void
@@ -170,6 +307,13 @@ class Config
                  int               & what );
 
 
+    // Checks and sets a boolean property named 'name'
+
+    void
+    checked_bool( std::string const & name,
+                  bool              & what );
+
+
     // Logger object
 
     Logger & m_logger;
@@ -180,6 +324,11 @@ class Config
     std::map< std::string, std::string > m_cfg;
 
 
+    // Settings as read from the configuration file
+
+    Settings m_settings;
+
+
     // Default orientation
 
     int m_default_orientation;
@@ -205,6 +354,11 @@ class Config
     int m_font_step;
 
 
+    // Flag, set when a quick preview is to be shown on font size changes
+
+    bool m_zoom_preview;
+
+
     // Distance between lines (in pixel)
 
     int m_line_spacing;
@@ -220,11 +374,26 @@ class Config
     int m_max_history;
 
 
+    // Number of commands to suggest
+
+    int m_suggestions;
+
+
     // Maximum number of lines the Display object remembers
 
     int m_max_lines;
 
 
+    // Maximum number of bytes the lines may use (0 for no limit)
+
+    int m_max_scrollback_bytes;
+
+
+    // Maximum length of a single line (0 for no limit)
+
+    int m_max_line_length;
+
+
     // Shell to be used
 
     std::string m_shell;
@@ -248,6 +417,61 @@ class Config
     // File for commonly used commands
 
     std::string m_user_cmd_file;
+
+
+    // File for capturing the output of the shell
+
+    std::string m_capture_file;
+
+
+    // Flag, set when the latencies of commands are to be measured
+
+    bool m_trace_latency;
+
+
+    // File the latencies get written to at the end
+
+    std::string m_latency_file;
+
+
+    // Time (in s) between writes of the statistics file
+
+    int m_stats_interval;
+
+
+    // File the statistics get written to
+
+    std::string m_stats_file;
+
+
+    // Number of frames kept by the frame profiler (0 if it's off)
+
+    int m_frame_profile;
+
+
+    // Name of the file the frame profile gets written to
+
+    std::string m_frame_profile_file;
+
+
+    // Name of the file sessions get recorded to
+
+    std::string m_recording_file;
+
+
+    // Maximum sizes (in KB) of the log and recording file (0 for no limit)
+    // and the number of older ones kept for each
+
+    int m_log_max_size;
+
+
+    int m_log_max_files;
+
+
+    int m_recording_max_size;
+
+
+    int m_recording_max_files;
 };
 
 
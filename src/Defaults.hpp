@@ -63,6 +63,23 @@
 #define MAX_FONT_SIZE  72
 
 
+// Time (in ms) the program must be idle before the fonts next to the one
+// in use get opened and prepared
+
+#define FONT_IDLE_DELAY  250
+
+
+// Per default no preview is shown while the font size is changed
+
+#define ZOOM_PREVIEW  0
+
+
+// Time (in ms) a zoom preview is shown before the display gets redrawn
+// completely with the new font size
+
+#define ZOOM_PREVIEW_DELAY  600
+
+
 // Additional spacing betwen lines (in pixel
 
 #define LINE_SPACING 0
@@ -73,24 +90,74 @@
 #define TAB_WIDTH  4
 
 
-// Name of the shell to be used
+// Name of the shell to be used (can be set differently when building)
 
+#if ! defined SHELL_PATH
 #define SHELL_PATH  "/bin/ash"
+#endif
+
+
+// Directory with the system files of the reader (can be set differently
+// when building, e.g. for the headless build)
+
+#if ! defined SYSTEM_DIR
+#define SYSTEM_DIR  "/mnt/ext1/system"
+#endif
 
 
 // Name of the configuration file
 
-#define CONFIG_FILE  "/mnt/ext1/system/config/" APP_NAME ".cfg"
+#define CONFIG_FILE  SYSTEM_DIR "/config/" APP_NAME ".cfg"
 
 
 // Default name of log file
 
-#define DEFAULT_LOG_FILE  "/mnt/ext1/system/share/" APP_NAME "/" APP_NAME ".log"
+#define DEFAULT_LOG_FILE  SYSTEM_DIR "/share/" APP_NAME "/" APP_NAME ".log"
 
 
 // Default name of command file
 
-#define DEFAULT_CMD_FILE  "/mnt/ext1/system/share/" APP_NAME "/" APP_NAME ".cmd"
+#define DEFAULT_CMD_FILE  SYSTEM_DIR "/share/" APP_NAME "/" APP_NAME ".cmd"
+
+
+// Size of the font used for text shown on top of the display (like the
+// statistics)
+
+#define OVERLAY_FONT_SIZE  14
+
+
+// Default name of the file statistics get written to and the time (in s)
+// between writes (0 means not at all)
+
+#define DEFAULT_STATS_FILE  SYSTEM_DIR "/share/" APP_NAME "/" APP_NAME ".stats"
+#define STATS_INTERVAL      0
+
+
+// Per default the latencies of commands aren't measured
+
+#define TRACE_LATENCY  0
+
+
+// Default name of the file the frame profile gets written to and the
+// number of frames recorded (0 means none)
+
+#define DEFAULT_FRAME_PROFILE_FILE \
+                           SYSTEM_DIR "/share/" APP_NAME "/" APP_NAME ".frames"
+#define FRAME_PROFILE      0
+
+
+// Default name of the file sessions get recorded to
+
+#define DEFAULT_RECORDING_FILE \
+                             SYSTEM_DIR "/share/" APP_NAME "/" APP_NAME ".cast"
+
+
+// When playing back a recording pauses longer than this (in ms) get
+// shortened to it and events less than this time (in ms) apart get
+// shown together
+
+#define PLAYBACK_MAX_IDLE        2000
+#define PLAYBACK_FRAME_INTERVAL    40
 
 
 // Maximum length of command a user may enter (including trailing '\0')
@@ -103,11 +170,54 @@
 #define DEFAULT_MAX_CMD_HISTORY  50
 
 
+// The command file gets rewritten with just the history once it contains
+// this many times as many entries as the history may have
+
+#define CMD_FILE_COMPACT_FACTOR   2
+
+
+// Maximum number of matches shown when searching the command history
+
+#define HISTORY_SEARCH_RESULTS   20
+
+
+// Number of commands shown per page of the "Prev. commands" menu
+
+#define HISTORY_PAGE_SIZE        20
+
+
+// Default number of commands suggested (0 switches suggestions off)
+
+#define DEFAULT_SUGGESTIONS       8
+
+
+// Time (in seconds) after which a use of a command counts only half as
+// much for suggesting it, number of commands at the start of a session
+// counted as being used "early" in a session and after how many commands
+// the usage statistics get saved
+
+#define USAGE_HALF_LIFE        ( 3 * 24 * 3600 )
+#define USAGE_EARLY_COMMANDS    3
+#define USAGE_SAVE_INTERVAL     10
+
+
 // Maximum number of display lines to keep for scrolling
 
 #define DEFAULT_MAX_DISPLAY_LINES  1024
 
 
+// Maximum number of bytes of memory the lines kept for scrolling may use
+// (0 means no limit)
+
+#define DEFAULT_MAX_SCROLLBACK_BYTES  ( 4 * 1024 * 1024 )
+
+
+// Maximum length (in bytes) of a single line, longer ones get cut off
+// (0 means they're kept complete)
+
+#define DEFAULT_MAX_LINE_LENGTH  0
+
+
 // Radius (in pixel) the pointer must stay in to be recognized as a tap
 // and not as a swipe guesture
 
@@ -130,6 +240,77 @@
 #define CONTINUATION_SYMBOL_WIDTH  10
 
 
+// When all lines must be recalculated (due to a rotation or font change)
+// only the lines filling this many screens are dealt with immediately...
+
+#define RELAYOUT_SYNC_SCREENS  2
+
+
+// ...and, if there are at least that many lines left, the rest gets
+// handed to a worker thread
+
+#define RELAYOUT_MIN_LINES  256
+
+
+// Number of lines the worker thread processes before passing them on
+
+#define RELAYOUT_BLOCK_SIZE  256
+
+
+// Time (in ms) between checks for lines finished by the worker thread
+
+#define RELAYOUT_POLL_INTERVAL  50
+
+
+// Time (in ms) between screen updates while the user is scrolling (pointer
+// movements in between get combined)
+
+#define SCROLL_FRAME_INTERVAL  100
+
+
+// Number of screens above and below the visible area for which lines get
+// set up while scrolling
+
+#define SCROLL_PREFETCH_SCREENS  1
+
+
+// Time span (in ms) at the end of a swipe used for determining its speed
+
+#define FLING_VELOCITY_WINDOW  150
+
+
+// Minimum speed (in pixels per second) at the end of a swipe for the
+// display to continue scrolling by itself, speed (in percent) remaining
+// after each frame and speed at which scrolling stops
+
+#define FLING_MIN_SPEED   600
+#define FLING_DECAY        80
+#define FLING_STOP_SPEED  150
+
+
+// The log file gets written to by a thread of its own: it writes out what
+// was logged once there are that many bytes or the oldest of them has
+// waited this long (in ms)...
+
+#define LOG_FLUSH_SIZE      32768
+#define LOG_FLUSH_INTERVAL   2000
+
+
+// ...and if writing falls behind by more than this many bytes (e.g. while
+// recording lots of output to slow storage) further data are dropped
+
+#define LOG_MAX_PENDING  ( 1024 * 1024 )
+
+
+// Maximum sizes (in KB) of the log and recording file (0 for no limit)
+// and the number of older (compressed) files kept for each
+
+#define LOG_MAX_SIZE         1024
+#define LOG_MAX_FILES           3
+#define RECORDING_MAX_SIZE  16384
+#define RECORDING_MAX_FILES     3
+
+
 // x- and y-margins of display
 
 #define X_MARGIN  10
@@ -138,12 +319,12 @@
 
 // Default name of the custom keyboard layout file 
 
-#define KEYBOARD_FILE "/mnt/ext1/system/share/pbterm/pbterm.kbd"
+#define KEYBOARD_FILE  SYSTEM_DIR "/share/" APP_NAME "/" APP_NAME ".kbd"
 
 
 // File to look for that contain commands put there by the user
 
-#define USER_CMD_FILE "/mnt/ext1/system/share/pbterm/user.cmd"
+#define USER_CMD_FILE  SYSTEM_DIR "/share/" APP_NAME "/user.cmd"
 
 
 #endif
@@ -24,6 +24,28 @@
 #include "Logger.hpp"
 #include "Utils.hpp"
 #include "Defaults.hpp"
+#include "Metrics.hpp"
+#include "Alloc_Profile.hpp"
+#include <sstream>
+#include <fstream>
+#include <algorithm>
+
+
+// Definition of the static member used to find the Display instance
+// from within static member functions
+
+Display * Display::s_handling_display;
+
+
+// Metrics about complete redraws
+
+namespace
+{
+
+Metrics::Counter & s_redraws   = Metrics::counter( "redraws" );
+Histogram & s_redraw_time      = Metrics::histogram( "redraw time (us)" );
+
+}
 
 
 /******************************************
@@ -32,29 +54,45 @@
 
 Display::Display( Messenger & mess,
                   Config    & config )
-    : m_font_name( config.font_name( ) )
+    : m_mess( mess )
     , m_font_size( config.default_font_size( ) )
     , m_orientation( GetOrientation( ) )
     , m_initial_orientation( m_orientation )
     , m_width( ScreenWidth( ) )
-    , m_font( 0 )
+    , m_font_name( config.font_name( ) )
+    , m_fonts( config.font_name( ), m_font_size, config.font_step( ) )
     , m_lines( m_font_size, config.line_spacing( ), config.tab_width( ),
-               X_MARGIN, Y_MARGIN, config.max_lines( ) )
+               X_MARGIN, Y_MARGIN, config.max_lines( ),
+               config.max_scrollback_bytes( ), config.max_line_length( ) )
+    , m_is_grid_mode( false )
+    , m_is_alt_screen( false )
+    , m_is_mode_changed( false )
     , m_is_output_suspended( false )
     , m_is_redraw_needed( false )
     , m_is_recording( false )
+    , m_zoom_preview( config.zoom_preview( ) )
+    , m_is_zoom_pending( false )
+    , m_overlay_font( 0 )
+    , m_profiler( config.frame_profile( ) )
+    , m_frame_profile_file( config.frame_profile_file( ) )
 {
+    s_handling_display = this;
+
     OpenScreen( );
 
-    if ( ! ( m_font = OpenFont( m_font_name.c_str( ), m_font_size, 1 ) ) )
+    if ( ! m_fonts.font( ) )
     {
-        config.logger( ).error( ) << "Can't open font '" << m_font_name
+        config.logger( ).error( ) << "Can't open font '"
+                                  << config.font_name( )
                                   << "' with size of " << m_font_size
                                   << std::endl;
         mess.send( message::Close( ) );
         return;
     }
 
+    m_lines.set_char_widths( m_fonts.char_widths( ) );
+    set_grid_geometry( );
+
     // Set orientation only after font has been set, the font is needed in
     // the rotate() method
 
@@ -63,16 +101,20 @@ Display::Display( Messenger & mess,
 
 
 /******************************************
- * Destructor, switches back to original orientation and "frees" font
+ * Destructor, switches back to original orientation (the fonts get
+ * closed by the font manager)
  ******************************************/
 
 Display::~Display( )
 {
+    ClearTimer( &Display::static_zoom_handler );
+    ClearTimer( &Display::static_relayout_handler );
+
     if ( m_orientation != m_initial_orientation )
         SetOrientation( m_initial_orientation );
 
-    if ( m_font )
-        CloseFont( m_font );
+    if ( m_overlay_font )
+        CloseFont( m_overlay_font );
 }
 
     
@@ -92,35 +134,194 @@ Display::redraw( )
         return;
     }
 
+    if ( m_is_zoom_pending )
+        commit_font_size( );
+
+    Alloc_Profile::Scope scope( Alloc_Profile::Redraw );
+    unsigned long long start = Utils::microseconds( );
+
+    m_profiler.begin_frame( Frame_Profiler::Full_Redraw, m_font_size );
+
     ClearScreen( );
-    SetFont( m_font, BLACK );
+    m_profiler.end_phase( Frame_Profiler::Clear );
+    SetFont( m_fonts.font( ), BLACK );
 
-    // Get all (visible) lines to redraw themselves
+    // Get all (visible) lines to redraw themselves (after making sure that
+    // none of them is still waiting for its wrapping to be calculated),
+    // or, in grid mode, all the cells
 
-    m_lines.redraw( );
+    m_is_mode_changed = false;
+
+    if ( m_is_grid_mode )
+        m_grid.redraw( m_fonts.font( ) );
+    else
+    {
+        m_lines.prepare_visible( );
+        m_lines.redraw( );
+    }
+
+    draw_recording_mark( );
+    draw_overlay( );
+    m_profiler.end_phase( Frame_Profiler::Draw );
+    m_mess.send( message::Trace_Point( message::Trace_Point::Screen_Updated ) );
+    SoftUpdate( );
+    m_profiler.end_phase( Frame_Profiler::Update );
+    m_profiler.end_frame( );
+
+    s_redraws.add( );
+    s_redraw_time.add( Utils::microseconds( ) - start );
+}
+
+
+/******************************************
+ * Shows a box with some text (e.g. statistics) on top of everything else
+ * until hide_overlay() gets called
+ ******************************************/
 
-    // Draw a little triangle in the upper right hand corner while recording
-    // is switched on
+void
+Display::show_overlay( std::string const & text )
+{
+    m_overlay = text;
+    Repaint( );
+}
+
+
+/******************************************
+ * Removes the box shown by show_overlay(), returns false if there's none
+ ******************************************/
 
-    if ( m_is_recording )
+bool
+Display::hide_overlay( )
+{
+    if ( m_overlay.empty( ) )
+        return false;
+
+    m_overlay.clear( );
+    Repaint( );
+    return true;
+}
+
+
+/******************************************
+ * Writes all frames the frame profiler has recorded to the file for it
+ * and shows a summary of the times on the screen
+ ******************************************/
+
+void
+Display::dump_frame_profile( )
+{
+    std::ostringstream os;
+
+    if ( ! m_profiler.is_enabled( ) )
     {
-        int size   = 20,
-            offset = 10;
+        show_overlay( "Frame profiling is switched off, set 'frame_profile'\n"
+                      "in the configuration file to switch it on.\n\n"
+                      "(Tap to close this window)" );
+        return;
+    }
 
-        int x  = m_width - offset - size,
-            y1 = offset,
-            y2 = offset + size;
+    m_profiler.write_summary( os );
 
-        while ( y1 < y2 )
-        {
-            DrawLine( x, y1,   x, y2, BLACK );
-            x++;
-            DrawLine( x, y1++, x, y2--, BLACK );
-            x++;
-        }
+    std::string path( Utils::prepare_file_creation( m_frame_profile_file ) );
+    std::ofstream ofs;
+
+    if ( ! path.empty( ) )
+        ofs.open( path.c_str( ) );
+
+    if ( ofs.is_open( ) )
+    {
+        m_profiler.write_summary( ofs );
+        ofs << '\n';
+        m_profiler.write( ofs );
+        ofs.close( );
     }
 
-    SoftUpdate( );
+    if ( ofs.fail( ) || path.empty( ) )
+        os << "\nWriting '" << m_frame_profile_file << "' failed\n";
+    else
+        os << "\nAll frames written to '" << path << "'\n";
+
+    show_overlay( os.str( ) + "\n(Tap to close this window)" );
+}
+
+
+/******************************************
+ * Draws the box with the overlay text (if there's one), using a font
+ * small enough to fit a reasonable number of lines. The font is kept
+ * open since the overlay may get redrawn many times.
+ ******************************************/
+
+void
+Display::draw_overlay( )
+{
+    if ( m_overlay.empty( ) )
+        return;
+
+    if (    ! m_overlay_font
+         && ! ( m_overlay_font = OpenFont( m_font_name.c_str( ),
+                                           OVERLAY_FONT_SIZE, 1 ) ) )
+        return;
+
+    std::vector< std::string > lines;
+    std::istringstream is( m_overlay );
+    std::string line;
+
+    while ( std::getline( is, line ) )
+        lines.push_back( line );
+
+    int line_height = OVERLAY_FONT_SIZE + OVERLAY_FONT_SIZE / 4;
+    int x = X_MARGIN,
+        y = Y_MARGIN,
+        w = ScreenWidth( ) - 2 * X_MARGIN,
+        h = ScreenHeight( ) - 2 * Y_MARGIN;
+
+    // Drop lines that don't fit and shrink the box to what's left
+
+    std::size_t max_lines = std::max( h - 2 * X_MARGIN, 0 ) / line_height;
+    if ( lines.size( ) > max_lines )
+        lines.resize( max_lines );
+    h = lines.size( ) * line_height + 2 * X_MARGIN;
+
+    FillArea( x, y, w, h, WHITE );
+    DrawLine( x, y, x + w - 1, y, BLACK );
+    DrawLine( x, y + h - 1, x + w - 1, y + h - 1, BLACK );
+    DrawLine( x, y, x, y + h - 1, BLACK );
+    DrawLine( x + w - 1, y, x + w - 1, y + h - 1, BLACK );
+
+    SetFont( m_overlay_font, BLACK );
+    for ( std::size_t i = 0; i < lines.size( ); ++i )
+        DrawString( x + X_MARGIN, y + X_MARGIN + i * line_height,
+                    lines[ i ].c_str( ) );
+
+    SetFont( m_fonts.font( ), BLACK );
+}
+
+
+/******************************************
+ * Draws a little triangle in the upper right hand corner while recording
+ * is switched on
+ ******************************************/
+
+void
+Display::draw_recording_mark( )
+{
+    if ( ! m_is_recording )
+        return;
+
+    int size   = 20,
+        offset = 10;
+
+    int x  = m_width - offset - size,
+        y1 = offset,
+        y2 = offset + size;
+
+    while ( y1 < y2 )
+    {
+        DrawLine( x, y1,   x, y2, BLACK );
+        x++;
+        DrawLine( x, y1++, x, y2--, BLACK );
+        x++;
+    }
 }
 
 
@@ -133,23 +334,326 @@ Display::add_text( std::string const & str )
 {
     // Note: need to set font here first, it may have been chenged behind our
     // back which would screw up the calculations done for the widths of the
-    // newly added lines
+    // newly added lines. If the font size was just changed the lines must
+    // be recalculated with the new font before anything can be added.
 
-    SetFont( m_font, BLACK );
-    m_lines.add( str );
-    Repaint( );
+    if ( m_is_zoom_pending )
+        commit_font_size( );
+
+    SetFont( m_fonts.font( ), BLACK );
+
+    // Plain text (by far the most common case) can go directly into the
+    // scrollback without involving the parser
+
+    if (    ! m_is_grid_mode
+         && m_parser.is_idle( )
+         && str.find( '\033' ) == std::string::npos )
+    {
+        m_lines.add( str );
+        m_mess.send( message::Trace_Point(
+                                     message::Trace_Point::Lines_Added ) );
+        Repaint( );
+        return;
+    }
+
+    m_parser.feed( str, *this );
+    flush_scrollback( );
+    m_mess.send( message::Trace_Point( message::Trace_Point::Lines_Added ) );
+
+    // In grid mode only the cells that changed need to be redrawn, unless
+    // we just switched between lines and grid
+
+    if ( m_is_grid_mode && ! m_is_mode_changed )
+        update_grid( );
+    else
+        Repaint( );
+}
+
+
+/******************************************
+ * Called by the parser with printable text
+ ******************************************/
+
+void
+Display::text( std::string const & txt )
+{
+    if ( m_is_grid_mode )
+        m_grid.text( txt );
+    else
+        m_scrollback += txt;
+}
+
+
+/******************************************
+ * Called by the parser for control characters, in scrollback mode they're
+ * left to the lines to deal with (as they always were)
+ ******************************************/
+
+void
+Display::control( char c )
+{
+    if ( m_is_grid_mode )
+        m_grid.control( c );
+    else
+        m_scrollback += c;
+}
+
+
+/******************************************
+ * Called by the parser for short escape sequences, they only make sense
+ * in grid mode
+ ******************************************/
+
+void
+Display::escape( char c )
+{
+    if ( m_is_grid_mode )
+        m_grid.escape( c );
+}
+
+
+/******************************************
+ * Called by the parser for control sequences. Switching to the alternate
+ * screen or positioning the cursor (as done when clearing the screen)
+ * switches to grid mode, in scrollback mode all other sequences (e.g. for
+ * colors) are dropped.
+ ******************************************/
+
+void
+Display::csi( char                       priv,
+              std::vector< int > const & params,
+              char                       final )
+{
+    int p0 = params.empty( ) ? -1 : params[ 0 ];
+
+    if (    priv == '?'
+         && ( final == 'h' || final == 'l' )
+         && ( p0 == 1049 || p0 == 1047 || p0 == 47 ) )
+    {
+        if ( final == 'h' )
+            enter_grid_mode( true );
+        else if ( m_is_alt_screen )
+            leave_grid_mode( );
+        return;
+    }
+
+    if ( ! m_is_grid_mode )
+    {
+        if (    priv != '\0'
+             || ! (    final == 'H' || final == 'f' || final == 'd'
+                    || ( final == 'J' && p0 >= 2 ) ) )
+            return;
+
+        enter_grid_mode( false );
+    }
+
+    m_grid.csi( priv, params, final );
+}
+
+
+/******************************************
+ * Switches from the lines to the cell grid (which starts out empty). If
+ * the grid was already in use but not for the alternate screen its content
+ * goes into the scrollback first.
+ ******************************************/
+
+void
+Display::enter_grid_mode( bool is_alt_screen )
+{
+    if ( m_is_grid_mode )
+    {
+        if ( is_alt_screen == m_is_alt_screen )
+            return;
+        if ( ! m_is_alt_screen )
+        {
+            m_grid.take_scrolled_off( m_scrollback );
+            m_grid.dump( m_scrollback );
+        }
+    }
+    else if ( m_scrollback.empty( )
+              ? m_lines.is_unfinished_line( )
+              : m_scrollback[ m_scrollback.size( ) - 1 ] != '\n' )
+        m_scrollback += '\n';
+
+    flush_scrollback( );
+
+    m_grid.reset( );
+    m_is_grid_mode = true;
+    m_is_alt_screen = is_alt_screen;
+    m_is_mode_changed = true;
+}
+
+
+/******************************************
+ * Switches back from the cell grid to the lines. Unless the grid was used
+ * for the alternate screen its content is kept in the scrollback.
+ ******************************************/
+
+void
+Display::leave_grid_mode( )
+{
+    if ( ! m_is_grid_mode )
+        return;
+
+    if ( ! m_is_alt_screen )
+    {
+        m_grid.take_scrolled_off( m_scrollback );
+        m_grid.dump( m_scrollback );
+    }
+
+    flush_scrollback( );
+
+    m_is_grid_mode = false;
+    m_is_alt_screen = false;
+    m_is_mode_changed = true;
+}
+
+
+/******************************************
+ * Adds the text collected for the scrollback (including lines scrolled
+ * off the top of the grid) to the lines
+ ******************************************/
+
+void
+Display::flush_scrollback( )
+{
+    if ( m_is_grid_mode )
+    {
+        if ( m_is_alt_screen )
+        {
+            std::string discard;
+            m_grid.take_scrolled_off( discard );
+        }
+        else
+            m_grid.take_scrolled_off( m_scrollback );
+    }
+
+    if ( ! m_scrollback.empty( ) )
+    {
+        m_lines.add( m_scrollback );
+        m_scrollback.clear( );
+    }
+}
+
+
+/******************************************
+ * Draws the cells of the grid that changed and updates just the part of
+ * the screen they're in
+ ******************************************/
+
+void
+Display::update_grid( )
+{
+    if ( m_is_output_suspended )
+    {
+        m_is_redraw_needed = true;
+        return;
+    }
+
+    // Drawing only the changed cells might damage an overlay
+
+    if ( ! m_overlay.empty( ) )
+    {
+        redraw( );
+        return;
+    }
+
+    Alloc_Profile::Scope scope( Alloc_Profile::Redraw );
+
+    m_profiler.begin_frame( Frame_Profiler::Grid_Update, m_font_size );
+
+    irect area;
+    if ( ! m_grid.draw_changes( m_fonts.font( ), area ) )
+    {
+        m_profiler.cancel_frame( );
+        return;
+    }
+
+    draw_recording_mark( );
+    m_profiler.end_phase( Frame_Profiler::Draw );
+    m_mess.send( message::Trace_Point( message::Trace_Point::Screen_Updated ) );
+    PartialUpdate( area.x, area.y, area.w, area.h );
+    m_profiler.end_phase( Frame_Profiler::Update );
+    m_profiler.end_frame( );
+}
+
+
+/******************************************
+ * Sets the size of the cells of the grid from that of the font and how
+ * many of them fit onto the screen. Cells are as wide as an 'M' in the
+ * current font. If the number of rows or columns changes the shell gets
+ * told about it, so programs can format their output accordingly.
+ ******************************************/
+
+void
+Display::set_grid_geometry( )
+{
+    std::vector< int > const * widths = m_fonts.char_widths( );
+    int cell_width = widths ? ( *widths )[ 'M' ] : -1;
+
+    if ( cell_width <= 0 )
+    {
+        SetFont( m_fonts.font( ), BLACK );
+        cell_width = CharWidth( 'M' );
+    }
+
+    int cell_height = m_font_size + m_lines.line_spacing( );
+
+    int rows    = m_grid.rows( ),
+        columns = m_grid.columns( );
+
+    m_grid.set_geometry( X_MARGIN, Y_MARGIN, cell_width, cell_height );
+    m_grid.resize( m_lines.screen_height( ) / cell_height,
+                   m_lines.screen_width( ) / cell_width );
+
+    if ( m_grid.rows( ) != rows || m_grid.columns( ) != columns )
+        m_mess.send( message::Terminal_Size( m_grid.rows( ),
+                                             m_grid.columns( ) ) );
 }
 
 
 /***************************************
- * Called when the user makes a swipe gesture to scroll up or down
+ * Called when the user makes a swipe gesture to scroll up or down. While
+ * the user is still scrolling ('fast' is set) the lines get drawn right
+ * away with a fast (but lower quality) update of the screen and lines
+ * just outside of the visible area are made ready for being shown next.
+ * The final shift gets a normal redraw.
  ***************************************/
 
 void
-Display::shift( int amount )
+Display::shift( int  amount,
+                bool fast )
 {
+    // A program using the alternate screen owns the whole display, otherwise
+    // scrolling returns to the lines (with the grid's content added to them)
+
+    if ( m_is_alt_screen )
+        return;
+
+    leave_grid_mode( );
     m_lines.shift( amount );
-    Repaint( );
+
+    if ( ! fast || m_is_output_suspended || m_is_zoom_pending )
+    {
+        Repaint( );
+        return;
+    }
+
+    m_profiler.begin_frame( Frame_Profiler::Scroll, m_font_size );
+
+    ClearScreen( );
+    m_profiler.end_phase( Frame_Profiler::Clear );
+    SetFont( m_fonts.font( ), BLACK );
+
+    m_lines.prepare_visible( );
+    m_lines.redraw( );
+    draw_recording_mark( );
+    m_profiler.end_phase( Frame_Profiler::Draw );
+    DynamicUpdate( 0, 0, ScreenWidth( ), ScreenHeight( ) );
+    m_profiler.end_phase( Frame_Profiler::Update );
+    m_profiler.end_frame( );
+
+    m_lines.prefetch( SCROLL_PREFETCH_SCREENS * m_lines.screen_height( ) );
 }
     
 
@@ -167,9 +671,14 @@ Display::rotate( int dir )
 
     m_width = ScreenWidth( );
 
-    SetFont( m_font, BLACK );
+    if ( m_is_zoom_pending )
+        commit_font_size( );
+
+    SetFont( m_fonts.font( ), BLACK );
 
     m_lines.screen_dimensions_changed( );
+    set_grid_geometry( );
+    check_relayout( );
 
     Repaint( );
 }
@@ -177,13 +686,18 @@ Display::rotate( int dir )
 
 /***************************************
  * Called when the user requests a larger or smaller font size (argument
- * is the difference to the current font size)
+ * is the difference to the current font size). Since the font with the
+ * new size normally has already been opened by the font manager the
+ * switch is fast. If a preview is to be shown only the last lines get
+ * drawn without wrapping, and the (possibly slow) recalculation of all
+ * lines is done once the user didn't ask for further changes for a
+ * short time.
  ***************************************/
 
 void
 Display::change_font_size( int incr )
 {
-    int new_font_size  = m_font_size + incr;
+    int new_font_size  = m_fonts.size( ) + incr;
 
     // Put some rstrictions on the minimum and maximum font size
 
@@ -193,22 +707,89 @@ Display::change_font_size( int incr )
     if ( new_font_size > MAX_FONT_SIZE )
         new_font_size = MAX_FONT_SIZE;
 
-    if ( new_font_size == m_font_size )
+    if (    new_font_size == m_fonts.size( )
+         || ! m_fonts.select( new_font_size ) )
         return;
 
-    ifont *new_font = OpenFont( m_font_name.c_str( ), new_font_size, 1 );
-
-    if ( ! new_font )
+    if ( ! m_zoom_preview || m_is_output_suspended || m_is_grid_mode )
+    {
+        commit_font_size( );
+        Repaint( );
         return;
+    }
+
+    // The table of character widths the lines were using may have been
+    // discarded when switching to the new font
+
+    m_is_zoom_pending = true;
+    m_lines.set_char_widths( 0 );
 
-    CloseFont( m_font );
+    ClearScreen( );
+    SetFont( m_fonts.font( ), BLACK );
+    m_lines.preview( new_font_size + m_lines.line_spacing( ) );
+    DynamicUpdate( 0, 0, ScreenWidth( ), ScreenHeight( ) );
+
+    SetWeakTimer( APP_NAME "_zoom", &Display::static_zoom_handler,
+                  ZOOM_PREVIEW_DELAY );
+}
+
+
+/***************************************
+ * Helper function that can be called from C, redirects to the
+ * real handler function
+ ***************************************/
+
+void
+Display::static_zoom_handler( )
+{
+    if ( s_handling_display->m_is_zoom_pending )
+        Repaint( );
+}
 
-    m_font = new_font;
-    m_font_size = new_font_size;
 
-    SetFont( m_font, BLACK );
+/***************************************
+ * Makes the lines use the font size selected in the font manager
+ ***************************************/
+
+void
+Display::commit_font_size( )
+{
+    m_is_zoom_pending = false;
+    m_font_size = m_fonts.size( );
+
+    SetFont( m_fonts.font( ), BLACK );
+    m_lines.set_char_widths( m_fonts.char_widths( ) );
     m_lines.change_font_size( m_font_size );
-    Repaint( );
+    set_grid_geometry( );
+    check_relayout( );
+}
+
+
+/***************************************
+ * Helper function that can be called from C, redirects to the
+ * real handler function
+ ***************************************/
+
+void
+Display::static_relayout_handler( )
+{
+    s_handling_display->check_relayout( );
+}
+
+
+/***************************************
+ * Picks up lines whose wrapping has been calculated in the background
+ * and, as long as there are more to come, restarts the timer to get
+ * back here. Since the lines adjust the y-position there's no visible
+ * change and thus no redraw is needed.
+ ***************************************/
+
+void
+Display::check_relayout( )
+{
+    if ( m_lines.collect_relayout_results( ) )
+        SetWeakTimer( APP_NAME "_relayout", &Display::static_relayout_handler,
+                      RELAYOUT_POLL_INTERVAL );
 }
 
 
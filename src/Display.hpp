@@ -25,6 +25,10 @@
 #include <string>
 #include <vector>
 #include "Lines.hpp"
+#include "Font_Manager.hpp"
+#include "Ansi_Parser.hpp"
+#include "Screen_Grid.hpp"
+#include "Frame_Profiler.hpp"
 #include "Inkview.hpp"
 
 
@@ -34,10 +38,13 @@ class Logger;
 
 
 /******************************************
- * Class that takes care of what happens on the display
+ * Class that takes care of what happens on the display. Output of the
+ * shell normally goes into the scrollback (the lines), but as soon as a
+ * program starts positioning the cursor it's shown in a grid of cells
+ * instead, until the program switches back or the user scrolls.
  ******************************************/
 
-class Display
+class Display : private Ansi_Sink
 {
   public :
 
@@ -57,7 +64,8 @@ class Display
 
 
     void
-    shift( int amount );
+    shift( int  amount,
+           bool fast = false );
 
 
     void
@@ -75,14 +83,108 @@ class Display
     recording_state_change( bool state );
 
 
+    void
+    show_overlay( std::string const & text );
+
+
+    bool
+    hide_overlay( );
+
+
+    void
+    set_zoom_preview( bool yes_no )  { m_zoom_preview = yes_no; }
+
+
+    // Writes the frames recorded by the frame profiler to a file and
+    // shows a summary
+
+    void
+    dump_frame_profile( );
+
+
+    // Returns the number of rows and columns of the cell grid
+
+    int
+    rows( ) const  { return m_grid.rows( ); }
+
+
+    int
+    columns( ) const  { return m_grid.columns( ); }
+
+
   private :
 
-    // Name of the font to use
+    // Ansi_Sink interface, distributes the output of the shell between
+    // scrollback and cell grid
+
+    void
+    text( std::string const & txt );
+
+
+    void
+    control( char c );
+
+
+    void
+    escape( char c );
 
-    std::string m_font_name;
 
+    void
+    csi( char                       priv,
+         std::vector< int > const & params,
+         char                       final );
+
+
+    void
+    enter_grid_mode( bool is_alt_screen );
+
+
+    void
+    leave_grid_mode( );
+
+
+    void
+    flush_scrollback( );
+
+
+    void
+    update_grid( );
 
-    // Size of that font
+
+    void
+    set_grid_geometry( );
+
+
+    void
+    draw_recording_mark( );
+
+
+    void
+    draw_overlay( );
+
+    static void
+    static_zoom_handler( );
+
+
+    static void
+    static_relayout_handler( );
+
+
+    void
+    check_relayout( );
+
+
+    void
+    commit_font_size( );
+
+
+    // Messenger the display reports changes of the number of rows and
+    // columns to
+
+    Messenger & m_mess;
+
+
+    // Size of the font used for the lines
 
     int m_font_size;
 
@@ -102,9 +204,14 @@ class Display
     int m_width;
 
 
-    // Font currently in use
+    // Name of the font (also used for overlays)
+
+    std::string m_font_name;
+
+
+    // Object managing the font in use and those with neighbouring sizes
 
-    ifont * m_font;
+    Font_Manager m_fonts;
 
 
     // Object containing all lines
@@ -112,6 +219,39 @@ class Display
     Lines m_lines;
 
 
+    // Parser for the output of the shell
+
+    Ansi_Parser m_parser;
+
+
+    // Grid of cells used by programs that position the cursor
+
+    Screen_Grid m_grid;
+
+
+    // Flag, set while the cell grid is shown instead of the lines
+
+    bool m_is_grid_mode;
+
+
+    // Flag, set if the grid mode was requested by the program switching
+    // to the "alternate screen" (what's shown then never goes into the
+    // scrollback)
+
+    bool m_is_alt_screen;
+
+
+    // Flag, set when the screen has to be redrawn completely because
+    // of a switch between lines and grid
+
+    bool m_is_mode_changed;
+
+
+    // Text for the scrollback collected while parsing
+
+    std::string m_scrollback;
+
+
     // Flag, set when no redraws are to done
 
     bool m_is_output_suspended;
@@ -125,6 +265,41 @@ class Display
     // Flag, set while recording is switched on
 
     bool m_is_recording;
+
+
+    // Flag, set if a quick preview is to be shown on font size changes
+
+    bool m_zoom_preview;
+
+
+    // Flag, set while the font size has been changed but the lines haven't
+    // been recalculated yet
+
+    bool m_is_zoom_pending;
+
+
+    // Text shown in a box on top of everything else (if not empty)
+
+    std::string m_overlay;
+
+
+    // Small font the overlay text is drawn with, opened when the overlay
+    // first gets shown
+
+    ifont * m_overlay_font;
+
+
+    // Recorder for the times repaints take and file it writes them to
+
+    Frame_Profiler m_profiler;
+
+
+    std::string m_frame_profile_file;
+
+
+    // Needed in static timer handler to call the real handler function
+
+    static Display * s_handling_display;
 };
 
 
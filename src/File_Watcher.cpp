@@ -0,0 +1,321 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "File_Watcher.hpp"
+#include "Metrics.hpp"
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+
+
+namespace
+{
+
+Metrics::Counter & s_reparses = Metrics::counter( "files reparsed" );
+
+
+// Events for the directories with the watched files that indicate that a
+// file was written to, replaced or removed
+
+uint32_t const Watch_Mask =   IN_CLOSE_WRITE | IN_MOVED_TO
+                            | IN_MOVED_FROM  | IN_DELETE;
+
+}
+
+
+/******************************************
+ ******************************************/
+
+File_Watcher::File_Watcher( )
+    : m_has_thread( false )
+{
+    m_quit_pipe[ 0 ] = m_quit_pipe[ 1 ] = -1;
+    pthread_mutex_init( &m_mutex, 0 );
+}
+
+
+/******************************************
+ * Destructor, tells the thread to exit and waits for it to do so
+ ******************************************/
+
+File_Watcher::~File_Watcher( )
+{
+    if ( m_has_thread )
+    {
+        while (    write( m_quit_pipe[ 1 ], "q", 1 ) == -1
+                && errno == EINTR )
+            /* empty */ ;
+        pthread_join( m_thread, 0 );
+    }
+
+    if ( m_quit_pipe[ 0 ] != -1 )
+    {
+        close( m_quit_pipe[ 0 ] );
+        close( m_quit_pipe[ 1 ] );
+    }
+
+    pthread_mutex_destroy( &m_mutex );
+}
+
+
+/******************************************
+ * The directory of the file gets watched, not the file itself, since
+ * editors often write a new file and rename it to the old name
+ ******************************************/
+
+int
+File_Watcher::add( std::string const & file_name,
+                   Parser              parser )
+{
+    if ( m_has_thread )
+        return -1;
+
+    Entry e;
+    e.file_name = file_name;
+    e.parser    = parser;
+    e.wd        = -1;
+    e.version   = 0;
+
+    std::size_t pos = file_name.rfind( '/' );
+
+    if ( pos == std::string::npos )
+    {
+        e.dir       = ".";
+        e.base_name = file_name;
+    }
+    else
+    {
+        e.dir       = pos ? file_name.substr( 0, pos ) : "/";
+        e.base_name = file_name.substr( pos + 1 );
+    }
+
+    m_entries.push_back( e );
+    return m_entries.size( ) - 1;
+}
+
+
+/******************************************
+ ******************************************/
+
+bool
+File_Watcher::start( )
+{
+    if ( m_has_thread )
+        return true;
+
+    if ( pipe( m_quit_pipe ) == -1 )
+    {
+        m_quit_pipe[ 0 ] = m_quit_pipe[ 1 ] = -1;
+        return false;
+    }
+
+    if ( pthread_create( &m_thread, 0, thread_func, this ) != 0 )
+        return false;
+
+    m_has_thread = true;
+    return true;
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+File_Watcher::parse_all( )
+{
+    for ( std::size_t i = 0; i < m_entries.size( ); ++i )
+        parse( i );
+}
+
+
+/******************************************
+ ******************************************/
+
+File_Watcher::Content_Ptr
+File_Watcher::content( int             id,
+                       unsigned long * version )
+{
+    if ( id < 0 || id >= static_cast< int >( m_entries.size( ) ) )
+    {
+        if ( version )
+            *version = 0;
+        return Content_Ptr( );
+    }
+
+    pthread_mutex_lock( &m_mutex );
+
+    Content_Ptr c = m_entries[ id ].content;
+    if ( version )
+        *version = m_entries[ id ].version;
+
+    pthread_mutex_unlock( &m_mutex );
+
+    return c;
+}
+
+
+/******************************************
+ ******************************************/
+
+void *
+File_Watcher::thread_func( void * arg )
+{
+    static_cast< File_Watcher * >( arg )->run( );
+    return 0;
+}
+
+
+/******************************************
+ * Parses all files once and then waits for changes to them (if inotify
+ * can't be used the contents just stay as they were read initially)
+ ******************************************/
+
+void
+File_Watcher::run( )
+{
+    parse_all( );
+    watch( );
+}
+
+
+/******************************************
+ * Reparses files when inotify reports changes. A directory that vanishes
+ * (e.g. because the file system it's on got unmounted) isn't watched
+ * anymore, its files get reparsed once and then keep their contents.
+ ******************************************/
+
+void
+File_Watcher::watch( )
+{
+    int fd = inotify_init( );
+    if ( fd == -1 )
+        return;
+
+    bool is_watching = false;
+
+    for ( std::size_t i = 0; i < m_entries.size( ); ++i )
+    {
+        Entry & e = m_entries[ i ];
+
+        e.wd = inotify_add_watch( fd, e.dir.c_str( ), Watch_Mask );
+        is_watching |= e.wd != -1;
+    }
+
+    std::vector< bool > changed( m_entries.size( ) );
+    char buf[ 4096 ]
+                __attribute__ ( ( aligned( __alignof__( inotify_event ) ) ) );
+
+    while ( is_watching )
+    {
+        pollfd fds[ 2 ] = { { fd,               POLLIN, 0 },
+                            { m_quit_pipe[ 0 ], POLLIN, 0 } };
+
+        if ( poll( fds, 2, -1 ) == -1 )
+        {
+            if ( errno == EINTR )
+                continue;
+            break;
+        }
+
+        if ( fds[ 1 ].revents )
+            break;
+
+        ssize_t len = read( fd, buf, sizeof buf );
+
+        if ( len <= 0 )
+        {
+            if ( len == -1 && ( errno == EINTR || errno == EAGAIN ) )
+                continue;
+            break;
+        }
+
+        // Collect the files affected by the events read before parsing
+        // them, an editor saving a file may cause several events
+
+        changed.assign( changed.size( ), false );
+
+        for ( char * p = buf; p < buf + len; )
+        {
+            inotify_event const * ev =
+                                reinterpret_cast< inotify_event const * >( p );
+            p += sizeof *ev + ev->len;
+
+            for ( std::size_t i = 0; i < m_entries.size( ); ++i )
+            {
+                Entry & e = m_entries[ i ];
+
+                if ( ev->mask & IN_Q_OVERFLOW )
+                    changed[ i ] = true;
+                else if ( ev->wd != e.wd )
+                    continue;
+                else if ( ev->mask & IN_IGNORED )
+                {
+                    e.wd = -1;
+                    changed[ i ] = true;
+                }
+                else if ( ev->len && e.base_name == ev->name )
+                    changed[ i ] = true;
+            }
+        }
+
+        is_watching = false;
+
+        for ( std::size_t i = 0; i < m_entries.size( ); ++i )
+        {
+            if ( changed[ i ] )
+                parse( i );
+            is_watching |= m_entries[ i ].wd != -1;
+        }
+    }
+
+    close( fd );
+}
+
+
+/******************************************
+ * Parses a file and swaps in the result (whatever was made of the file
+ * before gets deleted once nobody uses it anymore)
+ ******************************************/
+
+void
+File_Watcher::parse( std::size_t id )
+{
+    Entry & e = m_entries[ id ];
+    Content_Ptr c( e.parser( e.file_name ) );
+
+    pthread_mutex_lock( &m_mutex );
+
+    e.content.swap( c );
+    e.version++;
+
+    pthread_mutex_unlock( &m_mutex );
+
+    s_reparses.add( );
+}
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
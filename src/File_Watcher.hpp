@@ -0,0 +1,175 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#if ! defined FILE_WATCHER_HPP_
+#define FILE_WATCHER_HPP_
+
+
+#include <string>
+#include <vector>
+#include <tr1/memory>
+#include <pthread.h>
+
+
+/******************************************
+ * Base class for what gets made of the content of a watched file
+ ******************************************/
+
+class File_Content
+{
+  public :
+
+    virtual
+    ~File_Content( )
+    { }
+};
+
+
+/******************************************
+ * Class for keeping track of files the user may edit while the program
+ * is running. A thread of its own parses them, first when it's started
+ * and then again each time inotify reports that one of them was written
+ * to, replaced or removed. The result of parsing a file is swapped in
+ * under a mutex, so the main thread always gets either the old or the
+ * new one, and a shared pointer keeps what it got alive for as long as
+ * it needs it. The parsers are run in the thread and thus must not call
+ * into libinkview or use the logger.
+ ******************************************/
+
+class File_Watcher
+{
+  public :
+
+    typedef std::tr1::shared_ptr< File_Content const > Content_Ptr;
+
+
+    // A parser returns what it made of a file (it may return null, e.g.
+    // if the file doesn't exist)
+
+    typedef File_Content * ( * Parser )( std::string const & file_name );
+
+
+    File_Watcher( );
+
+
+    ~File_Watcher( );
+
+
+    // Adds a file to be watched (only possible before the thread was
+    // started), returns the id to ask for its content with
+
+    int
+    add( std::string const & file_name,
+         Parser              parser );
+
+
+    // Starts the thread, returns false if that's not possible
+
+    bool
+    start( );
+
+
+    // Parses all files once in the calling thread (for when the thread
+    // can't be started)
+
+    void
+    parse_all( );
+
+
+    // Returns what was made of a file (null if it wasn't parsed yet) and,
+    // optionally, how many times it has been parsed
+
+    Content_Ptr
+    content( int             id,
+             unsigned long * version = 0 );
+
+
+  private :
+
+    // Copying or assigning a watcher makes no sense
+
+    File_Watcher( File_Watcher const & );
+
+
+    File_Watcher &
+    operator = ( File_Watcher const & );
+
+
+    static void *
+    thread_func( void * arg );
+
+
+    void
+    run( );
+
+
+    void
+    watch( );
+
+
+    void
+    parse( std::size_t id );
+
+
+    struct Entry
+    {
+        std::string file_name;
+        std::string dir;
+        std::string base_name;
+        Parser parser;
+        int wd;
+        Content_Ptr content;
+        unsigned long version;
+    };
+
+
+    // The watched files (only their contents and versions get changed
+    // once the thread runs)
+
+    std::vector< Entry > m_entries;
+
+
+    pthread_t m_thread;
+
+
+    bool m_has_thread;
+
+
+    // Mutex protecting the contents and versions of the files
+
+    pthread_mutex_t m_mutex;
+
+
+    // Pipe used for telling the thread to exit
+
+    int m_quit_pipe[ 2 ];
+};
+
+
+#endif
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,281 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "Font_Manager.hpp"
+#include "Defaults.hpp"
+
+
+// Definition of the static member used to find the Font_Manager instance
+// from within static member functions
+
+Font_Manager * Font_Manager::s_handling_fonts;
+
+
+/******************************************
+ * Constructor, opens the font with the initial size. Its neighbours
+ * are opened later on when the program has nothing else to do.
+ ******************************************/
+
+Font_Manager::Font_Manager( std::string const & font_name,
+                            int                 font_size,
+                            int                 font_step )
+    : m_font_name( font_name )
+    , m_size( font_size )
+    , m_step( font_step )
+{
+    s_handling_fonts = this;
+
+    Font_Map::iterator it = open_font( m_size );
+    if ( it == m_fonts.end( ) )
+        return;
+
+    calc_char_widths( it->second );
+    SetWeakTimer( APP_NAME "_fonts", &Font_Manager::static_idle_handler,
+                  FONT_IDLE_DELAY );
+}
+
+
+/******************************************
+ * Destructor, closes all fonts still open
+ ******************************************/
+
+Font_Manager::~Font_Manager( )
+{
+    ClearTimer( &Font_Manager::static_idle_handler );
+
+    for ( Font_Map::iterator it = m_fonts.begin( ); it != m_fonts.end( );
+          ++it )
+        CloseFont( it->second.font );
+}
+
+
+/******************************************
+ * Returns the font currently in use
+ ******************************************/
+
+ifont *
+Font_Manager::font( ) const
+{
+    Font_Map::const_iterator it = m_fonts.find( m_size );
+    return it != m_fonts.end( ) ? it->second.font : 0;
+}
+
+
+/******************************************
+ * Returns the table of character widths of the font in use (entries
+ * for characters for which the width isn't known are negative)
+ ******************************************/
+
+std::vector< int > const *
+Font_Manager::char_widths( ) const
+{
+    Font_Map::const_iterator it = m_fonts.find( m_size );
+
+    if ( it == m_fonts.end( ) || it->second.widths.empty( ) )
+        return 0;
+    return &it->second.widths;
+}
+
+
+/******************************************
+ * Switches to the font with the requested size. If this is one of the
+ * neighbours of the current font (the normal case when the user changes
+ * the font size by a single step) it normally has already been opened.
+ * Only otherwise the font has to be loaded now. Returns false if the font
+ * with the requested size can't be opened.
+ ******************************************/
+
+bool
+Font_Manager::select( int new_size )
+{
+    Font_Map::iterator it = m_fonts.find( new_size );
+
+    if (    it == m_fonts.end( )
+         && ( it = open_font( new_size ) ) == m_fonts.end( ) )
+        return false;
+
+    if ( it->second.widths.empty( ) )
+        calc_char_widths( it->second );
+
+    m_size = new_size;
+
+    // Get rid of fonts we won't need anymore and start opening the new
+    // neighbours once there's time for it
+
+    close_unneeded( );
+    SetWeakTimer( APP_NAME "_fonts", &Font_Manager::static_idle_handler,
+                  FONT_IDLE_DELAY );
+    return true;
+}
+
+
+/******************************************
+ * Helper function that can be called from C, redirects to the
+ * real handler function
+ ******************************************/
+
+void
+Font_Manager::static_idle_handler( )
+{
+    s_handling_fonts->idle_handler( );
+}
+
+
+/******************************************
+ * Called via a timer while nothing else is going on. Each time only a
+ * single font gets opened or its character widths calculated in order
+ * not to block the program for too long. The timer is restarted for as
+ * long as there's still work left to be done.
+ ******************************************/
+
+void
+Font_Manager::idle_handler( )
+{
+    if ( do_idle_work( ) )
+        SetWeakTimer( APP_NAME "_fonts", &Font_Manager::static_idle_handler,
+                      FONT_IDLE_DELAY );
+}
+
+
+/******************************************
+ * Does the next piece of work needed for having both neighbours of the
+ * current font ready. Returns true if more remains to be done.
+ ******************************************/
+
+bool
+Font_Manager::do_idle_work( )
+{
+    int sizes[ ] = { m_size + m_step, m_size - m_step };
+
+    for ( std::size_t i = 0; i < sizeof sizes / sizeof *sizes; ++i )
+    {
+        int size = clamped( sizes[ i ] );
+        if ( size == m_size )
+            continue;
+
+        Font_Map::iterator it = m_fonts.find( size );
+
+        if ( it == m_fonts.end( ) )
+        {
+            // If the font can't be opened don't try again and again
+
+            if ( open_font( size ) == m_fonts.end( ) )
+                continue;
+            return true;
+        }
+
+        if ( it->second.widths.empty( ) )
+        {
+            calc_char_widths( it->second );
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/******************************************
+ * Opens the font with the given size and stores it in the map of
+ * open fonts. Returns the end iterator of the map on failure.
+ ******************************************/
+
+Font_Manager::Font_Map::iterator
+Font_Manager::open_font( int size )
+{
+    ifont * f = OpenFont( m_font_name.c_str( ), size, 1 );
+
+    if ( ! f )
+        return m_fonts.end( );
+
+    Entry entry;
+    entry.font = f;
+    return m_fonts.insert( std::make_pair( size, entry ) ).first;
+}
+
+
+/******************************************
+ * Determines the widths of all printable ASCII characters for a font.
+ * All other characters are marked by a negative width since the widths
+ * of strings containing them must be obtained from libinkview directly.
+ * Since this requires switching fonts the font in use is re-established
+ * afterwards.
+ ******************************************/
+
+void
+Font_Manager::calc_char_widths( Entry & entry )
+{
+    entry.widths.assign( 128, -1 );
+
+    SetFont( entry.font, BLACK );
+
+    for ( int c = ' '; c < 127; ++c )
+        entry.widths[ c ] = CharWidth( c );
+
+    ifont * cur = font( );
+    if ( cur && cur != entry.font )
+        SetFont( cur, BLACK );
+}
+
+
+/******************************************
+ * Closes all fonts that aren't the current one or one of its neighbours
+ ******************************************/
+
+void
+Font_Manager::close_unneeded( )
+{
+    int low  = clamped( m_size - m_step ),
+        high = clamped( m_size + m_step );
+
+    Font_Map::iterator it = m_fonts.begin( );
+
+    while ( it != m_fonts.end( ) )
+        if ( it->first < low || it->first > high )
+        {
+            CloseFont( it->second.font );
+            m_fonts.erase( it++ );
+        }
+        else
+            ++it;
+}
+
+
+/******************************************
+ * Restricts a font size to the range of supported sizes
+ ******************************************/
+
+int
+Font_Manager::clamped( int size ) const
+{
+    if ( size < MIN_FONT_SIZE )
+        return MIN_FONT_SIZE;
+    if ( size > MAX_FONT_SIZE )
+        return MAX_FONT_SIZE;
+    return size;
+}
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,150 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#if ! defined FONT_MANAGER_HPP_
+#define FONT_MANAGER_HPP_
+
+
+#include <string>
+#include <vector>
+#include <map>
+#include "Inkview.hpp"
+
+
+/******************************************
+ * Class that keeps the font in use open together with its neighbours
+ * in the "ladder" of font sizes (i.e. the sizes one 'font_step' smaller
+ * and larger). The neighbours get opened and their tables of character
+ * widths get calculated while the program is idle, so that switching to
+ * one of them doesn't require waiting for the font to be loaded.
+ ******************************************/
+
+class Font_Manager
+{
+  public :
+
+    Font_Manager( std::string const & font_name,
+                  int                 font_size,
+                  int                 font_step );
+
+
+    ~Font_Manager( );
+
+
+    // Returns the font currently in use (or 0 if it couldn't be opened)
+
+    ifont *
+    font( ) const;
+
+
+    // Returns the size of the font currently in use
+
+    int
+    size( ) const  { return m_size; }
+
+
+    // Switches to a font with a different size
+
+    bool
+    select( int new_size );
+
+
+    // Returns the table of character widths for the current font
+
+    std::vector< int > const *
+    char_widths( ) const;
+
+
+  private :
+
+    // Data stored for each of the fonts kept open
+
+    struct Entry
+    {
+        ifont * font;
+        std::vector< int > widths;
+    };
+
+    typedef std::map< int, Entry > Font_Map;
+
+
+    static void
+    static_idle_handler( );
+
+
+    void
+    idle_handler( );
+
+
+    bool
+    do_idle_work( );
+
+
+    Font_Map::iterator
+    open_font( int size );
+
+
+    void
+    calc_char_widths( Entry & entry );
+
+
+    void
+    close_unneeded( );
+
+
+    int
+    clamped( int size ) const;
+
+
+    // Name of the font
+
+    std::string m_font_name;
+
+
+    // Size of the font currently in use
+
+    int m_size;
+
+
+    // Distance between neighbouring font sizes
+
+    int m_step;
+
+
+    // All fonts currently open, indexed by their size
+
+    Font_Map m_fonts;
+
+
+    // Needed in static timer handler to call the real handler function
+
+    static Font_Manager * s_handling_fonts;
+};
+
+
+#endif
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
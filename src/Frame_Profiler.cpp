@@ -0,0 +1,224 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "Frame_Profiler.hpp"
+#include "Histogram.hpp"
+#include "Utils.hpp"
+#include <iomanip>
+#include <algorithm>
+
+
+namespace
+{
+
+char const * const Kind_Names[ ] = { "redraw", "scroll", "grid" };
+
+}
+
+
+Frame_Profiler::Frame * Frame_Profiler::s_current;
+
+
+/******************************************
+ ******************************************/
+
+Frame_Profiler::Frame_Profiler( std::size_t size )
+    : m_frames( size )
+    , m_next( 0 )
+    , m_count( 0 )
+    , m_phase_start( 0 )
+{
+}
+
+
+/******************************************
+ ******************************************/
+
+Frame_Profiler::~Frame_Profiler( )
+{
+    if ( s_current == &m_frame )
+        s_current = 0;
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+Frame_Profiler::begin_frame( Kind kind,
+                             int  font_size )
+{
+    if ( m_frames.empty( ) )
+        return;
+
+    m_phase_start = Utils::microseconds( );
+
+    m_frame.time      = m_phase_start;
+    m_frame.kind      = kind;
+    m_frame.font_size = font_size;
+    m_frame.lines     = 0;
+    m_frame.segments  = 0;
+    m_frame.glyphs    = 0;
+    for ( int i = 0; i < Num_Phases; ++i )
+        m_frame.phase_time[ i ] = 0;
+
+    s_current = &m_frame;
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+Frame_Profiler::end_phase( Phase phase )
+{
+    if ( s_current != &m_frame )
+        return;
+
+    unsigned long long now = Utils::microseconds( );
+    m_frame.phase_time[ phase ] += now - m_phase_start;
+    m_phase_start = now;
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+Frame_Profiler::end_frame( )
+{
+    if ( s_current != &m_frame )
+        return;
+
+    s_current = 0;
+
+    m_frames[ m_next ] = m_frame;
+    m_next = ( m_next + 1 ) % m_frames.size( );
+    if ( m_count < m_frames.size( ) )
+        m_count++;
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+Frame_Profiler::cancel_frame( )
+{
+    if ( s_current == &m_frame )
+        s_current = 0;
+}
+
+
+/******************************************
+ * Writes a line per frame, the times are in microseconds, and the start
+ * of each frame relative to the oldest one
+ ******************************************/
+
+void
+Frame_Profiler::write( std::ostream & out ) const
+{
+    out << "#    start  kind    font  lines   segs  glyphs   clear    draw"
+           "  update   total\n";
+
+    std::size_t first = ( m_next + m_frames.size( ) - m_count )
+                        % std::max< std::size_t >( m_frames.size( ), 1 );
+
+    for ( std::size_t i = 0; i < m_count; ++i )
+    {
+        Frame const & f = m_frames[ ( first + i ) % m_frames.size( ) ];
+        unsigned long total = 0;
+
+        out << std::setw( 10 ) << f.time - m_frames[ first ].time << "  "
+            << std::left << std::setw( 6 ) << Kind_Names[ f.kind ]
+            << std::right
+            << std::setw( 6 ) << f.font_size
+            << std::setw( 7 ) << f.lines
+            << std::setw( 7 ) << f.segments
+            << std::setw( 8 ) << f.glyphs;
+
+        for ( int j = 0; j < Num_Phases; ++j )
+        {
+            out << std::setw( 8 ) << f.phase_time[ j ];
+            total += f.phase_time[ j ];
+        }
+
+        out << std::setw( 8 ) << total << '\n';
+    }
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+Frame_Profiler::write_summary( std::ostream & out ) const
+{
+    Histogram phases[ Num_Phases ];
+    Histogram total;
+
+    for ( std::size_t i = 0; i < m_count; ++i )
+    {
+        Frame const & f = m_frames[ i ];
+        unsigned long sum = 0;
+
+        for ( int j = 0; j < Num_Phases; ++j )
+        {
+            phases[ j ].add( f.phase_time[ j ] );
+            sum += f.phase_time[ j ];
+        }
+
+        total.add( sum );
+    }
+
+    out << "Frame times (us)           count       min      mean    median"
+           "       90%       99%       max\n";
+
+    phases[ Clear  ].write( out, "clear screen" );
+    phases[ Draw   ].write( out, "draw" );
+    phases[ Update ].write( out, "screen update" );
+    total.write( out, "total" );
+}
+
+
+/******************************************
+ * Counts a segment of a line and the glyphs in it, i.e. all bytes that
+ * aren't continuation bytes of UTF-8 sequences
+ ******************************************/
+
+void
+Frame_Profiler::add_segment( char const  * txt,
+                             std::size_t   len )
+{
+    s_current->segments++;
+
+    for ( std::size_t i = 0; i < len; ++i )
+        if ( ( txt[ i ] & 0xC0 ) != 0x80 )
+            s_current->glyphs++;
+}
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,196 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#if ! defined FRAME_PROFILER_HPP_
+#define FRAME_PROFILER_HPP_
+
+
+#include <ostream>
+#include <vector>
+#include <cstddef>
+
+
+/******************************************
+ * Class for recording where the time goes when the screen gets repainted.
+ * For each frame (a complete redraw, a fast redraw while scrolling or an
+ * update of the grid) the time needed for clearing the screen, drawing
+ * and updating the screen, together with the number of lines, segments
+ * (parts of wrapped lines) and glyphs drawn, gets stored in a ring of
+ * fixed size, which can be written out on demand. Lines and Line report
+ * what they draw via the static count_xxx() methods, which do nothing
+ * while no frame is being recorded.
+ ******************************************/
+
+class Frame_Profiler
+{
+  public :
+
+    // The kinds of frames
+
+    enum Kind
+    {
+        Full_Redraw,
+        Scroll,
+        Grid_Update
+    };
+
+
+    // The phases of a frame
+
+    enum Phase
+    {
+        Clear,
+        Draw,
+        Update,
+        Num_Phases
+    };
+
+
+    // Data of a single frame
+
+    struct Frame
+    {
+        unsigned long long time;
+        Kind kind;
+        int font_size;
+        int lines;
+        int segments;
+        unsigned long glyphs;
+        unsigned long phase_time[ Num_Phases ];
+    };
+
+
+    // Constructor, 'size' is the number of frames to be kept (0 switches
+    // profiling off)
+
+    explicit
+    Frame_Profiler( std::size_t size );
+
+
+    ~Frame_Profiler( );
+
+
+    // Returns if frames are recorded at all
+
+    bool
+    is_enabled( ) const  { return ! m_frames.empty( ); }
+
+
+    // Starts recording a new frame
+
+    void
+    begin_frame( Kind kind,
+                 int  font_size );
+
+
+    // Records that a phase ended (it started when the previous one ended
+    // or, for the first one, when the frame was started)
+
+    void
+    end_phase( Phase phase );
+
+
+    // Stores the frame in the ring
+
+    void
+    end_frame( );
+
+
+    // Drops the frame currently recorded (if nothing was drawn after all)
+
+    void
+    cancel_frame( );
+
+
+    // Counts a (visible) line drawn
+
+    static void
+    count_line( )
+    {
+        if ( s_current )
+            s_current->lines++;
+    }
+
+
+    // Counts a segment of a line drawn and the glyphs in it
+
+    static void
+    count_segment( char const  * txt,
+                   std::size_t   len )
+    {
+        if ( s_current )
+            add_segment( txt, len );
+    }
+
+
+    // Writes the frames recorded (oldest first, times in microseconds)
+
+    void
+    write( std::ostream & out ) const;
+
+
+    // Writes mean, median, maximum etc. of the times of the phases
+
+    void
+    write_summary( std::ostream & out ) const;
+
+
+  private :
+
+    static void
+    add_segment( char const  * txt,
+                 std::size_t   len );
+
+
+    // Ring of frames, index where the next one goes and how many there are
+
+    std::vector< Frame > m_frames;
+
+
+    std::size_t m_next;
+
+
+    std::size_t m_count;
+
+
+    // Frame currently being recorded and when its current phase started
+
+    Frame m_frame;
+
+
+    unsigned long long m_phase_start;
+
+
+    // Frame that gets counted into (only set while a frame is recorded)
+
+    static Frame * s_current;
+};
+
+
+#endif
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
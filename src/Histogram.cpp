@@ -0,0 +1,138 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "Histogram.hpp"
+#include <iomanip>
+#include <algorithm>
+
+
+/******************************************
+ ******************************************/
+
+Histogram::Histogram( )
+{
+    clear( );
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+Histogram::add( unsigned long long value )
+{
+    m_counts[ bucket( value ) ]++;
+
+    if ( ! m_count++ || value < m_min )
+        m_min = value;
+    m_max = std::max( m_max, value );
+    m_sum += value;
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+Histogram::clear( )
+{
+    std::fill( m_counts, m_counts + Num_Buckets, 0UL );
+    m_count = 0;
+    m_sum   = 0;
+    m_min   = 0;
+    m_max   = 0;
+}
+
+
+/******************************************
+ ******************************************/
+
+unsigned long long
+Histogram::percentile( double fraction ) const
+{
+    if ( ! m_count )
+        return 0;
+
+    unsigned long needed = static_cast< unsigned long >( fraction * m_count );
+    unsigned long sum = 0;
+
+    for ( int i = 0; i < Num_Buckets - 1; ++i )
+        if ( ( sum += m_counts[ i ] ) > needed || sum == m_count )
+            return std::min( ( 1ULL << i ) - 1, m_max );
+
+    return m_max;
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+Histogram::write( std::ostream      & out,
+                  std::string const & name ) const
+{
+    out << std::left << std::setw( 24 ) << name << std::right
+        << std::setw( 8 )  << m_count
+        << std::setw( 10 ) << min( )
+        << std::setw( 10 ) << mean( )
+        << std::setw( 10 ) << percentile( 0.5 )
+        << std::setw( 10 ) << percentile( 0.9 )
+        << std::setw( 10 ) << percentile( 0.99 )
+        << std::setw( 10 ) << m_max << '\n';
+
+    for ( int i = 0; i < Num_Buckets; ++i )
+    {
+        if ( ! m_counts[ i ] )
+            continue;
+
+        bool is_last = i == Num_Buckets - 1;
+
+        out << ( is_last ? "    >  " : "    <= " ) << std::setw( 12 )
+            << ( 1ULL << ( is_last ? i - 1 : i ) ) - 1
+            << std::setw( 10 ) << m_counts[ i ] << '\n';
+    }
+}
+
+
+/******************************************
+ * Returns the number of the bucket a value belongs into
+ ******************************************/
+
+int
+Histogram::bucket( unsigned long long value )
+{
+    int i = 0;
+
+    while ( value && i < Num_Buckets - 1 )
+    {
+        value >>= 1;
+        ++i;
+    }
+
+    return i;
+}
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,117 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#if ! defined HISTOGRAM_HPP_
+#define HISTOGRAM_HPP_
+
+
+#include <ostream>
+#include <string>
+
+
+/******************************************
+ * Histogram of (time) values with buckets of exponentially growing
+ * size: bucket 0 is for the value 0, bucket i for values from 2^(i-1)
+ * up to 2^i - 1, and everything too large ends up in the last bucket.
+ * That's coarse, but cheap and good enough to see if something takes
+ * microseconds, milliseconds or seconds.
+ ******************************************/
+
+class Histogram
+{
+  public :
+
+    static int const Num_Buckets = 32;
+
+
+    Histogram( );
+
+
+    void
+    add( unsigned long long value );
+
+
+    void
+    clear( );
+
+
+    unsigned long
+    count( ) const  { return m_count; }
+
+
+    unsigned long long
+    min( ) const  { return m_count ? m_min : 0; }
+
+
+    unsigned long long
+    max( ) const  { return m_max; }
+
+
+    unsigned long long
+    mean( ) const  { return m_count ? m_sum / m_count : 0; }
+
+
+    // Returns an upper limit for the value below which the given fraction
+    // (between 0 and 1) of all values lies, i.e. the upper end of the
+    // bucket it's in (but not more than the largest value)
+
+    unsigned long long
+    percentile( double fraction ) const;
+
+
+    // Writes a line with count, minimum, mean, median, 90th and 99th
+    // percentile and maximum, followed by one per non-empty bucket
+
+    void
+    write( std::ostream      & out,
+           std::string const & name ) const;
+
+
+  private :
+
+    static int
+    bucket( unsigned long long value );
+
+
+    unsigned long m_counts[ Num_Buckets ];
+
+
+    unsigned long m_count;
+
+
+    unsigned long long m_sum;
+
+
+    unsigned long long m_min;
+
+
+    unsigned long long m_max;
+};
+
+
+#endif
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
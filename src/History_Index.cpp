@@ -0,0 +1,453 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "History_Index.hpp"
+#include <algorithm>
+#include <iterator>
+
+
+namespace
+{
+
+// Number of commands used since a command was last used after which its
+// uses count only half as much for ranking it
+
+double const Recency_Half_Count = 64;
+
+
+// Commands only get renumbered when at least this many numbers have been
+// given out
+
+unsigned long const Min_Renumber = 1024;
+
+
+/******************************************
+ * Compares lists by length
+ ******************************************/
+
+bool
+shorter( std::vector< unsigned long > const * a,
+         std::vector< unsigned long > const * b )
+{
+    return a->size( ) < b->size( );
+}
+
+}
+
+
+/******************************************
+ ******************************************/
+
+History_Index::History_Index( )
+    : m_num_postings( 0 )
+    , m_dead_postings( 0 )
+    , m_clock( 0 )
+{
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+History_Index::add( std::string const & cmd )
+{
+    Commands::iterator it = m_commands.find( cmd );
+
+    if ( it == m_commands.end( ) )
+    {
+        it = m_commands.insert( Commands::value_type( cmd, m_slots.size( ) ) )
+                                                                      .first;
+        Slot s = { &it->first, head( cmd ), 0, 0 };
+        m_slots.push_back( s );
+        add_postings( cmd, it->second );
+    }
+
+    Slot & s = m_slots[ it->second ];
+    s.uses++;
+    s.last_use = ++m_clock;
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+History_Index::set_uses( std::string const & cmd,
+                         double              uses )
+{
+    Commands::const_iterator it = m_commands.find( cmd );
+
+    if ( it != m_commands.end( ) )
+        m_slots[ it->second ].uses = uses;
+}
+
+
+/******************************************
+ * Removes a command. Its number stays in the lists for the trigrams
+ * until too many of the numbers are invalid.
+ ******************************************/
+
+void
+History_Index::remove( std::string const & cmd )
+{
+    Commands::iterator it = m_commands.find( cmd );
+
+    if ( it == m_commands.end( ) )
+        return;
+
+    std::vector< unsigned int > tri;
+    trigrams( cmd, tri );
+    m_dead_postings += tri.size( );
+
+    m_slots[ it->second ].cmd = 0;
+    m_commands.erase( it );
+
+    if (    m_slots.size( ) >= Min_Renumber
+         && (    2 * m_dead_postings > m_num_postings
+              || 2 * m_commands.size( ) < m_slots.size( ) ) )
+        renumber( );
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+History_Index::clear( )
+{
+    m_commands.clear( );
+    m_slots.clear( );
+    m_postings.clear( );
+    m_num_postings  = 0;
+    m_dead_postings = 0;
+}
+
+
+/******************************************
+ * Collects the commands matching and returns the best ones
+ ******************************************/
+
+void
+History_Index::search( std::string const          & query,
+                       std::size_t                  max_results,
+                       std::vector< std::string > & results ) const
+{
+    results.clear( );
+
+    if ( query.empty( ) || ! max_results )
+        return;
+
+    std::vector< Match > matches;
+
+    if ( query.size( ) < 3 )
+        find_prefixed( query, max_results, matches );
+    else
+    {
+        std::vector< unsigned int > tri;
+        trigrams( query, tri );
+
+        std::vector< Id_List const * > lists;
+
+        for ( std::size_t i = 0; i < tri.size( ); ++i )
+        {
+            Postings::const_iterator it = m_postings.find( tri[ i ] );
+            if ( it != m_postings.end( ) )
+                lists.push_back( &it->second );
+        }
+
+        std::sort( lists.begin( ), lists.end( ), shorter );
+
+        if ( lists.size( ) == tri.size( ) )
+            find_contained( query, lists, max_results, matches );
+
+        if ( matches.size( ) < max_results && tri.size( ) > 1 )
+            find_similar( query, tri.size( ), lists, max_results, matches );
+    }
+
+    std::sort_heap( matches.begin( ), matches.end( ) );
+
+    for ( std::size_t i = 0; i < matches.size( ); ++i )
+        results.push_back( *matches[ i ].slot->cmd );
+}
+
+
+/******************************************
+ * Adds a match to the ones found so far if it's among the best ones.
+ * They're kept as a heap with the worst one at the top, so it can be
+ * replaced quickly by a better one.
+ ******************************************/
+
+void
+History_Index::offer( Match const          & match,
+                      std::size_t            max_results,
+                      std::vector< Match > & matches )
+{
+    if ( matches.size( ) < max_results )
+    {
+        matches.push_back( match );
+        std::push_heap( matches.begin( ), matches.end( ) );
+    }
+    else if ( match < matches.front( ) )
+    {
+        std::pop_heap( matches.begin( ), matches.end( ) );
+        matches.back( ) = match;
+        std::push_heap( matches.begin( ), matches.end( ) );
+    }
+}
+
+
+/******************************************
+ * Finds the commands starting with a text shorter than a trigram by
+ * comparing it with the first bytes stored in the slots
+ ******************************************/
+
+void
+History_Index::find_prefixed( std::string const    & query,
+                              std::size_t            max_results,
+                              std::vector< Match > & matches ) const
+{
+    unsigned int mask = query.size( ) == 1 ? 0xff0000 : 0xffff00;
+    unsigned int wanted = head( query ) & mask;
+
+    for ( std::vector< Slot >::const_iterator it = m_slots.begin( );
+          it != m_slots.end( ); ++it )
+        if ( it->cmd && ( it->head & mask ) == wanted )
+        {
+            Match m = { 0, score( *it ), &*it };
+            offer( m, max_results, matches );
+        }
+}
+
+
+/******************************************
+ * Finds the commands containing the search text: only those in all lists
+ * (sorted by length) can, and they're found by intersecting the lists,
+ * starting with the shortest one. For a text that's just one trigram
+ * nothing more needs to be checked.
+ ******************************************/
+
+void
+History_Index::find_contained(
+                         std::string const                    & query,
+                         std::vector< Id_List const * > const & lists,
+                         std::size_t                            max_results,
+                         std::vector< Match >                 & matches ) const
+{
+    Id_List candidates( *lists.front( ) );
+    Id_List tmp;
+
+    for ( std::size_t i = 1; i < lists.size( ) && ! candidates.empty( ); ++i )
+    {
+        tmp.clear( );
+        std::set_intersection( candidates.begin( ), candidates.end( ),
+                               lists[ i ]->begin( ), lists[ i ]->end( ),
+                               std::back_inserter( tmp ) );
+        candidates.swap( tmp );
+    }
+
+    unsigned int query_head = head( query );
+
+    for ( Id_List::const_iterator id = candidates.begin( );
+          id != candidates.end( ); ++id )
+    {
+        Slot const & s = m_slots[ *id ];
+        if ( ! s.cmd )
+            continue;
+
+        int tier;
+
+        if (    s.head == query_head
+             && ! s.cmd->compare( 0, query.size( ), query ) )
+            tier = 0;
+        else if (    query.size( ) == 3
+                  || s.cmd->find( query ) != std::string::npos )
+            tier = 1;
+        else
+            continue;
+
+        Match m = { tier, score( s ), &s };
+        offer( m, max_results, matches );
+    }
+}
+
+
+/******************************************
+ * Finds commands having at least half of the trigrams of the search text
+ * (but not containing the text, those were already found). The number of
+ * lists each command is in gets counted in a table indexed by command
+ * number.
+ ******************************************/
+
+void
+History_Index::find_similar(
+                         std::string const                    & query,
+                         std::size_t                            num_trigrams,
+                         std::vector< Id_List const * > const & lists,
+                         std::size_t                            max_results,
+                         std::vector< Match >                 & matches ) const
+{
+    std::size_t needed = ( num_trigrams + 1 ) / 2;
+
+    if ( lists.size( ) < needed )
+        return;
+
+    std::vector< unsigned short > counts( m_slots.size( ) );
+
+    for ( std::size_t i = 0; i < lists.size( ); ++i )
+        for ( Id_List::const_iterator id = lists[ i ]->begin( );
+              id != lists[ i ]->end( ); ++id )
+            ++counts[ *id ];
+
+    for ( std::size_t id = 0; id < counts.size( ); ++id )
+    {
+        Slot const & s = m_slots[ id ];
+
+        if (    counts[ id ] < needed
+             || ! s.cmd
+             || (    counts[ id ] == num_trigrams
+                  && s.cmd->find( query ) != std::string::npos ) )
+            continue;
+
+        Match m = { 2, score( s ) * counts[ id ] / num_trigrams, &s };
+        offer( m, max_results, matches );
+    }
+}
+
+
+/******************************************
+ * Returns the first three bytes of a string (padded with zeros)
+ ******************************************/
+
+unsigned int
+History_Index::head( std::string const & str )
+{
+    unsigned int h = 0;
+
+    for ( std::size_t i = 0; i < 3; ++i )
+        h = h << 8 | ( i < str.size( ) ?
+                       static_cast< unsigned char >( str[ i ] ) : 0 );
+
+    return h;
+}
+
+
+/******************************************
+ * Returns the (sorted) trigrams of a string, each only once
+ ******************************************/
+
+void
+History_Index::trigrams( std::string const           & str,
+                         std::vector< unsigned int > & result )
+{
+    result.clear( );
+
+    for ( std::size_t i = 0; i + 2 < str.size( ); ++i )
+        result.push_back(   static_cast< unsigned char >( str[ i ] ) << 16
+                          | static_cast< unsigned char >( str[ i + 1 ] ) << 8
+                          | static_cast< unsigned char >( str[ i + 2 ] ) );
+
+    std::sort( result.begin( ), result.end( ) );
+    result.erase( std::unique( result.begin( ), result.end( ) ),
+                  result.end( ) );
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+History_Index::add_postings( std::string const & cmd,
+                             unsigned long       id )
+{
+    std::vector< unsigned int > tri;
+    trigrams( cmd, tri );
+
+    for ( std::size_t i = 0; i < tri.size( ); ++i )
+        m_postings[ tri[ i ] ].push_back( id );
+
+    m_num_postings += tri.size( );
+}
+
+
+/******************************************
+ * Numbers the commands still in the index anew (keeping their order)
+ * and creates the lists from scratch
+ ******************************************/
+
+void
+History_Index::renumber( )
+{
+    std::vector< Slot > old_slots;
+    old_slots.swap( m_slots );
+
+    m_postings.clear( );
+    m_num_postings  = 0;
+    m_dead_postings = 0;
+
+    for ( std::vector< Slot >::iterator it = old_slots.begin( );
+          it != old_slots.end( ); ++it )
+        if ( it->cmd )
+        {
+            unsigned long id = m_slots.size( );
+
+            m_commands[ *it->cmd ] = id;
+            m_slots.push_back( *it );
+            add_postings( *it->cmd, id );
+        }
+}
+
+
+/******************************************
+ * Returns how highly a command is to be ranked: the number of its uses,
+ * counting less the longer ago it was last used
+ ******************************************/
+
+double
+History_Index::score( Slot const & slot ) const
+{
+    return   slot.uses
+           / ( 1 + ( m_clock - slot.last_use ) / Recency_Half_Count );
+}
+
+
+/******************************************
+ * Better matches come first, then commands with a higher score, then
+ * the ones used more recently
+ ******************************************/
+
+bool
+History_Index::Match::operator < ( Match const & other ) const
+{
+    if ( tier != other.tier )
+        return tier < other.tier;
+    if ( score != other.score )
+        return score > other.score;
+    return slot->last_use > other.slot->last_use;
+}
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,216 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#if ! defined HISTORY_INDEX_HPP_
+#define HISTORY_INDEX_HPP_
+
+
+#include <string>
+#include <vector>
+#include <tr1/unordered_map>
+
+
+/******************************************
+ * Index for searching the command history. Each command gets a number
+ * and a slot in a table, holding how often and when it was last used and
+ * its first three bytes - which is all needed for finding the commands
+ * starting with a short text. For each sequence of three bytes (trigram)
+ * there's a list of the numbers of the commands containing it. A command
+ * containing a longer text must contain all of its trigrams, so only the
+ * commands in all of their lists need to be looked at. Commands with at
+ * least half of the trigrams are offered as "fuzzy" matches (e.g. for a
+ * mistyped search text).
+ *
+ * Since new commands get increasing numbers and the lists are only ever
+ * appended to they stay sorted and can be intersected by merging.
+ * Removing a command just empties its slot, the lists only get rebuilt
+ * (and the commands renumbered) when more than half of the numbers are
+ * invalid.
+ *
+ * Matches are ranked by how they match (texts at the start of commands
+ * first, then elsewhere, then fuzzy matches), then by how often and how
+ * recently the commands were used. How often a command was used before
+ * can be set from outside (the file commands get read from only has
+ * each one once after it has been rewritten), further uses add to it.
+ ******************************************/
+
+class History_Index
+{
+  public :
+
+    History_Index( );
+
+
+    // Adds a command or, if it's already known, counts another use of it
+
+    void
+    add( std::string const & cmd );
+
+
+    // Sets how often a command was used (without counting it as a use)
+
+    void
+    set_uses( std::string const & cmd,
+              double              uses );
+
+
+    void
+    remove( std::string const & cmd );
+
+
+    void
+    clear( );
+
+
+    std::size_t
+    size( ) const  { return m_commands.size( ); }
+
+
+    // Returns the (at most 'max_results') commands best matching a search
+    // text. Texts shorter than a trigram only match at the start of
+    // commands.
+
+    void
+    search( std::string const          & query,
+            std::size_t                  max_results,
+            std::vector< std::string > & results ) const;
+
+
+  private :
+
+    typedef std::tr1::unordered_map< std::string, unsigned long > Commands;
+
+
+    struct Slot
+    {
+        std::string const * cmd;
+        unsigned int head;
+        double uses;
+        unsigned long last_use;
+    };
+
+
+    typedef std::vector< unsigned long > Id_List;
+
+
+    typedef std::tr1::unordered_map< unsigned int, Id_List > Postings;
+
+
+    struct Match
+    {
+        int tier;
+        double score;
+        Slot const * slot;
+
+        bool
+        operator < ( Match const & other ) const;
+    };
+
+
+    static unsigned int
+    head( std::string const & str );
+
+
+    static void
+    trigrams( std::string const           & str,
+              std::vector< unsigned int > & result );
+
+
+    void
+    add_postings( std::string const & cmd,
+                  unsigned long       id );
+
+
+    void
+    renumber( );
+
+
+    static void
+    offer( Match const          & match,
+           std::size_t            max_results,
+           std::vector< Match > & matches );
+
+
+    void
+    find_prefixed( std::string const    & query,
+                   std::size_t            max_results,
+                   std::vector< Match > & matches ) const;
+
+
+    void
+    find_contained( std::string const                    & query,
+                    std::vector< Id_List const * > const & lists,
+                    std::size_t                            max_results,
+                    std::vector< Match >                 & matches ) const;
+
+
+    void
+    find_similar( std::string const                    & query,
+                  std::size_t                            num_trigrams,
+                  std::vector< Id_List const * > const & lists,
+                  std::size_t                            max_results,
+                  std::vector< Match >                 & matches ) const;
+
+
+    double
+    score( Slot const & slot ) const;
+
+
+    // Commands with their numbers
+
+    Commands m_commands;
+
+
+    // Slots of the commands by number (with the ones of commands removed
+    // having a null pointer for the command)
+
+    std::vector< Slot > m_slots;
+
+
+    // Lists of command numbers per trigram
+
+    Postings m_postings;
+
+
+    // Number of entries in all lists and how many of them are invalid
+
+    unsigned long m_num_postings;
+
+
+    unsigned long m_dead_postings;
+
+
+    // Number of uses of commands so far (used as the time they were last
+    // used)
+
+    unsigned long m_clock;
+};
+
+
+#endif
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
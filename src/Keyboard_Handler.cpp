@@ -21,6 +21,7 @@
 #include "Keyboard_Handler.hpp"
 #include "Messenger.hpp"
 #include "Config.hpp"
+#include "File_Watcher.hpp"
 #include "Utils.hpp"
 #include "Defaults.hpp"
 #include "Inkview.hpp"
@@ -40,9 +41,9 @@ Keyboard_Handler::Keyboard_Handler( Messenger & mess,
                                     Config    & config )
     : m_mess( mess )
     , m_keyboard_is_shown( false )
+    , m_is_search( false )
     , m_kbd_file( config.keyboard_file( ) )
-    , m_use_custom(    ! m_kbd_file.empty( )
-                    && ! access( m_kbd_file.c_str( ), R_OK ) )
+    , m_use_custom( ! m_kbd_file.empty( ) )
 {
     s_handling_keyboard = this;
 }
@@ -76,18 +77,36 @@ Keyboard_Handler::show( std::string const & default_command )
     // Note: we use 'MAX_CMD_LEN - 1' since due to a bug in libinkview
     // the user may enter one more glyph than that argument.
 
+    char const * title = m_is_search ?
+                         "Search command history for" :
+                         "Enter shell command (or 'exit' to quit)";
+
     if ( active_keyboard( ) == 0 )
-        OpenCustomKeyboard( m_kbd_file.c_str( ),
-                            "Enter shell command (or 'exit' to quit)",
+        OpenCustomKeyboard( m_kbd_file.c_str( ), title,
                             m_cmd_buffer, MAX_CMD_LEN - 1, 0,
                             &Keyboard_Handler::static_kbd_handler );
     else
-        OpenKeyboard( "Enter shell command (or 'exit' to quit)",
-                      m_cmd_buffer, MAX_CMD_LEN - 1, 0,
+        OpenKeyboard( title, m_cmd_buffer, MAX_CMD_LEN - 1, 0,
                       &Keyboard_Handler::static_kbd_handler );
 }
 
 
+/******************************************
+ * Gets the keyboard displayed to let the user enter a text to search
+ * the command history for
+ ******************************************/
+
+void
+Keyboard_Handler::show_search( )
+{
+    if ( m_keyboard_is_shown )
+        return;
+
+    m_is_search = true;
+    show( "" );
+}
+
+
 /******************************************
  * Returns -1 if there's no custom keyboard available, 0 if the custom
  * keyboard is in use and 1 if the default keyboard is used.
@@ -96,7 +115,8 @@ Keyboard_Handler::show( std::string const & default_command )
 int
 Keyboard_Handler::active_keyboard( )
 {
-    if ( m_kbd_file.empty( ) || access( m_kbd_file.c_str( ), R_OK ) )
+    request::Has_Custom_Keyboard hck;
+    if ( ! m_mess.send( hck ).result )
         return -1;
 
     return ! m_use_custom;
@@ -111,11 +131,22 @@ Keyboard_Handler::active_keyboard( )
 void
 Keyboard_Handler::use_custom_keyboard( bool yes_no )
 {
-    if ( ! m_kbd_file.empty( ) && ! access( m_kbd_file.c_str( ), R_OK ) )
+    request::Has_Custom_Keyboard hck;
+    if ( m_mess.send( hck ).result )
         m_use_custom = yes_no;
 }
 
 
+/******************************************
+ ******************************************/
+
+File_Content *
+Keyboard_Handler::check_kbd_file( std::string const & file_name )
+{
+    return access( file_name.c_str( ), R_OK ) ? 0 : new File_Content;
+}
+
+
 /******************************************
  * Helper function that can be called from C, redirects to the
  * real handler function
@@ -138,6 +169,9 @@ Keyboard_Handler::kbd_handler( char * cmd )
 {
     m_keyboard_is_shown = false;
 
+    bool is_search = m_is_search;
+    m_is_search = false;
+
     // Re-enable screen updates
 
     m_mess.send( message::Suspend_Display( false ) );
@@ -156,6 +190,14 @@ Keyboard_Handler::kbd_handler( char * cmd )
     if ( s.empty( ) )
         return;
 
+    if ( is_search )
+    {
+        m_mess.send( message::Search_History( s ) );
+        return;
+    }
+
+    m_mess.send( message::Trace_Point(
+                                 message::Trace_Point::Command_Accepted ) );
     m_mess.send( message::New_Command( s + "\n" ) );
 }
 
@@ -28,6 +28,7 @@
 
 class Messenger;
 class Config;
+class File_Content;
 
 
 /******************************************
@@ -46,6 +47,10 @@ class Keyboard_Handler
     show( std::string const & default_command );
 
 
+    void
+    show_search( );
+
+
     int
     active_keyboard( );
 
@@ -54,6 +59,13 @@ class Keyboard_Handler
     use_custom_keyboard( bool yes_no );
 
 
+    // Checks for the file watcher if a keyboard layout file exists (the
+    // layout itself gets read by libinkview each time it's used)
+
+    static File_Content *
+    check_kbd_file( std::string const & file_name );
+
+
   private :
 
     static void
@@ -74,6 +86,11 @@ class Keyboard_Handler
     bool m_keyboard_is_shown;
 
 
+    // Flag, set when the keyboard is used for entering a search text
+
+    bool m_is_search;
+
+
     // Buffer for keyboard input. Note: since UTF-8 characters seem to be
     // used internally and due to a bug in the keyboard code that alloes
     // entering one more glyph than the maximum length set via 'maxlen'
@@ -0,0 +1,106 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "Latency_Tracer.hpp"
+#include "Utils.hpp"
+
+
+namespace
+{
+
+// Names of the stages, i.e. what happens between two points
+
+char const * const Stage_Names[ ] = { "keyboard -> shell",
+                                      "shell -> first reply",
+                                      "reply -> lines",
+                                      "lines -> screen update" };
+
+}
+
+
+/******************************************
+ ******************************************/
+
+Latency_Tracer::Latency_Tracer( )
+    : m_last_point( -1 )
+{
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+Latency_Tracer::stamp( message::Trace_Point::Point point )
+{
+    if ( point == message::Trace_Point::Command_Accepted )
+        m_last_point = point;
+    else if (    m_last_point < 0
+              || (    point != m_last_point + 1
+                   && (    point != message::Trace_Point::Screen_Updated
+                        || m_last_point
+                                   != message::Trace_Point::Reply_Read ) ) )
+        return;
+
+    unsigned long long now = Utils::monotonic_microseconds( );
+    m_times[ point ] = now;
+
+    if ( point == message::Trace_Point::Command_Accepted )
+        return;
+
+    // A stage skipped gets counted as taking no time
+
+    if ( point != m_last_point + 1 )
+        m_times[ m_last_point + 1 ] = m_times[ m_last_point ];
+
+    for ( int i = m_last_point; i < point; ++i )
+        m_stages[ i ].add( m_times[ i + 1 ] - m_times[ i ] );
+
+    m_last_point = point;
+
+    if ( point == message::Trace_Point::Screen_Updated )
+    {
+        m_total.add( now - m_times[ message::Trace_Point::Command_Accepted ] );
+        m_last_point = -1;
+    }
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+Latency_Tracer::write( std::ostream & out ) const
+{
+    out << "Latencies (us)             count       min      mean    median"
+           "       90%       99%       max\n";
+
+    for ( int i = 0; i < Num_Points - 1; ++i )
+        m_stages[ i ].write( out, Stage_Names[ i ] );
+    m_total.write( out, "keyboard -> screen" );
+}
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
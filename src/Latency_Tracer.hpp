@@ -0,0 +1,101 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#if ! defined LATENCY_TRACER_HPP_
+#define LATENCY_TRACER_HPP_
+
+
+#include "Message.hpp"
+#include "Histogram.hpp"
+#include <ostream>
+
+
+/******************************************
+ * Class for measuring how long it takes from the user entering a command
+ * until the reply appears on the screen. The subsystems send it the
+ * points in time a command passes through (accepted from the keyboard,
+ * written to the shell, first reply read, reply added to the lines and
+ * screen update issued) and the time between them is collected in a
+ * histogram per stage. Only one command is followed at a time, entering
+ * a new one starts again from scratch.
+ ******************************************/
+
+class Latency_Tracer
+{
+  public :
+
+    Latency_Tracer( );
+
+
+    // Records that the command currently traced reached a point, ignored
+    // if there's none or the point isn't the one next to be expected
+    // (except for the screen update, the layout stage may be skipped when
+    // a reply ends up in the grid)
+
+    void
+    stamp( message::Trace_Point::Point point );
+
+
+    // Writes the histograms (times in microseconds)
+
+    void
+    write( std::ostream & out ) const;
+
+
+    // Returns if there's anything to report yet
+
+    bool
+    has_data( ) const  { return m_total.count( ) > 0; }
+
+
+  private :
+
+    static int const Num_Points = message::Trace_Point::Screen_Updated + 1;
+
+
+    // Times (in microseconds) the points were reached
+
+    unsigned long long m_times[ Num_Points ];
+
+
+    // Point last reached, -1 when there's no command to trace
+
+    int m_last_point;
+
+
+    // Histograms for the times between successive points and for the
+    // whole time
+
+    Histogram m_stages[ Num_Points - 1 ];
+
+
+    Histogram m_total;
+};
+
+
+#endif
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -21,15 +21,34 @@
 #include "Line.hpp"
 #include "Lines.hpp"
 #include "Inkview.hpp"
+#include "Metrics.hpp"
+#include "Alloc_Profile.hpp"
+#include "Frame_Profiler.hpp"
 #include <algorithm>
 
 
+// Counts how often the wrapping of a line gets calculated (in the main or
+// the worker thread)
+
+namespace
+{
+
+Metrics::Counter & s_wraps = Metrics::counter( "wrap calculations" );
+Metrics::Counter & s_truncated = Metrics::counter( "lines truncated" );
+
+}
+
+
 /***************************************
  ***************************************/
 
 Line::Line( std::string const & txt,
-            Lines const       * parent )
+            Lines const       * parent,
+            unsigned long       id )
     : m_parent( parent )
+    , m_id( id )
+    , m_is_pending( false )
+    , m_is_truncated( false )
 {
     store_detabbed( txt );
 }
@@ -59,13 +78,20 @@ Line::redraw( int y_position ) const
     std::size_t cnt = 1;
     std::size_t start = 0;
 
+    // The parts of the line get copied into a buffer that's kept around,
+    // so that redrawing doesn't allocate memory once it's large enough
+    // (lines are only drawn from the main thread)
+
+    static std::string part;
+
     for ( std::vector< std::size_t >::const_iterator it = m_break_pos.begin( );
           it != m_break_pos.end( ); ++it )
     {
         // Draw (part of the) line
 
-        DrawString( m_parent->x_margin( ), y_position,
-                    m_txt.substr( start, *it - start ).c_str( ) );
+        part.assign( m_txt, start, *it - start );
+        DrawString( m_parent->x_margin( ), y_position, part.c_str( ) );
+        Frame_Profiler::count_segment( part.data( ), part.size( ) );
 
         // Draw a small rectangle at end of the line if it wraps (and there's
         // enough space)
@@ -90,6 +116,19 @@ Line::redraw( int y_position ) const
 }
 
 
+/***************************************
+ * Draws the line in one piece (i.e. without wrapping it) at the
+ * given y-position, everything not fitting onto the screen is
+ * cut off by libinkview.
+ ***************************************/
+
+void
+Line::draw_unwrapped( int y_position ) const
+{
+    DrawString( m_parent->x_margin( ), y_position, m_txt.c_str( ) );
+}
+
+
 /***************************************
  * Checks where a line is to be split too fit on the screen and calculates
  * the height it will thus require
@@ -98,12 +137,67 @@ Line::redraw( int y_position ) const
 void
 Line::recalc( )
 {
+    m_is_pending = false;
     recalc_break_pos( );
     m_height =   m_break_pos.size( )
                * ( m_parent->font_size( ) + m_parent->line_spacing( ) );
 }
 
 
+/***************************************
+ * Marks the line as one for which the wrapping is going to be calculated
+ * in the background. Until then the number of lines it needed before
+ * is used as the best guess for its height.
+ ***************************************/
+
+void
+Line::mark_pending( )
+{
+    m_is_pending = true;
+    m_height =   std::max< std::size_t >( m_break_pos.size( ), 1 )
+               * ( m_parent->font_size( ) + m_parent->line_spacing( ) );
+}
+
+
+/***************************************
+ * Accepts positions for wrapping the line calculated in the background
+ ***************************************/
+
+void
+Line::set_break_pos( std::vector< std::size_t > & break_pos )
+{
+    m_is_pending = false;
+    m_break_pos.swap( break_pos );
+    break_pos.clear( );
+    m_height =   m_break_pos.size( )
+               * ( m_parent->font_size( ) + m_parent->line_spacing( ) );
+}
+
+
+/***************************************
+ * Cuts the text of the line off if it's longer than the maximum line
+ * length, making sure not to split an UTF-8 sequence. The memory not
+ * needed anymore is released since protecting against huge lines is
+ * the whole point of it.
+ ***************************************/
+
+void
+Line::truncate( std::size_t max_len )
+{
+    if ( m_txt.size( ) <= max_len )
+        return;
+
+    while ( max_len > 0 && ( m_txt[ max_len ] & 0xC0 ) == 0x80 )
+        --max_len;
+
+    std::string( m_txt, 0, max_len ).swap( m_txt );
+
+    if ( ! m_is_truncated )
+        s_truncated.add( );
+    m_is_truncated = true;
+}
+
+
 /***************************************
  * Calculates where a line needs to be wrapped if it's longer than fits
  * onto the screen
@@ -112,26 +206,50 @@ Line::recalc( )
 void
 Line::recalc_break_pos( )
 {
-    int width = StringWidth( m_txt.c_str( ) );
-    int available = m_parent->screen_width( );
-    std::size_t end = m_txt.size( );
+    calc_break_pos( m_txt, *m_parent, m_parent->screen_width( ),
+                    m_parent->continuation_symbol_width( ), m_break_pos );
+}
+
+
+/***************************************
+ * Calculates the positions where a text must be wrapped, using the
+ * object passed to it for determining the widths of parts of the text.
+ * Returns false if the measuring object couldn't tell the width. Since
+ * it doesn't depend on anything else it also can be used from threads
+ * other than the main thread (as long as the measure can).
+ ***************************************/
+
+bool
+Line::calc_break_pos( std::string const          & txt,
+                      Text_Measure const         & measure,
+                      int                          available,
+                      int                          continuation_width,
+                      std::vector< std::size_t > & break_pos )
+{
+    s_wraps.add( );
+
+    int width = measure.width( txt, 0, std::string::npos );
+    std::size_t end = txt.size( );
+
+    break_pos.clear( );
 
-    m_break_pos.clear( );
+    if ( width < 0 )
+        return false;
 
     // Nothing more to be done if the line fits into the availabe screen
     // width
 
     if ( width <= available )
     {
-        m_break_pos.push_back( end );
-        return;
+        break_pos.push_back( end );
+        return true;
     }
 
     // Start a guessing game where we've got to wrap
 
     std::size_t start = 0;
 
-    available -= m_parent->continuation_symbol_width( );
+    available -= continuation_width;
 
     while ( start < end )
     {
@@ -145,8 +263,10 @@ Line::recalc_break_pos( )
 
         while( 1 )
         {
-            int new_width =
-                          StringWidth( m_txt.substr( start, guess ).c_str( ) );
+            int new_width = measure.width( txt, start, guess );
+
+            if ( new_width < 0 )
+                return false;
 
             if ( new_width > available )
             {
@@ -179,13 +299,30 @@ Line::recalc_break_pos( )
             }
         }
 
-        start = std::min< int >( start + guess, end );
+        // Don't wrap within an UTF-8 sequence but before it - unless not
+        // even a single character fits, then it has to go on its own line
+
+        std::size_t pos = std::min( start + guess, end );
+
+        while ( pos > start && pos < end && ( txt[ pos ] & 0xC0 ) == 0x80 )
+            --pos;
+
+        if ( pos == start )
+            while ( ++pos < end && ( txt[ pos ] & 0xC0 ) == 0x80 )
+                /* empty */ ;
+
+        if ( pos != start + guess )
+            last_good_width = measure.width( txt, start, pos - start );
+
+        start = pos;
         width -= last_good_width; 
-        m_break_pos.push_back( start );
+        break_pos.push_back( start );
     }
 
     if ( start < end )
-        m_break_pos.push_back( end );
+        break_pos.push_back( end );
+
+    return true;
 }
          
 
@@ -197,12 +334,22 @@ Line::recalc_break_pos( )
 void
 Line::store_detabbed( std::string const & txt )
 {
+    Alloc_Profile::Scope scope( Alloc_Profile::Line_Store );
+
     m_txt.clear( );
 
+    // If lines are limited in length only the part of the text that might
+    // end up in the line needs to be looked at (plus one more byte to
+    // tell if it's too long), expanding tabs only makes it longer
+
+    std::size_t max_len = m_parent->max_line_length( );
+    std::size_t end = max_len ? std::min( txt.size( ), max_len + 1 )
+                              : txt.size( );
     std::size_t start = 0,
                 pos;
 
-    while ( ( pos = txt.find_first_of( "\t", start ) ) != std::string::npos )
+    while (    ( pos = txt.find_first_of( "\t", start ) ) < end
+            && ( ! max_len || m_txt.size( ) <= max_len ) )
     {
         m_txt.append( txt, start, pos - start );
         m_txt.append(   m_parent->tab_width( )
@@ -210,8 +357,11 @@ Line::store_detabbed( std::string const & txt )
         start = pos + 1;
     }
 
-    if ( start != txt.size( ) )
-        m_txt.append( txt, start, std::string::npos );
+    if ( start < end )
+        m_txt.append( txt, start, end - start );
+
+    if ( max_len )
+        truncate( max_len );
 
     recalc( );
 }
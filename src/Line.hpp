@@ -24,6 +24,7 @@
 
 #include <string>
 #include <vector>
+#include "Text_Measure.hpp"
 
 
 class Lines;
@@ -39,7 +40,8 @@ class Line
   public :
 
     Line( std::string const & txt,
-          Lines const       * parent );
+          Lines const       * parent,
+          unsigned long       id );
 
 
     // Appends more text to the end of the line
@@ -54,6 +56,12 @@ class Line
     redraw( int y_offset ) const;
 
 
+    // Draws the line without wrapping it at a given y-position
+
+    void
+    draw_unwrapped( int y_position ) const;
+
+
     // Recalculates how the line is to be displayed when any display
     // settings change (i.e. font size or orientation)
 
@@ -61,12 +69,73 @@ class Line
     recalc( );
 
 
+    // Marks the line as waiting for its wrapping to be calculated in the
+    // background, in the mean time its old number of (wrapped) lines is
+    // used for estimating its height
+
+    void
+    mark_pending( );
+
+
+    // Sets the positions where the line is to be wrapped as calculated in
+    // the background (the vector passed to the method gets emptied)
+
+    void
+    set_break_pos( std::vector< std::size_t > & break_pos );
+
+
     // Returns the height the line needs on the screen
 
     int
     height( ) const  { return m_height; }
 
 
+    // Returns the text of the line
+
+    std::string const &
+    text( ) const  { return m_txt; }
+
+
+    // Returns the unique number identifying the line
+
+    unsigned long
+    id( ) const  { return m_id; }
+
+
+    // Returns if the wrapping of the line still has to be calculated
+
+    bool
+    is_pending( ) const  { return m_is_pending; }
+
+
+    // Returns the positions where the line gets wrapped
+
+    std::vector< std::size_t > const &
+    break_pos( ) const  { return m_break_pos; }
+
+
+    // Returns the number of bytes needed for the text of the line and
+    // the positions it's wrapped at (the sizes and not the capacities
+    // are used since the latter change when lines get copied around)
+
+    std::size_t
+    memory_use( ) const
+    {
+        return m_txt.size( ) + m_break_pos.size( ) * sizeof( std::size_t );
+    }
+
+
+    // Calculates where a text must be wrapped to fit into the available
+    // width, returns false if this can't be done with the measure used
+
+    static bool
+    calc_break_pos( std::string const        & txt,
+                    Text_Measure const       & measure,
+                    int                        available,
+                    int                        continuation_width,
+                    std::vector< std::size_t > & break_pos );
+
+
   private :
 
     // Calculates at which positions in the line wrapping is needed
@@ -75,6 +144,12 @@ class Line
     recalc_break_pos( );
 
 
+    // Cuts the text off at (at most) the given length
+
+    void
+    truncate( std::size_t max_len );
+
+
     // Expand tabs and store the data of the line
 
     void
@@ -99,6 +174,21 @@ class Line
     // Vector of indices into the lines text where wrapping must be done
 
     std::vector< std::size_t > m_break_pos;
+
+
+    // Number identifying the line
+
+    unsigned long m_id;
+
+
+    // Flag, set while the wrapping is calculated in the background
+
+    bool m_is_pending;
+
+
+    // Flag, set when the text was cut off for being too long
+
+    bool m_is_truncated;
 };
 
 
@@ -18,9 +18,26 @@
  */
 
 
-#include "Lines.hpp"
 #include "Lines.hpp"
 #include "Utils.hpp"
+#include "Metrics.hpp"
+#include "Frame_Profiler.hpp"
+#include <algorithm>
+#include <sstream>
+
+
+// Metrics about the lines
+
+namespace
+{
+
+Metrics::Counter & s_lines_added   = Metrics::counter( "lines added" );
+Metrics::Counter & s_lines_evicted = Metrics::counter( "lines evicted" );
+Metrics::Counter & s_string_widths = Metrics::counter( "StringWidth calls" );
+Metrics::Gauge & s_scrollback_lines = Metrics::gauge( "scrollback lines" );
+Metrics::Gauge & s_scrollback_bytes = Metrics::gauge( "scrollback bytes" );
+
+}
 
 
 /***************************************
@@ -33,9 +50,40 @@
 void
 Lines::add( std::string const & txt )
 {
+    if ( txt.empty( ) )
+        return;
+
     // Split the input into lines at line feeds
 
     std::vector< std::string > lines = Utils::split_string( txt, "\n" );
+
+    // With a limit on the memory to be used there's no point in setting
+    // up more of the new lines than could be kept anyway. And if not even
+    // all of the new ones fit none of the old ones can stay, otherwise
+    // old lines are dropped before adding the new ones, so the list of
+    // lines doesn't grow larger than necessary.
+
+    if ( m_max_bytes )
+    {
+        std::size_t needed = 0;
+        std::size_t i = lines.size( );
+
+        while ( i > 0 && needed < m_max_bytes )
+            needed += lines[ --i ].size( ) + sizeof( Line );
+
+        if ( i > 0 )
+        {
+            lines.erase( lines.begin( ), lines.begin( ) + i );
+
+            s_lines_evicted.add( m_lines.size( ) );
+            m_lines.clear( );
+            m_line_bytes = 0;
+            m_is_unfinished_line = false;
+        }
+        else
+            enforce_memory_budget( needed );
+    }
+
     std::size_t line_count = lines.size( );
 
     // Add the new line, making sure that no more than a maximum number
@@ -43,11 +91,16 @@ Lines::add( std::string const & txt )
 
     if ( line_count >= m_max_lines )
     {
+        s_lines_evicted.add( m_lines.size( ) );
         m_lines.clear( );
+        m_line_bytes = 0;
+
         for ( std::vector< std::string >::iterator it =
                                      lines.begin( ) + line_count - m_max_lines;
               it != lines.end( ); ++it )
-            m_lines.push_back( Line( *it, this ) );
+            push_line( *it );
+
+        s_lines_added.add( m_max_lines );
     }
     else
     {
@@ -57,7 +110,11 @@ Lines::add( std::string const & txt )
 
         if ( m_lines.size( ) && m_is_unfinished_line )
         {
-            m_lines[ m_lines.size( ) - 1 ].append( lines.front( ) );
+            Line & last = m_lines[ m_lines.size( ) - 1 ];
+
+            m_line_bytes -= last.memory_use( );
+            last.append( lines.front( ) );
+            m_line_bytes += last.memory_use( );
             lines.erase( lines.begin( ) );
         }
 
@@ -68,12 +125,20 @@ Lines::add( std::string const & txt )
 
             std::size_t len = m_lines.size( ) + lines.size( );
             if ( len > m_max_lines )
+            {
+                for ( std::size_t i = 0; i < len - m_max_lines; ++i )
+                    m_line_bytes -= m_lines[ i ].memory_use( );
+
                 m_lines.erase( m_lines.begin( ),
                                m_lines.begin( ) + len - m_max_lines );
+                s_lines_evicted.add( len - m_max_lines );
+            }
 
             for ( std::vector< std::string>::iterator it = lines.begin( );
                   it != lines.end( ); ++it )
-                m_lines.push_back( Line( *it, this ) );
+                push_line( *it );
+
+            s_lines_added.add( lines.size( ) );
         }
     }
 
@@ -81,12 +146,84 @@ Lines::add( std::string const & txt )
 
     m_is_unfinished_line = txt[ txt.size( ) - 1 ] != '\n';
 
+    enforce_memory_budget( );
+
+    s_scrollback_lines.set( m_lines.size( ) );
+    s_scrollback_bytes.set( memory_use( ) );
+
     // Let's see how long the complete new text is
 
     recalc_height( );
 }
 
 
+/***************************************
+ * Appends a new line made from the text passed to the method
+ ***************************************/
+
+void
+Lines::push_line( std::string const & txt )
+{
+    m_lines.push_back( Line( txt, this, m_next_id++ ) );
+    m_line_bytes += m_lines.back( ).memory_use( );
+}
+
+
+/***************************************
+ * Recalculates the wrapping of a line. Since this may change the
+ * memory it uses the total is updated accordingly.
+ ***************************************/
+
+void
+Lines::recalc_line( Line & line )
+{
+    m_line_bytes -= line.memory_use( );
+    line.recalc( );
+    m_line_bytes += line.memory_use( );
+}
+
+
+/***************************************
+ * Drops the oldest lines as long as the lines (plus the number of bytes
+ * about to be added) use more memory than the budget allows for - but
+ * never the newest line, that one gets shortened if it's too long when
+ * a maximum line length is set. Each line is accounted for with the
+ * memory needed for its text and the positions it's wrapped at plus its
+ * slot in the list of lines. Since recalculating the wrapping of lines
+ * may change how much memory they need this isn't only done when lines
+ * get added.
+ ***************************************/
+
+void
+Lines::enforce_memory_budget( std::size_t incoming )
+{
+    if ( ! m_max_bytes )
+        return;
+
+    std::size_t used =   m_line_bytes + m_lines.size( ) * sizeof( Line )
+                       + incoming;
+    std::size_t count = 0;
+    int height = 0;
+
+    while ( used > m_max_bytes && count + 1 < m_lines.size( ) )
+    {
+        std::size_t line_bytes = m_lines[ count ].memory_use( );
+        used -= line_bytes + sizeof( Line );
+        m_line_bytes -= line_bytes;
+        height += m_lines[ count++ ].height( );
+    }
+
+    if ( ! count )
+        return;
+
+    m_lines.erase( m_lines.begin( ), m_lines.begin( ) + count );
+    s_lines_evicted.add( count );
+
+    m_height -= height;
+    m_y_position = std::max( m_y_position - height, 0 );
+}
+
+
 /***************************************
  * Function to inform the object about new screen dimensions (due to a
  * rotation). Induces a recalculation of all lines.
@@ -117,19 +254,218 @@ Lines::change_font_size( int new_font_size )
 /***************************************
  * Makes all lines recalculate themselves (might be due to a change of font
  * or the screen dimensions) and then determines the new total height.
+ * Only the lines at the end (i.e. those that are going to be shown) are
+ * dealt with immediately, if there are lots of further lines and the
+ * widths of the characters of the font are known they get handed to the
+ * worker thread and are recalculated in the background.
  ***************************************/
 
 void
 Lines::recalc( )
 {
-    for ( std::vector< Line >::iterator it = m_lines.begin( );
-          it != m_lines.end( ); ++it )
-        it->recalc( );
+    m_worker.cancel( );
+    m_layout_generation++;
+
+    std::size_t i = m_lines.size( );
+    int h = 0;
+
+    while ( i > 0 && h < RELAYOUT_SYNC_SCREENS * m_screen_height )
+    {
+        recalc_line( m_lines[ --i ] );
+        h += m_lines[ i ].height( );
+    }
 
+    if (    i < RELAYOUT_MIN_LINES
+         || ! m_char_widths
+         || ! start_background_relayout( i ) )
+        for ( std::size_t j = 0; j < i; ++j )
+            recalc_line( m_lines[ j ] );
+
+    enforce_memory_budget( );
     recalc_height( );
 }
 
 
+/***************************************
+ * Passes copies of the texts of the first 'count' lines to the worker
+ * thread for calculating their wrapping. Until the results arrive these
+ * lines use an estimate for their height.
+ ***************************************/
+
+bool
+Lines::start_background_relayout( std::size_t count )
+{
+    Relayout_Worker::Job * job = new Relayout_Worker::Job;
+
+    job->generation         = m_layout_generation;
+    job->first_id           = m_lines.front( ).id( );
+    job->char_widths        = *m_char_widths;
+    job->available          = m_screen_width;
+    job->continuation_width = m_continuation_symbol_width;
+
+    job->texts.reserve( count );
+    for ( std::size_t i = 0; i < count; ++i )
+    {
+        job->texts.push_back( m_lines[ i ].text( ) );
+        m_lines[ i ].mark_pending( );
+    }
+
+    return m_worker.start( job );
+}
+
+
+/***************************************
+ * Takes over all blocks of lines the worker thread is done with. Lines
+ * that have been removed or recalculated in the mean time are skipped.
+ * If the height of a line above the visible region changes the y-position
+ * is adjusted so that what's shown on the screen doesn't move. Returns
+ * if further results are to be expected.
+ ***************************************/
+
+bool
+Lines::collect_relayout_results( )
+{
+    Relayout_Worker::Block block;
+    bool is_at_end = m_y_position >= m_height - m_screen_height;
+
+    while ( m_worker.fetch( block ) )
+    {
+        if ( block.generation != m_layout_generation || m_lines.empty( ) )
+            continue;
+
+        unsigned long first_id = m_lines.front( ).id( );
+        std::size_t idx = block.first_id > first_id ?
+                          block.first_id - first_id : 0;
+
+        // Find the position of the first line of the block
+
+        int top = 0;
+        for ( std::size_t i = 0; i < idx && i < m_lines.size( ); ++i )
+            top += m_lines[ i ].height( );
+
+        for ( ; idx < m_lines.size( ); ++idx )
+        {
+            std::size_t k = m_lines[ idx ].id( ) - block.first_id;
+
+            if ( k >= block.break_pos.size( ) )
+                break;
+
+            Line & line = m_lines[ idx ];
+            int old_height = line.height( );
+
+            if ( line.is_pending( ) )
+            {
+                m_line_bytes -= line.memory_use( );
+                if ( block.break_pos[ k ].empty( ) )
+                    line.recalc( );
+                else
+                    line.set_break_pos( block.break_pos[ k ] );
+                m_line_bytes += line.memory_use( );
+
+                m_height += line.height( ) - old_height;
+                if ( top < m_y_position )
+                    m_y_position += line.height( ) - old_height;
+            }
+
+            top += line.height( );
+        }
+    }
+
+    enforce_memory_budget( );
+    clamp_y_position( is_at_end );
+
+    return m_worker.is_busy( );
+}
+
+
+/***************************************
+ * Makes sure that all lines that are (at least partially) visible
+ * have been set up completely, i.e. recalculates those lines for
+ * which results from the worker thread haven't arrived yet.
+ ***************************************/
+
+void
+Lines::prepare_visible( )
+{
+    while ( recalc_visible_pending( ) )
+        /* empty */ ;
+}
+
+
+/***************************************
+ * Makes sure lines near the visible area are ready to be shown, so
+ * scrolling to them doesn't stall
+ ***************************************/
+
+void
+Lines::prefetch( int margin )
+{
+    while ( recalc_visible_pending( margin ) )
+        /* empty */ ;
+}
+
+
+/***************************************
+ * Recalculates visible lines (or lines not farther away from the
+ * visible area than 'margin') still waiting for the worker thread.
+ * Since this may change what is visible it returns true if any
+ * line was recalculated.
+ ***************************************/
+
+bool
+Lines::recalc_visible_pending( int margin )
+{
+    bool is_at_end = m_y_position >= m_height - m_screen_height;
+    bool found = false;
+    int h = - m_y_position;
+
+    for ( std::vector< Line >::iterator it = m_lines.begin( );
+          it != m_lines.end( ) && h < m_screen_height + margin; ++it )
+    {
+        if ( h + it->height( ) >= - margin && it->is_pending( ) )
+        {
+            int old_height = it->height( );
+            recalc_line( *it );
+
+            // If the line starts above the visible area keep the text
+            // shown where it is
+
+            int diff = it->height( ) - old_height;
+            m_height += diff;
+            if ( h < 0 )
+            {
+                m_y_position += diff;
+                h -= diff;
+            }
+            found = true;
+        }
+
+        h += it->height( );
+    }
+
+    enforce_memory_budget( );
+    clamp_y_position( is_at_end );
+    return found && is_at_end;
+}
+
+
+/***************************************
+ * Makes sure the y-position is within the range of allowed values. If
+ * the last line was shown before it's kept shown.
+ ***************************************/
+
+void
+Lines::clamp_y_position( bool stick_to_end )
+{
+    int max_y = std::max( m_height - m_screen_height, 0 );
+
+    if ( stick_to_end || m_y_position > max_y )
+        m_y_position = max_y;
+    else if ( m_y_position < 0 )
+        m_y_position = 0;
+}
+
+
 /***************************************
  * Computes the total height and recalculates the y-position
  ***************************************/
@@ -173,10 +509,138 @@ Lines::redraw( ) const
     {
         it->redraw( h + m_y_margin );
         h += it->height( );
+        Frame_Profiler::count_line( );
     }     
 }
 
 
+/***************************************
+ * Draws the last lines with the font currently set, but without any
+ * wrapping and with the new line height, starting at the bottom of
+ * the screen. This is much faster than having to recalculate all
+ * lines and is used for giving the user an impression of how the
+ * text will look like while changing the font size.
+ ***************************************/
+
+void
+Lines::preview( int line_height ) const
+{
+    int y = m_screen_height + m_y_margin - line_height;
+
+    for ( std::vector< Line >::const_reverse_iterator it = m_lines.rbegin( );
+          it != m_lines.rend( ) && y > - line_height; ++it )
+    {
+        it->draw_unwrapped( y );
+        y -= line_height;
+    }
+}
+
+
+/***************************************
+ * Returns the width of a text, or the part of it starting at 'start' with
+ * the length 'len' (or up to its end). If the text consists of characters
+ * for which the widths are known they are simply summed up, otherwise the
+ * width has to be requested from libinkview.
+ ***************************************/
+
+int
+Lines::text_width( std::string const & txt,
+                   std::size_t         start,
+                   std::size_t         len ) const
+{
+    start = std::min( start, txt.size( ) );
+    std::size_t end = len < txt.size( ) - start ? start + len : txt.size( );
+
+    if ( m_char_widths )
+    {
+        int width = Char_Width_Measure( *m_char_widths ).width( txt, start,
+                                                                end - start );
+        if ( width >= 0 )
+            return width;
+    }
+
+    s_string_widths.add( );
+
+    if ( start == 0 && end == txt.size( ) )
+        return StringWidth( txt.c_str( ) );
+    return StringWidth( txt.substr( start, end - start ).c_str( ) );
+}
+
+
+/***************************************
+ * Checks that the sums kept about the lines (memory and height) are
+ * correct, the limits are kept and that each line is set up correctly,
+ * i.e. contains neither line-feeds nor tabs and has wrapping positions
+ * that are ascending, end at the end of the text and don't split UTF-8
+ * sequences.
+ ***************************************/
+
+std::string
+Lines::check( ) const
+{
+    std::ostringstream err;
+    std::size_t bytes = 0;
+    int height = 0;
+
+    if ( m_lines.size( ) > m_max_lines )
+        err << m_lines.size( ) << " lines, maximum is " << m_max_lines << '\n';
+
+    for ( std::size_t i = 0; i < m_lines.size( ); ++i )
+    {
+        Line const & line = m_lines[ i ];
+        std::string const & txt = line.text( );
+        std::vector< std::size_t > const & bp = line.break_pos( );
+
+        bytes  += line.memory_use( );
+        height += line.height( );
+
+        if ( i > 0 && line.id( ) <= m_lines[ i - 1 ].id( ) )
+            err << "line " << i << ": id not ascending\n";
+
+        if ( txt.find_first_of( "\n\t" ) != std::string::npos )
+            err << "line " << i << ": contains line-feed or tab\n";
+
+        if ( m_max_line_length && txt.size( ) > m_max_line_length )
+            err << "line " << i << ": " << txt.size( )
+                << " bytes long, maximum is " << m_max_line_length << '\n';
+
+        if ( line.is_pending( ) )
+            continue;
+
+        if ( bp.empty( ) || bp.back( ) != txt.size( ) )
+            err << "line " << i << ": wrapping doesn't end at end of text\n";
+
+        for ( std::size_t j = 0; j < bp.size( ); ++j )
+        {
+            if ( j > 0 && bp[ j ] <= bp[ j - 1 ] )
+                err << "line " << i << ": wrapping positions not ascending\n";
+            if ( bp[ j ] < txt.size( ) && ( txt[ bp[ j ] ] & 0xC0 ) == 0x80 )
+                err << "line " << i << ": wrapped within UTF-8 sequence\n";
+        }
+    }
+
+    if ( bytes != m_line_bytes )
+        err << "memory of lines is " << bytes << ", recorded is "
+            << m_line_bytes << '\n';
+
+    if (    m_max_bytes
+         && m_lines.size( ) > 1
+         && m_line_bytes + m_lines.size( ) * sizeof( Line ) > m_max_bytes )
+        err << "lines use " << m_line_bytes + m_lines.size( ) * sizeof( Line )
+            << " bytes, maximum is " << m_max_bytes << '\n';
+
+    if ( height != m_height )
+        err << "height of lines is " << height << ", recorded is "
+            << m_height << '\n';
+
+    if (    m_y_position < 0
+         || m_y_position > std::max( m_height - m_screen_height, 0 ) )
+        err << "y-position " << m_y_position << " out of range\n";
+
+    return err.str( );
+}
+
+
 /***************************************
  * Scrolls up or down by the given number of pixels (a positive number
  * moves the text downwards, a negative one upwards) a far as posible
@@ -25,6 +25,8 @@
 #include <string>
 #include <vector>
 #include "Line.hpp"
+#include "Text_Measure.hpp"
+#include "Relayout_Worker.hpp"
 #include "Defaults.hpp"
 #include "Inkview.hpp"
 
@@ -33,7 +35,7 @@
  * Class for storing all lines and drawing them.
  ***************************************/
 
-class Lines
+class Lines : public Text_Measure
 {
   public :
 
@@ -44,7 +46,9 @@ class Lines
            int tab_width,
            int x_margin,
            int y_margin,
-           int max_lines ) 
+           int max_lines,
+           int max_bytes,
+           int max_line_length ) 
         : m_screen_width( ScreenWidth( )   - 2 * x_margin )
         , m_screen_height( ScreenHeight( ) - 2 * y_margin )
         , m_font_size( font_size )
@@ -55,8 +59,13 @@ class Lines
         , m_continuation_symbol_width( CONTINUATION_SYMBOL_WIDTH )
         , m_y_position( 0 )
         , m_max_lines( max_lines )
+        , m_max_bytes( max_bytes )
+        , m_max_line_length( max_line_length )
         , m_is_unfinished_line( false )
-
+        , m_char_widths( 0 )
+        , m_next_id( 0 )
+        , m_layout_generation( 0 )
+        , m_line_bytes( 0 )
     { }
 
 
@@ -78,12 +87,68 @@ class Lines
     change_font_size( int new_font_size );
 
 
+    // Sets the table of character widths of the font in use
+
+    void
+    set_char_widths( std::vector< int > const * char_widths )
+    {
+        m_char_widths = char_widths;
+    }
+
+
+    // Returns the width of (a part of) a text in the current font
+
+    int
+    text_width( std::string const & txt,
+                std::size_t         start = 0,
+                std::size_t         len = std::string::npos ) const;
+
+
+    // Same as text_width(), needed to make the class usable as a measure
+    // for calculating the wrapping of lines
+
+    int
+    width( std::string const & txt,
+           std::size_t         start,
+           std::size_t         len ) const
+    {
+        return text_width( txt, start, len );
+    }
+
+
+    // Takes over results for lines whose wrapping was calculated in the
+    // background, returns if more are to be expected
+
+    bool
+    collect_relayout_results( );
+
+
+    // Makes sure all lines that are visible are completely set up
+
+    void
+    prepare_visible( );
+
+
+    // Sets up lines still waiting for the worker thread that are within
+    // a distance of 'margin' pixels above or below the visible area
+
+    void
+    prefetch( int margin );
+
+
     // Redraws everthing
 
     void
     redraw( ) const;
 
 
+    // Draws a quick, unwrapped preview of the last lines with the current
+    // font and a different line height
+
+    void
+    preview( int line_height ) const;
+
+
     // Scroll a number of pixels up or down
 
     void
@@ -139,12 +204,40 @@ class Lines
     continuation_symbol_width( ) const  { return m_continuation_symbol_width; }
 
 
+    // Returns if the last line added didn't end in a line-feed
+
+    bool
+    is_unfinished_line( ) const  { return m_is_unfinished_line; }
+
+
     // Return the total height of all lines
 
     int
     height( ) const  { return m_height; }
 
 
+    // Returns the maximum length of a line (0 if there's no limit)
+
+    std::size_t
+    max_line_length( ) const  { return m_max_line_length; }
+
+
+    // Returns (an estimate of) the number of bytes used by the lines
+
+    std::size_t
+    memory_use( ) const
+    {
+        return m_line_bytes + m_lines.capacity( ) * sizeof( Line );
+    }
+
+
+    // Checks the bookkeeping about the lines (for testing), returns an
+    // empty string if everything is consistent, otherwise what isn't
+
+    std::string
+    check( ) const;
+
+
   private :
 
     // Recalculates all lines and the resulting height
@@ -153,12 +246,49 @@ class Lines
     recalc( );
 
 
+    // Appends a new line
+
+    void
+    push_line( std::string const & txt );
+
+
+    // Recalculates a single line, keeping track of its memory use
+
+    void
+    recalc_line( Line & line );
+
+
+    // Removes the oldest lines while more memory is used than allowed
+
+    void
+    enforce_memory_budget( std::size_t incoming = 0 );
+
+
     // Recalculates the total height (and adjust y-position)
 
     void
     recalc_height( );
 
 
+    // Hands recalculation of the first 'count' lines to the worker thread
+
+    bool
+    start_background_relayout( std::size_t count );
+
+
+    // Sets up visible lines still waiting for the worker thread,
+    // returns true if there were any
+
+    bool
+    recalc_visible_pending( int margin = 0 );
+
+
+    // Keeps y-position within the allowed range
+
+    void
+    clamp_y_position( bool stick_to_end );
+
+
     // Screen width (reduced by x-margins)
 
     int m_screen_width;
@@ -222,9 +352,46 @@ class Lines
     std::size_t m_max_lines;
 
 
+    // Maximum number of bytes the lines may use (0 for no limit)
+
+    std::size_t m_max_bytes;
+
+
+    // Maximum length of a single line (0 for no limit)
+
+    std::size_t m_max_line_length;
+
+
     // Flag, set when the last line added didn't end in a line-feed
 
     bool m_is_unfinished_line;
+
+
+    // Widths of (ASCII) characters in the current font (if known)
+
+    std::vector< int > const * m_char_widths;
+
+
+    // Number to be given to the next new line
+
+    unsigned long m_next_id;
+
+
+    // Incremented each time all lines need to be recalculated, used
+    // to recognize outdated results from the worker thread
+
+    unsigned long m_layout_generation;
+
+
+    // Sum of the memory needed by all lines for their texts and
+    // wrapping positions
+
+    std::size_t m_line_bytes;
+
+
+    // Worker for calculating the wrapping of lines in the background
+
+    Relayout_Worker m_worker;
 };
 
 
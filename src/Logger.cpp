@@ -19,47 +19,89 @@
 
 
 #include "Logger.hpp"
+#include "Async_Writer.hpp"
 
 
 /******************************************
  ******************************************/
 
 void
-LogBuffer::switch_stream( std::streambuf * new_sb )
+LogBuffer::switch_stream( Async_Writer * writer )
 {
-    m_sb = new_sb;
+    drain( );
+    m_writer = writer;
 }
 
 
 /******************************************
+ * Called when the buffer is full: passes its content on and then puts
+ * the character into the (now empty) buffer
  ******************************************/
 
 int
 LogBuffer::overflow( int c )
 {
-    // This buffer has no buffer, instead every character "overflows"
-    // and can be put directly into whatever the streambuffer points to
+    drain( );
 
-    if ( c == EOF || ! m_sb )
-        return c;
+    if ( c == EOF )
+        return 0;
 
-    int ret = m_sb->sputc( c );
-    m_sb->pubsync( );
-    return ret == EOF ? EOF : c;
+    *pptr( ) = c;
+    pbump( 1 );
+    return c;
 }
 
 
 /******************************************
- * Destructor - close the log file if open
+ * Called when the stream gets flushed: passes the content of the buffer
+ * on and, for error messages, waits until it's written to the file
+ ******************************************/
+
+int
+LogBuffer::sync( )
+{
+    drain( );
+
+    if ( m_is_urgent && m_writer )
+        m_writer->flush( );
+    m_is_urgent = false;
+
+    return 0;
+}
+
+
+/******************************************
+ * Passes what's in the buffer on to the writer for the log file or, if
+ * there's none, the stream buffer
+ ******************************************/
+
+void
+LogBuffer::drain( )
+{
+    std::size_t len = pptr( ) - pbase( );
+
+    if ( ! len )
+        return;
+
+    if ( m_writer )
+        m_writer->write( pbase( ), len );
+    else if ( m_sb )
+        m_sb->sputn( pbase( ), len );
+
+    setp( m_buf, m_buf + Buffer_Size );
+}
+
+
+/******************************************
+ * Destructor - write out everything not yet written and close the log
+ * file if open
  ******************************************/
 
 Logger::~Logger( )
 {
-    if ( m_fstream )
-    {
-        m_fstream->close( );
-        delete m_fstream;
-    }
+    m_buffer.pubsync( );
+    m_buffer.switch_stream( 0 );
+    delete m_writer;
 }
 
 
@@ -69,60 +111,58 @@ Logger::~Logger( )
  ******************************************/
 
 bool
-Logger::set_file( std::string const & file_name )
+Logger::set_file( std::string const & file_name,
+                  std::size_t         max_size,
+                  int                 max_files )
 {
-    // Give up (and keep the old stream) if the argument is bogus, the path
+    // Give up (and keep the old file) if the argument is bogus, the path
     // to the new file can't be used or the file can't be opened
 
     if ( file_name.empty( ) || file_name[ file_name.size( ) - 1 ] == '/' )
         return false;
 
-    std::string path( Utils::prepare_file_creation( file_name ) );
-    if ( path.empty( ) )
-        return false;
+    Async_Writer * new_writer = new Async_Writer( );
 
-    std::ofstream * new_fstream = new std::ofstream( file_name.c_str( ) );
-    if ( ! new_fstream->is_open( ) )
+    if ( ! new_writer->open( file_name, max_size, max_files ) )
+    {
+        delete new_writer;
         return false;
+    }
 
-    // If this is a switch from one file to another close the file we were
-    // using up until now after copying it format flags to the new one.
+    // Pass on what's still in the buffer to where it was meant to go
 
-    if ( m_fstream )
-    {
-        new_fstream->flags( m_fstream->flags( ) );
-        m_fstream->close( );
-        delete m_fstream;
-    }
+    m_buffer.pubsync( );
 
-    // If we're switching away from the stringstream write its contents to
-    // the new file (and copy its format flags)
+    // If this is a switch from one file to another close the file we were
+    // using up until now (after everything has been written to it),
+    // otherwise write what got logged to the stringstream to the new file
 
-    if ( ! m_fstream )
+    if ( m_writer )
+        delete m_writer;
+    else
     {
-        *new_fstream << m_sstream.rdbuf( );
-        new_fstream->flush( );
-        new_fstream->flags( m_sstream.flags( ) );
+        std::string const & logged = m_sstream.str( );
+        new_writer->write( logged.data( ), logged.size( ) );
+        m_sstream.str( "" );
     }
 
-    // Set the new file "handle" as what we're going to log to in the future
-    // and make sure it's unbuffered
-
-    m_fstream = new_fstream;
-    m_fstream->rdbuf( )->pubsetbuf( 0, 0 );
-    m_buffer.switch_stream( m_fstream->rdbuf( ) );
+    m_writer = new_writer;
+    m_buffer.switch_stream( m_writer );
 
     return true;
 }
 
 
 /******************************************
- * Write out "ERROR: " and return the ostream for the text to be logged
+ * Write out "ERROR: " and return the ostream for the text to be logged.
+ * The message gets written to the file immediately when the stream gets
+ * flushed.
  ******************************************/
 
 std::ostream &
 Logger::error( )
 {
+    m_buffer.set_urgent( );
     *this << "ERROR: ";
     return *this;
 }
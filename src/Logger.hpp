@@ -24,13 +24,17 @@
 
 #include "Utils.hpp"
 #include <string>
-#include <fstream>
 #include <sstream>
 #include <streambuf>
 
 
+class Async_Writer;
+
+
 /******************************************
- * Helper class for logging
+ * Helper class for logging: collects what gets logged in a small buffer
+ * and passes it on in pieces, either to a stream buffer (as long as there
+ * is no log file yet) or to the object writing to the log file
  ******************************************/
 
 class LogBuffer : public std::streambuf
@@ -39,11 +43,24 @@ class LogBuffer : public std::streambuf
 
     LogBuffer( std::streambuf * sb )
         : m_sb( sb )
-    { }
+        , m_writer( 0 )
+        , m_is_urgent( false )
+    {
+        setp( m_buf, m_buf + Buffer_Size );
+    }
+
+
+    // Makes everything from now on go to the writer for the log file
+
+    void
+    switch_stream( Async_Writer * writer );
+
 
+    // Makes the next flush of the stream wait until everything has been
+    // written to the file
 
     void
-    switch_stream( std::streambuf * new_sb );
+    set_urgent( )  { m_is_urgent = true; }
 
 
   private:
@@ -52,13 +69,36 @@ class LogBuffer : public std::streambuf
     overflow( int c );
 
 
+    int
+    sync( );
+
+
+    void
+    drain( );
+
+
+    static std::size_t const Buffer_Size = 1024;
+
+
+    char m_buf[ Buffer_Size ];
+
+
     std::streambuf * m_sb;
+
+
+    Async_Writer * m_writer;
+
+
+    bool m_is_urgent;
 };
 
 
 
 /******************************************
- * Class for logging
+ * Class for logging. Writing to the log file is done by a thread of its
+ * own, so logging costs little more than copying the text. Only
+ * error messages get written out immediately when the stream is flushed
+ * (e.g. via std::endl), so they don't get lost if the program crashes.
  ******************************************/
 
 class Logger : public std::ostream
@@ -67,7 +107,7 @@ class Logger : public std::ostream
 
     Logger( )
         : std::ostream( &m_buffer )
-        , m_fstream( 0 )
+        , m_writer( 0 )
         , m_buffer( m_sstream.rdbuf( ) )
     { }
 
@@ -75,12 +115,17 @@ class Logger : public std::ostream
     ~Logger( );
 
 
+    // Sets the file to log to, with its maximum size (in bytes, 0 for no
+    // limit) and the number of older files kept when it gets too large
+
     bool
-    set_file( std::string const & file_name );
+    set_file( std::string const & file_name,
+              std::size_t         max_size = 0,
+              int                 max_files = 0 );
 
 
     bool
-    can_log( ) const  { return m_fstream != 0; }
+    can_log( ) const  { return m_writer != 0; }
 
 
     std::ostream &
@@ -100,7 +145,7 @@ class Logger : public std::ostream
     std::stringstream m_sstream;
 
 
-    std::ofstream * m_fstream;
+    Async_Writer * m_writer;
 
 
     LogBuffer m_buffer;
@@ -20,11 +20,16 @@
 
 #include "Menu_Handler.hpp"
 #include "Messenger.hpp"
+#include "Command_History.hpp"
 #include "Utils.hpp"
+#include "Defaults.hpp"
+#include "Alloc_Profile.hpp"
 #include <string>
 #include <vector>
 #include <dlfcn.h>
 #include <fstream>
+#include <sstream>
+#include <iterator>
 
 
 // Definition of the static member used to find the Menu_Handler instance
@@ -33,6 +38,51 @@
 Menu_Handler * Menu_Handler::s_handling_menu;
 
 
+namespace
+{
+
+// Entries of the submenu for playing back a recording
+
+struct Playback_Entry
+{
+    char const * text;
+    message::Playback::Action action;
+    int value;
+};
+
+
+Playback_Entry const Playback_Entries[ ] =
+{
+    { "Play",        message::Playback::Play,         1  },
+    { "Play 4x",     message::Playback::Play,         4  },
+    { "Play 16x",    message::Playback::Play,         16 },
+    { "Skip 10 s",   message::Playback::Skip,         10 },
+    { "Skip 60 s",   message::Playback::Skip,         60 },
+    { "Skip to end", message::Playback::Skip_To_End,  0  },
+    { "Stop",        message::Playback::Stop,         0  }
+};
+
+
+// Entries of the submenus for sending control characters and selecting
+// the keyboard
+
+char const * const Ctrl_Chars[ ] = { "^C", "^D", "^Z", "^[" };
+
+
+char const * const Keyboard_Names[ ] = { "Pbterm", "Default" };
+
+
+// Texts of the entries for going to the pages of the history with newer
+// and older commands (recognized by their addresses)
+
+char const Newer_Entry[ ] = "<< Newer commands";
+
+
+char const Older_Entry[ ] = "Older commands >>";
+
+}
+
+
 /***************************************
  * Constructor, creates the main menu's entries
  ***************************************/
@@ -40,22 +90,72 @@ Menu_Handler * Menu_Handler::s_handling_menu;
 Menu_Handler::Menu_Handler( Messenger & mess,
                             Config    & config )
     : m_mess( mess )
-    , m_user_cmd( read_user_cmd_file( config.user_cmd_file( ) ) )
+    , m_history( 0 )
+    , m_page( 0 )
+    , m_page_menu( 1 )
+    , m_history_version( static_cast< unsigned long >( -1 ) )
+    , m_user_cmd_version( 0 )
 {
     s_handling_menu = this;
 
-    // Create the main menu
+    // Create the main menu (the entry for the frame profile is only
+    // usable when frames get profiled at all)
 
-    imenu tmp[ ] = { { ITEM_SUBMENU, 0,           "Prev. commands", 0 },
-                     { ITEM_SUBMENU, 0,           "User commands",  0 },
-                     { ITEM_SUBMENU, 0,           "Send CTRL",      0 },
-                     { ITEM_SUBMENU, 0,           "Keyboard",       0 },
-                     { ITEM_ACTIVE,  Menu_Rotate, "Rotate",         0 },
-                     { ITEM_ACTIVE,  Menu_Exit,   "Exit",           0 },
-                     { 0,            0,           0,                0 } };
+    short frames_type = config.frame_profile( ) ? ITEM_ACTIVE : ITEM_INACTIVE;
+
+    imenu tmp[ ] = { { ITEM_SUBMENU, 0,           "Prev. commands",  0 },
+                     { ITEM_SUBMENU, 0,           "Suggested",       0 },
+                     { ITEM_SUBMENU, 0,           "User commands",   0 },
+                     { ITEM_SUBMENU, 0,           "Send CTRL",       0 },
+                     { ITEM_SUBMENU, 0,           "Keyboard",        0 },
+                     { ITEM_SUBMENU, 0,           "Playback",        0 },
+                     { ITEM_ACTIVE,  Menu_Search, "Search commands", 0 },
+                     { ITEM_ACTIVE,  Menu_Stats,  "Statistics",      0 },
+                     { frames_type,  Menu_Frames, "Frame profile",   0 },
+                     { ITEM_ACTIVE,  Menu_Rotate, "Rotate",          0 },
+                     { ITEM_ACTIVE,  Menu_Exit,   "Exit",            0 },
+                     { 0,            0,           0,                 0 } };
 
     for ( std::size_t i = 0; i < sizeof tmp / sizeof *tmp; ++i )
         m_main_menu.push_back( tmp[ i ] );
+
+    // Create the submenus. Each gets a range of indices of its own, large
+    // enough for all entries it may ever have, so it can be recreated
+    // without the others being affected. The one with the user commands,
+    // which may have any number of entries, comes last.
+
+    int const sizes[ ] =
+                { HISTORY_PAGE_SIZE + 1,
+                  config.suggestions( ),
+                  0,
+                  sizeof Ctrl_Chars / sizeof *Ctrl_Chars,
+                  sizeof Keyboard_Names / sizeof *Keyboard_Names,
+                  sizeof Playback_Entries / sizeof *Playback_Entries };
+
+    int start = Menu_First_Unused;
+
+    for ( int i = Menu_Cmd_List; i <= Menu_Playback; ++i )
+    {
+        m_submenus.push_back( Submenu( start ) );
+        start += sizes[ i ];
+    }
+
+    m_submenus[ Menu_User_Cmd ] = Submenu( start );
+
+    // The entries of the submenus for control characters, the keyboard
+    // and playback never change (only if they can be used)
+
+    for ( std::size_t i = 0; i < sizeof Ctrl_Chars / sizeof *Ctrl_Chars; ++i )
+        m_submenus[ Menu_Send_Ctrl ].add( ITEM_ACTIVE, Ctrl_Chars[ i ] );
+
+    for ( std::size_t i = 0;
+          i < sizeof Keyboard_Names / sizeof *Keyboard_Names; ++i )
+        m_submenus[ Menu_Keyboard ].add( ITEM_ACTIVE, Keyboard_Names[ i ] );
+
+    for ( std::size_t i = 0;
+          i < sizeof Playback_Entries / sizeof *Playback_Entries; ++i )
+        m_submenus[ Menu_Playback ].add( ITEM_ACTIVE,
+                                         Playback_Entries[ i ].text );
 }
 
 
@@ -67,18 +167,68 @@ void
 Menu_Handler::show( int x,
                     int y )
 {
-    // Set up the submenus with the list of previos commands and the
-    // control characters
+    // Bring the submenus up to date
 
     prepare_submenus( );
 
+    open( &m_main_menu.front( ), x, y, &Menu_Handler::static_menu_handler );
+}
+
+
+/***************************************
+ * Searches the command history and shows a menu with the commands found
+ * (best matches first), selecting one of them gets it shown in the
+ * keyboard for editing
+ ***************************************/
+
+void
+Menu_Handler::show_search_results( std::string const & query )
+{
+    request::Get_Command_List gcl;
+    m_mess.send( gcl ).result->search( query, HISTORY_SEARCH_RESULTS,
+                                       m_found );
+
+    m_results.clear( );
+
+    imenu header = { ITEM_HEADER, 0,
+                     const_cast< char * >( m_found.empty( ) ?
+                                           "No matching commands" :
+                                           "Matching commands" ),
+                     0 };
+    m_results.push_back( header );
+
+    for ( std::size_t i = 0; i < m_found.size( ); ++i )
+    {
+        imenu tmp = { ITEM_ACTIVE, static_cast< short >( i + 1 ),
+                      const_cast< char * >( m_found[ i ].c_str( ) ), 0 };
+        m_results.push_back( tmp );
+    }
+
+    imenu sentinel = { 0, 0, 0, 0 };
+    m_results.push_back( sentinel );
+
+    open( &m_results.front( ), ScreenWidth( ) / 2, ScreenHeight( ) / 2,
+          &Menu_Handler::static_results_handler );
+}
+
+
+/***************************************
+ * Shows a menu centered at x and y
+ ***************************************/
+
+void
+Menu_Handler::open( imenu          * menu,
+                    int              x,
+                    int              y,
+                    iv_menuhandler   handler )
+{
     // Try to get the width and height of the menu (for centering)
 
     int w = 0,
         h = 0;
     irect r;
 
-    if ( m_mess.GetMenuRect( &m_main_menu.front( ), r ) )
+    if ( m_mess.GetMenuRect( menu, r ) )
     {
         w = r.w;
         h = r.h;
@@ -90,8 +240,7 @@ Menu_Handler::show( int x,
 
     // Ask for the menu to be shown on the display
 
-    OpenMenu( &m_main_menu.front( ), 0, std::max< int >( 20, x - w / 2 ),
-              y - h / 2, &Menu_Handler::static_menu_handler );
+    OpenMenu( menu, 0, std::max< int >( 20, x - w / 2 ), y - h / 2, handler );
 }
 
 
@@ -118,6 +267,18 @@ Menu_Handler::menu_handler( int index )
 
     switch ( index )
     {
+        case Menu_Search :
+            m_mess.send( message::Show_Search_Keyboard( ) );
+            break;
+
+        case Menu_Stats :
+            m_mess.send( message::Show_Statistics( ) );
+            break;
+
+        case Menu_Frames :
+            m_mess.send( message::Dump_Frame_Profile( ) );
+            break;
+
         case Menu_Rotate :
             m_mess.send( message::Show_Rotate_Box( ) );
             break;
@@ -129,10 +290,57 @@ Menu_Handler::menu_handler( int index )
         default :
             submenu_command( index );
     }
+}
+
+
+/***************************************
+ ***************************************/
+
+void
+Menu_Handler::static_results_handler( int index )
+{
+    s_handling_menu->results_handler( index );
+}
+
+
+/***************************************
+ * Handles the selection from the menu with the commands found
+ ***************************************/
 
-    // Get rid of most memory needed for the submenus
+void
+Menu_Handler::results_handler( int index )
+{
+    m_mess.send( message::Suspend_Display( false ) );
 
-    m_submenus.clear( );    
+    if ( index > 0 && index <= static_cast< int >( m_found.size( ) ) )
+        m_mess.send( message::Show_Keyboard( m_found[ index - 1 ] ) );
+
+    m_results.clear( );
+    m_found.clear( );
+}
+
+
+/***************************************
+ ***************************************/
+
+void
+Menu_Handler::static_page_handler( int index )
+{
+    s_handling_menu->page_handler( index );
+}
+
+
+/***************************************
+ * Handles the selection from the menu for a page of the history
+ ***************************************/
+
+void
+Menu_Handler::page_handler( int index )
+{
+    m_mess.send( message::Suspend_Display( false ) );
+
+    if ( m_page_menu.has( index ) )
+        history_command( m_page_menu, index );
 }
 
 
@@ -145,9 +353,11 @@ void
 Menu_Handler::submenu_command( int index )
 {
     if ( m_submenus[ Menu_Cmd_List ].has( index ) )
+        history_command( m_submenus[ Menu_Cmd_List ], index );
+    else if ( m_submenus[ Menu_Suggested ].has( index ) )
         m_mess.send( message::Show_Keyboard(
-                              m_submenus[ Menu_Cmd_List ][ index ].text ) );
-    if ( m_submenus[ Menu_User_Cmd ].has( index ) )
+                              m_submenus[ Menu_Suggested ][ index ].text ) );
+    else if ( m_submenus[ Menu_User_Cmd ].has( index ) )
     {
         std::string txt = m_submenus[ Menu_User_Cmd ][ index ].text;
         if ( txt[ txt.size( ) - 1 ] == '#' )
@@ -163,62 +373,167 @@ Menu_Handler::submenu_command( int index )
                               m_submenus[ Menu_Send_Ctrl ][ index ].text ) );
     else if ( m_submenus[ Menu_Keyboard ].has( index ) )
         m_mess.send( message::Use_Custom_Keyboard(
-                     m_submenus[ Menu_Keyboard ][ index ].text == "Pbterm" ) );
+                     m_submenus[ Menu_Keyboard ].position( index ) == 0 ) );
+    else if ( m_submenus[ Menu_Playback ].has( index ) )
+    {
+        int pos = m_submenus[ Menu_Playback ].position( index );
+        Playback_Entry const & e = Playback_Entries[ pos ];
+        m_mess.send( message::Playback( e.action, e.value ) );
+    }
 }
 
 
 /***************************************
- * Creates the two submenus, one for the "Prev. command" entry of the
- * main menu and one for the "end CTRL" entry.
+ * Shows a menu with the page of the history m_page_start points to
  ***************************************/
 
 void
-Menu_Handler::prepare_submenus( )
+Menu_Handler::show_history_page( )
 {
-    m_submenus.clear( );
+    std::ostringstream title;
+    title << "Prev. commands, page " << m_page + 1 << " of "
+          << ( m_history->size( ) + HISTORY_PAGE_SIZE - 1 )
+             / HISTORY_PAGE_SIZE;
+    m_page_title = title.str( );
+
+    m_page_menu = Submenu( 1 );
+    m_page_menu.add( ITEM_HEADER, m_page_title.c_str( ) );
+    add_history_page( m_page_menu );
+
+    open( m_page_menu.addr( ), ScreenWidth( ) / 2, ScreenHeight( ) / 2,
+          &Menu_Handler::static_page_handler );
+}
+
+
+/***************************************
+ * Adds the commands of the page of the history m_page_start points to
+ * to a menu, most recent first, plus entries for getting at the pages
+ * with newer and older commands. Only the commands on the page are
+ * looked at, so this takes the same time however long the history is.
+ ***************************************/
+
+void
+Menu_Handler::add_history_page( Submenu & menu )
+{
+    if ( m_page )
+        menu.add( ITEM_ACTIVE, Newer_Entry );
+
+    Command_History::const_reverse_iterator it = m_page_start;
+
+    for ( std::size_t i = 0; i < HISTORY_PAGE_SIZE && it != m_history->rend( );
+          ++i, ++it )
+        menu.add( ITEM_ACTIVE, it->c_str( ) );
+
+    if ( it != m_history->rend( ) )
+        menu.add( ITEM_ACTIVE, Older_Entry );
+}
+
+
+/***************************************
+ * Deals with the selection of an entry from a page of the history,
+ * either a command to be edited or one of the entries for going to
+ * another page
+ ***************************************/
+
+void
+Menu_Handler::history_command( Submenu const & menu,
+                               int             index )
+{
+    char const * text = menu[ index ].text;
+
+    if ( text == Newer_Entry )
+    {
+        std::advance( m_page_start, - HISTORY_PAGE_SIZE );
+        --m_page;
+        show_history_page( );
+    }
+    else if ( text == Older_Entry )
+    {
+        std::advance( m_page_start, HISTORY_PAGE_SIZE );
+        ++m_page;
+        show_history_page( );
+    }
+    else
+        m_mess.send( message::Show_Keyboard( text ) );
+}
+
+
+/***************************************
+ * Brings the submenus up to date. They're only recreated when what they
+ * show has changed: the history (on which the suggestions also depend)
+ * or the file with the user commands. For the other ones it's only
+ * checked if they can be used.
+ ***************************************/
 
-    // Create the submenu for editing previous commands (with the items
-    // shown in reverse order of creation, i.e. with the most recent
-    // commands being shown at the top of the submenu)
+void
+Menu_Handler::prepare_submenus( )
+{
+    Alloc_Profile::Scope scope( Alloc_Profile::Submenus );
 
-    m_submenus.push_back( Submenu( Menu_First_Unused, Submenu::Reverse ) );
+    // The submenu for editing previous commands only has the first page
+    // of the history, with the most recent commands at the top
 
     request::Get_Command_List gcl;
-    std::vector< std::string > const * cmd_list = m_mess.send( gcl ).result;
+    m_history    = m_mess.send( gcl ).result;
+    m_page_start = m_history->rbegin( );
+    m_page       = 0;
+
+    if ( m_history->version( ) != m_history_version )
+    {
+        m_history_version = m_history->version( );
 
-    for ( std::vector< std::string >::const_iterator it = cmd_list->begin( );
-          it != cmd_list->end( ); ++it )
-        m_submenus.back( ).add( ITEM_ACTIVE, it->c_str( ) );
+        m_submenus[ Menu_Cmd_List ].clear( );
+        add_history_page( m_submenus[ Menu_Cmd_List ] );
 
-    // Create submenu with default commands
+        // Also recreate the submenu with the commands most likely to be
+        // needed next
 
-    m_submenus.push_back( Submenu( m_submenus.back( ).next_free_index( ) ) );
+        request::Get_Suggestions gs;
+        m_suggestions.swap( m_mess.send( gs ).result );
 
-    for ( std::vector< std::string >::const_iterator it = m_user_cmd.begin( );
-          it != m_user_cmd.end( ); ++it )
-        m_submenus.back( ).add( ITEM_ACTIVE, it->c_str( ) );
+        m_submenus[ Menu_Suggested ].clear( );
 
-    // Create the submenu for sending control characters
+        for ( std::vector< std::string >::const_iterator
+                                                  it = m_suggestions.begin( );
+              it != m_suggestions.end( ); ++it )
+            m_submenus[ Menu_Suggested ].add( ITEM_ACTIVE, it->c_str( ) );
+    }
+
+    // Recreate the submenu with the user commands if the file with them
+    // was read again since (it's read in the background when it changes)
+
+    request::Get_User_Commands guc;
+    m_mess.send( guc );
+
+    if ( guc.version != m_user_cmd_version )
+    {
+        m_user_cmd_version = guc.version;
+        m_user_cmd = guc.result;
 
-    char const * ctrl[ ] = { "^C", "^D", "^Z", "^[" };
+        m_submenus[ Menu_User_Cmd ].clear( );
 
-    m_submenus.push_back( Submenu( m_submenus.back( ).next_free_index( ) ) );
+        if ( m_user_cmd )
+        {
+            std::vector< std::string > const & cmds =
+                 static_cast< User_Commands const & >( *m_user_cmd ).commands;
 
-    for ( std::size_t i = 0; i < sizeof ctrl / sizeof *ctrl; ++i )
-        m_submenus.back( ).add( ITEM_ACTIVE, ctrl[ i ] );
+            for ( std::vector< std::string >::const_iterator
+                                                         it = cmds.begin( );
+                  it != cmds.end( ); ++it )
+                m_submenus[ Menu_User_Cmd ].add( ITEM_ACTIVE, it->c_str( ) );
+        }
+    }
 
-    // Add submenu for keyboard selection
+    // Mark the keyboard currently in use
 
     request::Get_Active_Keyboard gak;
     m_mess.send( gak );
 
-    char const * kbds[ ] = { "Pbterm", "Default" };
+    Submenu & kbds = m_submenus[ Menu_Keyboard ];
 
-    m_submenus.push_back( Submenu( m_submenus.back( ).next_free_index( ) ) );
-
-    for ( std::size_t i = 0; i < sizeof kbds / sizeof * kbds; ++i )
-        m_submenus.back( ).add( static_cast< int >( i ) == gak.result ?
-                                ITEM_BULLET : ITEM_ACTIVE, kbds[ i ] );
+    for ( int i = 0; i < kbds.size( ); ++i )
+        kbds[ kbds.start_index( ) + i ].type =
+                                   i == gak.result ? ITEM_BULLET : ITEM_ACTIVE;
 
     // Set them up in the main menu - it makes no sense to have the command
     // submenu shown at all if there are no previos commands. And if the
@@ -230,16 +545,30 @@ Menu_Handler::prepare_submenus( )
         m_main_menu[ Menu_Cmd_List ].type    = ITEM_SUBMENU;
         m_main_menu[ Menu_Cmd_List ].submenu =
                                            m_submenus[ Menu_Cmd_List ].addr( );
+        m_main_menu[ Menu_Search ].type      = ITEM_ACTIVE;
     }
     else
     {
         m_main_menu[ Menu_Cmd_List ].type    = ITEM_INACTIVE;
         m_main_menu[ Menu_Cmd_List ].submenu = 0;
+        m_main_menu[ Menu_Search ].type      = ITEM_INACTIVE;
     }
 
     //
 
-    if ( m_user_cmd.size( ) )
+    if ( m_suggestions.size( ) )
+    {
+        m_main_menu[ Menu_Suggested ].type    = ITEM_SUBMENU;
+        m_main_menu[ Menu_Suggested ].submenu =
+                                          m_submenus[ Menu_Suggested ].addr( );
+    }
+    else
+    {
+        m_main_menu[ Menu_Suggested ].type    = ITEM_INACTIVE;
+        m_main_menu[ Menu_Suggested ].submenu = 0;
+    }
+
+    if ( m_submenus[ Menu_User_Cmd ].size( ) )
     {
         m_main_menu[ Menu_User_Cmd ].type    = ITEM_SUBMENU;
         m_main_menu[ Menu_User_Cmd ].submenu =
@@ -280,22 +609,42 @@ Menu_Handler::prepare_submenus( )
         m_main_menu[ Menu_Keyboard ].type    = ITEM_INACTIVE;
         m_main_menu[ Menu_Keyboard ].submenu = 0;
     }
+
+    // Enable submenu for playing back a recording if there's one
+
+    request::Can_Play_Recording cpr;
+    if ( m_mess.send( cpr ).result )
+    {
+        m_main_menu[ Menu_Playback ].type    = ITEM_SUBMENU;
+        m_main_menu[ Menu_Playback ].submenu =
+                                           m_submenus[ Menu_Playback ].addr( );
+    }
+    else
+    {
+        m_main_menu[ Menu_Playback ].type    = ITEM_INACTIVE;
+        m_main_menu[ Menu_Playback ].submenu = 0;
+    }
 }
 
 
 /***************************************
- * Tries to read in the file with default commands
+ * Tries to read in the file with default commands (called from the
+ * file watcher's thread)
  ***************************************/
 
-std::vector< std::string >
-Menu_Handler::read_user_cmd_file( std::string cmd_file )
+File_Content *
+Menu_Handler::parse_user_cmd_file( std::string const & cmd_file )
 {
-    std::vector< std::string > cmd_list;
-
     // Try to open the file with default commands for reading
 
     std::ifstream ifs( cmd_file.c_str( ), std::ifstream::in );
 
+    if ( ! ifs.is_open( ) )
+        return 0;
+
+    User_Commands * uc = new User_Commands;
+    std::vector< std::string > & cmd_list = uc->commands;
+
     std::string  line;
 
     // Keep reading until the end of the file is reached
@@ -317,7 +666,7 @@ Menu_Handler::read_user_cmd_file( std::string cmd_file )
         cmd_list.push_back( line );
     }
 
-    return cmd_list;
+    return uc;
 }
 
 
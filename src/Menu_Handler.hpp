@@ -24,7 +24,10 @@
 
 #include "Submenu.hpp"
 #include "Config.hpp"
+#include "Command_History.hpp"
 #include <vector>
+#include <string>
+#include "File_Watcher.hpp"
 #include "Inkview.hpp"
 
 
@@ -49,11 +52,37 @@ class Menu_Handler
           int y );
 
 
+    void
+    show_search_results( std::string const & query );
+
+
+    // What the file watcher makes of the file with the user commands
+
+    struct User_Commands : public File_Content
+    {
+        std::vector< std::string > commands;
+    };
+
+
+    // Reads the file with the user commands for the file watcher (returns
+    // null if it can't be read)
+
+    static File_Content *
+    parse_user_cmd_file( std::string const & cmd_file );
+
+
   private :
 
     static Menu_Handler * s_handling_menu;
 
 
+    void
+    open( imenu          * menu,
+          int              x,
+          int              y,
+          iv_menuhandler   handler );
+
+
     static void
     static_menu_handler( int index );
 
@@ -62,10 +91,39 @@ class Menu_Handler
     menu_handler( int index );
 
 
+    static void
+    static_results_handler( int index );
+
+
+    void
+    results_handler( int index );
+
+
+    static void
+    static_page_handler( int index );
+
+
+    void
+    page_handler( int index );
+
+
     void
     submenu_command( int index );
 
 
+    void
+    show_history_page( );
+
+
+    void
+    add_history_page( Submenu & menu );
+
+
+    void
+    history_command( Submenu const & menu,
+                     int             index );
+
+
     void
     prepare_submenus( );
 
@@ -75,10 +133,6 @@ class Menu_Handler
                    int & h );
 
 
-    std::vector< std::string >
-    read_user_cmd_file( std::string cmd_file );
-
-
     // Messenger object that gets notified on menu selections
 
     Messenger & m_mess;
@@ -89,9 +143,14 @@ class Menu_Handler
 
     enum Menu_Items {
         Menu_Cmd_List,
+        Menu_Suggested,
         Menu_User_Cmd,
         Menu_Send_Ctrl,
         Menu_Keyboard,
+        Menu_Playback,
+        Menu_Search,
+        Menu_Stats,
+        Menu_Frames,
         Menu_Rotate,
         Menu_Exit,
         Menu_First_Unused
@@ -103,15 +162,63 @@ class Menu_Handler
     std::vector< imenu > m_main_menu;
 
 
-    // Storage for the submenus
+    // Storage for the submenus (kept between showing the menu and only
+    // recreated when needed)
 
     std::vector< Submenu > m_submenus;
 
 
-    // List of commands for the "Default commands" submenu
+    // The command history and the most recent command on the page of it
+    // currently shown (the first page with the most recent commands is
+    // shown in the "Prev. commands" submenu, the others each in a menu of
+    // their own)
+
+    Command_History const * m_history;
+
+
+    Command_History::const_reverse_iterator m_page_start;
+
+
+    std::size_t m_page;
+
+
+    // Menu for pages of the history but the first one and its title
+
+    Submenu m_page_menu;
+
+
+    std::string m_page_title;
+
+
+    // Version of the history the submenus for it and the suggestions
+    // were created for
+
+    unsigned long m_history_version;
+
+
+    // Version of the file with the user commands the submenu for them
+    // was created for
+
+    unsigned long m_user_cmd_version;
+
+
+    // List of commands for the "Suggested" submenu
+
+    std::vector< std::string > m_suggestions;
+
+
+    // List of commands for the "User commands" submenu
+
+    File_Watcher::Content_Ptr m_user_cmd;
+
+
+    // Menu with the commands found when searching the history and
+    // the commands themselves
+
+    std::vector< imenu > m_results;
 
 
-    std::vector< std::string > m_user_cmd;
+    std::vector< std::string > m_found;
 };
 
 
@@ -58,14 +58,19 @@ struct message
 
 
     // Message sent to request a vertical shift of the display
+    // (with 'fast' set while the user is still scrolling, allowing a
+    // lower quality but faster screen update)
 
     struct Shift_Display
     {
-        Shift_Display( int dist )
+        Shift_Display( int  dist,
+                       bool fast = false )
             : dist( dist )
+            , fast( fast )
         { }
 
         int dist;
+        bool fast;
     };
 
 
@@ -140,6 +145,31 @@ struct message
     struct Toggle_Recording { };
 
 
+    // Message sent when the user wants to play back the last recording,
+    // change the speed of playing (given as a multiple of the recorded
+    // speed), skip forward by some seconds or to the end or stop playing
+
+    struct Playback
+    {
+        enum Action
+        {
+            Play,
+            Skip,
+            Skip_To_End,
+            Stop
+        };
+
+        Playback( Action action,
+                  int    value = 0 )
+            : action( action )
+            , value( value )
+        { }
+
+        Action action;
+        int value;
+    };
+
+
     // Message sent when the keyboard is to be shown
 
     struct Show_Keyboard
@@ -152,6 +182,25 @@ struct message
     };
 
 
+    // Message sent when the keyboard for entering a text to search the
+    // command history for is to be shown
+
+    struct Show_Search_Keyboard { };
+
+
+    // Message sent with a text to search the command history for, the
+    // commands found are offered in a menu
+
+    struct Search_History
+    {
+        Search_History( std::string const & query )
+            : query( query )
+        { }
+
+        std::string const & query;
+    };
+
+
     // Message sent when the keyboard is to be shown
 
     struct Show_Menu
@@ -167,6 +216,54 @@ struct message
     };
 
 
+    // Message sent when the number of rows and columns that fit onto the
+    // screen has changed
+
+    struct Terminal_Size
+    {
+        Terminal_Size( int rows,
+                       int columns )
+            : rows( rows )
+            , columns( columns )
+        { }
+
+        int rows,
+            columns;
+    };
+
+
+    // Message sent when a command entered by the user (or the reply to
+    // it) reached one of the points where the latency gets measured
+
+    struct Trace_Point
+    {
+        enum Point
+        {
+            Command_Accepted,
+            Command_Sent,
+            Reply_Read,
+            Lines_Added,
+            Screen_Updated
+        };
+
+        Trace_Point( Point point )
+            : point( point )
+        { }
+
+        Point point;
+    };
+
+
+    // Message sent when the statistics are to be shown on the screen
+
+    struct Show_Statistics { };
+
+
+    // Message sent when the frame profile is to be written out and shown
+
+    struct Dump_Frame_Profile { };
+
+
     // Message sent to switch use of custom keyboard on or off
 
     struct Use_Custom_Keyboard
@@ -21,6 +21,7 @@
 #include "Messenger.hpp"
 #include "Logger.hpp"
 #include "Config.hpp"
+#include "File_Watcher.hpp"
 #include "Display.hpp"
 #include "Term.hpp"
 #include "Keyboard_Handler.hpp"
@@ -28,7 +29,18 @@
 #include "Button_Handler.hpp"
 #include "Pointer_Handler.hpp"
 #include "Rotation_Handler.hpp"
+#include "Latency_Tracer.hpp"
+#include "Stats_Writer.hpp"
+#include "Session_Recorder.hpp"
+#include "Session_Player.hpp"
+#include "Metrics.hpp"
+#include "Alloc_Profile.hpp"
+#include "Utils.hpp"
+#include "Defaults.hpp"
+#include <fstream>
+#include <sstream>
 #include <dlfcn.h>
+#include <unistd.h>
 
 
 /******************************************
@@ -37,14 +49,25 @@
 
 Messenger::Messenger( )
     : m_logger( 0 )
+    , m_config( 0 )
+    , m_watcher( 0 )
+    , m_config_file_id( -1 )
+    , m_user_cmd_file_id( -1 )
+    , m_kbd_file_id( -1 )
+    , m_config_version( 0 )
     , m_display( 0 )
     , m_term( 0 )
     , m_kbd_handler( 0 )
     , m_menu_handler( 0 )
     , m_button_handler( 0 )
     , m_pointer_handler( 0 )
+    , m_rotation_handler( 0 )
+    , m_tracer( 0 )
+    , m_stats_writer( 0 )
+    , m_recorder( 0 )
+    , m_player( 0 )
+    , m_is_dismissing_overlay( false )
     , m_is_shutting_down( false )
-    , m_is_recording( false )
     , m_inkview_handle( 0 )
     , m_GetMenuRect( 0 )
     , m_GetTouchInfo( 0 )
@@ -60,9 +83,29 @@ Messenger::Messenger( )
 
     // Read in and parse the configuration file
 
-    Config config( *m_logger );
+    m_config = new Config( *m_logger );
+    Config & config = *m_config;
+
+    // Set up watching the files the user may edit while the program runs
+    // (they get parsed in the background, so the thread is only started
+    // once everything else is set up)
+
+    m_watcher = new File_Watcher( );
+    m_config_file_id = m_watcher->add( CONFIG_FILE, &Config::parse_file );
+    m_user_cmd_file_id = m_watcher->add( config.user_cmd_file( ),
+                                         &Menu_Handler::parse_user_cmd_file );
+    if ( ! config.keyboard_file( ).empty( ) )
+        m_kbd_file_id = m_watcher->add( config.keyboard_file( ),
+                                        &Keyboard_Handler::check_kbd_file );
 
     m_font_step = config.font_step( );
+    m_recording_file = config.recording_file( );
+
+    if ( config.trace_latency( ) )
+    {
+        m_tracer = new Latency_Tracer( );
+        m_latency_file = config.latency_file( );
+    }
 
     // Initialize the display subsytem
 
@@ -87,6 +130,25 @@ Messenger::Messenger( )
     m_kbd_handler      = new Keyboard_Handler( *this, config );
     m_menu_handler     = new Menu_Handler( *this, config );
     m_rotation_handler = new Rotation_Handler( *this, config );
+
+    // Start writing statistics to a file (if requested)
+
+    m_stats_writer = new Stats_Writer( *this, config );
+
+    // Prepare for recording sessions and playing them back
+
+    m_recorder = new Session_Recorder( config.recording_max_size( ) * 1024UL,
+                                       config.recording_max_files( ) );
+    m_player   = new Session_Player( *this );
+
+    // Without the thread the files at least get read in once
+
+    if ( ! m_watcher->start( ) )
+    {
+        m_watcher->parse_all( );
+        m_logger->warn( ) << "Can't start thread for watching files, "
+                          << "changes to them will be ignored" << std::endl;
+    }
 }
 
 
@@ -96,6 +158,13 @@ Messenger::Messenger( )
 
 Messenger::~Messenger( )
 {
+    delete m_watcher;
+    delete m_player;
+    delete m_recorder;
+    delete m_stats_writer;
+    write_latencies( );
+    delete m_tracer;
+
     delete m_rotation_handler;
     delete m_pointer_handler;
     delete m_button_handler;
@@ -103,6 +172,7 @@ Messenger::~Messenger( )
     delete m_kbd_handler;
     delete m_term;
     delete m_display;
+    delete m_config;
     delete m_logger;
 
     if ( m_inkview_handle )
@@ -132,8 +202,8 @@ template < >
 void
 Messenger::send< message::New_Text >( message::New_Text const & mess )
 {
-    if ( m_is_recording )
-        *m_logger << mess.text;
+    if ( m_recorder && m_recorder->is_open( ) )
+        m_recorder->add( Session_Recorder::Output, mess.text );
 
     m_display->add_text( mess.text );
 }
@@ -150,8 +220,8 @@ Messenger::send< message::New_Command >( message::New_Command const & mess )
 {
     m_term->send_command( mess.cmd );
     m_display->add_text( mess.cmd );
-    if ( m_is_recording )
-        *m_logger << mess.cmd;
+    if ( m_recorder->is_open( ) )
+        m_recorder->add( Session_Recorder::Input, mess.cmd );
 }
 
 
@@ -172,14 +242,14 @@ Messenger::send< message::New_Ctrl_Char >( message::New_Ctrl_Char const & mess )
 
     m_term->send_control( mess.ctrl[ 1 ] - 'A' + 1 );
 
-    // A "^C" is normally shown on terminals
+    // A "^C" is normally shown on terminals. A recording gets what was
+    // shown, since that's what playing it back adds to the display.
 
     if ( mess.ctrl[ 1 ] == 'C' )
     {
         m_display->add_text( mess.ctrl );
-
-        if ( m_is_recording )
-            *m_logger << mess.ctrl;
+        if ( m_recorder->is_open( ) )
+            m_recorder->add( Session_Recorder::Input, mess.ctrl );
     }
 }
 
@@ -193,7 +263,7 @@ template < >
 void
 Messenger::send< message::Shift_Display >( message::Shift_Display const & mess )
 {
-    m_display->shift( mess.dist );
+    m_display->shift( mess.dist, mess.fast );
 }
 
 
@@ -207,11 +277,62 @@ void
 Messenger::send< message::Toggle_Recording >(
                                             message::Toggle_Recording const & )
 {
+    if ( m_recorder->is_open( ) )
+        m_recorder->close( );
+    else if ( ! m_recorder->open( m_recording_file, m_display->columns( ),
+                                  m_display->rows( ) ) )
+    {
+        m_logger->warn( ) << "Can't open recording file '"
+                          << m_recording_file << "'" << std::endl;
+        return;
+    }
+
     // Also the display subsystem needs to know since it draws some indicator
     // while recording is on
 
-    if ( m_logger->can_log( ) )
-        m_display->recording_state_change( m_is_recording = ! m_is_recording );
+    m_display->recording_state_change( m_recorder->is_open( ) );
+}
+
+
+/******************************************
+ * Receives the "Playback" message, sent when the user wants to play back
+ * the last recording or control a playback in progress. A recording still
+ * going on gets stopped before playing it.
+ ******************************************/
+
+template < >
+void
+Messenger::send< message::Playback >( message::Playback const & mess )
+{
+    switch ( mess.action )
+    {
+        case message::Playback::Play :
+            if ( m_player->is_playing( ) )
+            {
+                m_player->set_speed( mess.value );
+                break;
+            }
+
+            if ( m_recorder->is_open( ) )
+                send( message::Toggle_Recording( ) );
+
+            if ( ! m_player->start( m_recording_file, mess.value ) )
+                m_logger->warn( ) << "Can't play recording file '"
+                                  << m_recording_file << "'" << std::endl;
+            break;
+
+        case message::Playback::Skip :
+            m_player->skip( mess.value );
+            break;
+
+        case message::Playback::Skip_To_End :
+            m_player->skip( -1 );
+            break;
+
+        case message::Playback::Stop :
+            m_player->stop( );
+            break;
+    }
 }
 
 
@@ -244,6 +365,20 @@ Messenger::send< message::Suspend_Display >(
 }
 
 
+/******************************************
+ * Receives the "Trace Point" message, sent when a command or the reply
+ * to it reached one of the points where latencies get measured
+ ******************************************/
+
+template < >
+void
+Messenger::send< message::Trace_Point >( message::Trace_Point const & mess )
+{
+    if ( m_tracer )
+        m_tracer->stamp( mess.point );
+}
+
+
 /******************************************
  * Receives the "Set Display Orientation", requesting a change of the
  * display orientation. The pointer and button handling subsystem need
@@ -262,6 +397,29 @@ Messenger::send< message::Set_Orientation >(
 }
 
 
+/******************************************
+ * Receives the "Terminal Size" message, sent by the display when the
+ * number of rows and columns changes, and passes it on to the terminal
+ * (which doesn't exist yet while the display gets set up)
+ ******************************************/
+
+template < >
+void
+Messenger::send< message::Terminal_Size >(
+                                        message::Terminal_Size const & mess )
+{
+    if ( m_term )
+        m_term->window_size_change( mess.rows, mess.columns );
+
+    if ( m_recorder && m_recorder->is_open( ) )
+    {
+        std::ostringstream size;
+        size << mess.columns << 'x' << mess.rows;
+        m_recorder->add( Session_Recorder::Resize, size.str( ) );
+    }
+}
+
+
 /******************************************
  * Receives the "Show Rotate Box" message, resulting in the rotation selector
  * being shown (which, in turn, will result in a "Set Orientation" message).
@@ -277,15 +435,54 @@ Messenger::send< message::Show_Rotate_Box >( message::Show_Rotate_Box const & )
 
 /******************************************
  * Receives the "Show Keyboard" message when the keyboard is to be displayed
- * on the screen (may, in turn, result in a "Command" message).
+ * on the screen (may, in turn, result in a "Command" message). Without a
+ * text it starts with the command most likely to be needed next.
  ******************************************/
 
 template < >
 void
 Messenger::send< message::Show_Keyboard >( message::Show_Keyboard const & mess )
 {
-    m_kbd_handler->show( mess.txt.empty( ) ?
-                         m_term->last_command( ) : mess.txt );
+    if ( ! mess.txt.empty( ) )
+    {
+        m_kbd_handler->show( mess.txt );
+        return;
+    }
+
+    std::vector< std::string > suggestions;
+    m_term->suggest_commands( suggestions );
+
+    m_kbd_handler->show( suggestions.empty( ) ?
+                         m_term->last_command( ) : suggestions.front( ) );
+}
+
+
+/******************************************
+ * Receives the "Show Search Keyboard" message when the keyboard for
+ * entering a text to search the command history for is to be displayed
+ * (may result in a "Search History" message)
+ ******************************************/
+
+template < >
+void
+Messenger::send< message::Show_Search_Keyboard >(
+                                 message::Show_Search_Keyboard const & )
+{
+    m_kbd_handler->show_search( );
+}
+
+
+/******************************************
+ * Receives the "Search History" message with a text to search the command
+ * history for, the menu handler shows what's found
+ ******************************************/
+
+template < >
+void
+Messenger::send< message::Search_History >(
+                                 message::Search_History const & mess )
+{
+    m_menu_handler->show_search_results( mess.query );
 }
 
 
@@ -327,6 +524,8 @@ Messenger::send< request::Handle_Event >( request::Handle_Event & req )
     if ( m_is_shutting_down )
         return req;
 
+    update_config( );
+
     if ( req.type == EVT_SHOW )
     {
         m_display->redraw( );
@@ -335,7 +534,52 @@ Messenger::send< request::Handle_Event >( request::Handle_Event & req )
     else if ( ISKEYEVENT( req.type ) )
         req.result = m_button_handler->handle( req.type, req.par1, req.par2 );
     else if ( ISPOINTEREVENT( req.type ) )
-        req.result = m_pointer_handler->handle( req.type, req.par1, req.par2 );
+    {
+        // A tap while an overlay is shown just removes it
+
+        if ( req.type == EVT_POINTERDOWN && m_display->hide_overlay( ) )
+            m_is_dismissing_overlay = true;
+
+        if ( ! m_is_dismissing_overlay )
+            req.result = m_pointer_handler->handle( req.type, req.par1,
+                                                    req.par2 );
+        else
+        {
+            if ( req.type == EVT_POINTERUP )
+                m_is_dismissing_overlay = false;
+            req.result = 1;
+        }
+    }
+    return req;
+}
+
+
+/******************************************
+ * Receives the "Get User Commands" request for what was last read from
+ * the file with the user commands
+ ******************************************/
+
+template < >
+request::Get_User_Commands &
+Messenger::send< request::Get_User_Commands >(
+                                          request::Get_User_Commands & req )
+{
+    req.result = m_watcher->content( m_user_cmd_file_id, &req.version );
+    return req;
+}
+
+
+/******************************************
+ * Receives the "Has Custom Keyboard" request, asking if the custom
+ * keyboard layout file exists
+ ******************************************/
+
+template < >
+request::Has_Custom_Keyboard &
+Messenger::send< request::Has_Custom_Keyboard >(
+                                        request::Has_Custom_Keyboard & req )
+{
+    req.result = m_watcher->content( m_kbd_file_id ).get( ) != 0;
     return req;
 }
 
@@ -354,6 +598,20 @@ Messenger::send< request::Get_Command_List >( request::Get_Command_List & req )
 }
 
 
+/******************************************
+ * Receives the "Get Suggestions" request for the commands most likely
+ * to be needed next
+ ******************************************/
+
+template < >
+request::Get_Suggestions &
+Messenger::send< request::Get_Suggestions >( request::Get_Suggestions & req )
+{
+    m_term->suggest_commands( req.result );
+    return req;
+}
+
+
 /******************************************
  * Receives the "Can_Use_Crtl" request to inquire if control characters
  * can be sent to the shell
@@ -368,6 +626,38 @@ Messenger::send< request::Can_Use_Ctrl >( request::Can_Use_Ctrl & req )
 }
 
 
+/******************************************
+ * Receives the "Can Play Recording" request to inquire if there's a
+ * recording that could be played back
+ ******************************************/
+
+template < >
+request::Can_Play_Recording &
+Messenger::send< request::Can_Play_Recording >(
+                                          request::Can_Play_Recording & req )
+{
+    req.result =    m_player->is_playing( )
+                 || access( m_recording_file.c_str( ), R_OK ) == 0;
+    return req;
+}
+
+
+/******************************************
+ * Receives the "Get Terminal Size" request to obtain the number of rows
+ * and columns that fit onto the screen
+ ******************************************/
+
+template < >
+request::Get_Terminal_Size &
+Messenger::send< request::Get_Terminal_Size >(
+                                            request::Get_Terminal_Size & req )
+{
+    req.rows    = m_display->rows( );
+    req.columns = m_display->columns( );
+    return req;
+}
+
+
 /******************************************
  * Receives the "Get Active Keyboard" request to obtain the type of the
  * active keyboard
@@ -383,6 +673,64 @@ Messenger::send< request::Get_Active_Keyboard >(
 }
 
 
+/******************************************
+ * Receives the "Get Statistics" request to obtain a text with the
+ * current values of all metrics and, if they're measured, the latencies
+ * and allocations
+ ******************************************/
+
+template < >
+request::Get_Statistics &
+Messenger::send< request::Get_Statistics >( request::Get_Statistics & req )
+{
+    std::ostringstream os;
+
+    Metrics::write( os );
+    if ( m_tracer && m_tracer->has_data( ) )
+    {
+        os << '\n';
+        m_tracer->write( os );
+    }
+    if ( Alloc_Profile::is_enabled( ) )
+    {
+        os << '\n';
+        Alloc_Profile::write( os, req.alloc_baseline );
+    }
+
+    req.result = os.str( );
+    return req;
+}
+
+
+/******************************************
+ * Receives the "Show Statistics" message, sent when the user asked for
+ * the statistics to be shown
+ ******************************************/
+
+template < >
+void
+Messenger::send< message::Show_Statistics >( message::Show_Statistics const & )
+{
+    request::Get_Statistics gs( m_alloc_baseline );
+    m_display->show_overlay( send( gs ).result
+                             + "\n(Tap to close this window)" );
+}
+
+
+/******************************************
+ * Receives the "Dump Frame Profile" message, sent when the user asked for
+ * the frame profile
+ ******************************************/
+
+template < >
+void
+Messenger::send< message::Dump_Frame_Profile >(
+                                          message::Dump_Frame_Profile const & )
+{
+    m_display->dump_frame_profile( );
+}
+
+
 /******************************************
  * If available in libinkview call GetMenuRect() to find out how
  * large a menu will be. Return if calling GetMenuRect() was possible.
@@ -420,6 +768,39 @@ Messenger::GetTouchInfo( iv_mtinfo mtinfo[ 2 ] )
 }
 
 
+/******************************************
+ * Writes the latencies measured to the file for them or, if there's
+ * none or it can't be written to, to the log file
+ ******************************************/
+
+void
+Messenger::write_latencies( )
+{
+    if ( ! m_tracer || ! m_tracer->has_data( ) )
+        return;
+
+    if ( ! m_latency_file.empty( ) )
+    {
+        std::string path( Utils::prepare_file_creation( m_latency_file ) );
+        std::ofstream ofs;
+
+        if ( ! path.empty( ) )
+            ofs.open( path.c_str( ) );
+
+        if ( ofs.is_open( ) )
+        {
+            m_tracer->write( ofs );
+            return;
+        }
+
+        m_logger->warn( ) << "Can't write latencies to '" << m_latency_file
+                          << "'" << std::endl;
+    }
+
+    m_tracer->write( m_logger->info( ) );
+}
+
+
 /******************************************
  * A number of functions actually available in newer libinkview versions
  * aren't suppported by the current SDK. So we need to use sone tricks to
@@ -439,6 +820,29 @@ Messenger::load_unsupported_functions( )
 }
 
 
+/******************************************
+ * Checks if the configuration file was reparsed since it was last looked
+ * at and, if so, takes over what can be changed while the program runs
+ ******************************************/
+
+void
+Messenger::update_config( )
+{
+    unsigned long version;
+    File_Watcher::Content_Ptr c = m_watcher->content( m_config_file_id,
+                                                      &version );
+
+    if ( version == m_config_version || ! c )
+        return;
+
+    m_config_version = version;
+    m_config->update( static_cast< Config::File_Settings const & >( *c ) );
+
+    m_term->set_check_interval( m_config->check_interval( ) );
+    m_display->set_zoom_preview( m_config->zoom_preview( ) );
+}
+
+
 /*
  * Local variables:
  * tab-width: 4
@@ -28,6 +28,8 @@
 
 
 class Logger;
+class Config;
+class File_Watcher;
 class Display;
 class Term;
 class Keyboard_Handler;
@@ -35,6 +37,10 @@ class Menu_Handler;
 class Button_Handler;
 class Pointer_Handler;
 class Rotation_Handler;
+class Latency_Tracer;
+class Stats_Writer;
+class Session_Recorder;
+class Session_Player;
 
 
 /******************************************
@@ -103,9 +109,43 @@ class Messenger
     load_unsupported_functions( );
 
 
+    // Writes out the latencies measured (if any)
+
+    void
+    write_latencies( );
+
+
+    // Takes over changes of the configuration file
+
+    void
+    update_config( );
+
+
     Logger * m_logger;
 
 
+    Config * m_config;
+
+
+    // Thread watching the files the user may edit while the program runs,
+    // the ids of the files and the version of the configuration file last
+    // taken over
+
+    File_Watcher * m_watcher;
+
+
+    int m_config_file_id;
+
+
+    int m_user_cmd_file_id;
+
+
+    int m_kbd_file_id;
+
+
+    unsigned long m_config_version;
+
+
     Display * m_display;
 
 
@@ -127,10 +167,41 @@ class Messenger
     Rotation_Handler * m_rotation_handler;
 
 
-    bool m_is_shutting_down;
+    // Object for measuring latencies (only exists if requested)
+
+    Latency_Tracer * m_tracer;
+
+
+    std::string m_latency_file;
+
+
+    Stats_Writer * m_stats_writer;
+
+
+    // Allocation counts when the statistics were last shown
+
+    Alloc_Profile::Baseline m_alloc_baseline;
+
 
+    // Objects for recording sessions and playing them back, and the file
+    // used for that
 
-    bool m_is_recording;
+    Session_Recorder * m_recorder;
+
+
+    Session_Player * m_player;
+
+
+    std::string m_recording_file;
+
+
+    // Flag, set while the pointer events of the tap that removed an
+    // overlay from the display are to be swallowed
+
+    bool m_is_dismissing_overlay;
+
+
+    bool m_is_shutting_down;
 
 
     int m_font_step;
@@ -0,0 +1,145 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "Metrics.hpp"
+#include <iomanip>
+#include <cstring>
+
+
+/******************************************
+ ******************************************/
+
+Metrics::Counter &
+Metrics::counter( char const * name )
+{
+    void * m = find( name, Counter_Type );
+    if ( m )
+        return *static_cast< Counter * >( m );
+
+    Entry e = { name, Counter_Type, new Counter };
+    entries( ).push_back( e );
+    return *static_cast< Counter * >( e.metric );
+}
+
+
+/******************************************
+ ******************************************/
+
+Metrics::Gauge &
+Metrics::gauge( char const * name )
+{
+    void * m = find( name, Gauge_Type );
+    if ( m )
+        return *static_cast< Gauge * >( m );
+
+    Entry e = { name, Gauge_Type, new Gauge };
+    entries( ).push_back( e );
+    return *static_cast< Gauge * >( e.metric );
+}
+
+
+/******************************************
+ ******************************************/
+
+Histogram &
+Metrics::histogram( char const * name )
+{
+    void * m = find( name, Histogram_Type );
+    if ( m )
+        return *static_cast< Histogram * >( m );
+
+    Entry e = { name, Histogram_Type, new Histogram };
+    entries( ).push_back( e );
+    return *static_cast< Histogram * >( e.metric );
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+Metrics::write( std::ostream & out )
+{
+    std::vector< Entry > const & e = entries( );
+
+    for ( std::size_t i = 0; i < e.size( ); ++i )
+    {
+        out << std::left << std::setw( 24 ) << e[ i ].name << std::right;
+
+        if ( e[ i ].type == Counter_Type )
+            out << std::setw( 12 )
+                << static_cast< Counter * >( e[ i ].metric )->value( );
+        else if ( e[ i ].type == Gauge_Type )
+            out << std::setw( 12 )
+                << static_cast< Gauge * >( e[ i ].metric )->value( );
+        else
+        {
+            Histogram const & h = *static_cast< Histogram * >( e[ i ].metric );
+
+            out << std::setw( 12 ) << h.count( )
+                << "  mean " << h.mean( )
+                << ", 90% <= " << h.percentile( 0.9 )
+                << ", max " << h.max( );
+        }
+
+        out << '\n';
+    }
+}
+
+
+/******************************************
+ ******************************************/
+
+void *
+Metrics::find( char const * name,
+               Type         type )
+{
+    std::vector< Entry > const & e = entries( );
+
+    for ( std::size_t i = 0; i < e.size( ); ++i )
+        if ( e[ i ].type == type && ! std::strcmp( e[ i ].name, name ) )
+            return e[ i ].metric;
+
+    return 0;
+}
+
+
+/******************************************
+ * Returns the list of all metrics. It's created on first use since
+ * metrics get registered during the initialization of static objects
+ * and the order in which that happens for different files is undefined.
+ * The metrics themselves are never deleted, they must outlive everything
+ * that might still update them.
+ ******************************************/
+
+std::vector< Metrics::Entry > &
+Metrics::entries( )
+{
+    static std::vector< Entry > * e = new std::vector< Entry >;
+    return *e;
+}
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,155 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#if ! defined METRICS_HPP_
+#define METRICS_HPP_
+
+
+#include "Histogram.hpp"
+#include <ostream>
+#include <vector>
+
+
+/******************************************
+ * Registry of counters, gauges and histograms the subsystems keep about
+ * what they're doing. Each metric gets registered once under a name,
+ * normally when the program starts, e.g.
+ *
+ *   Metrics::Counter & s_bytes_read = Metrics::counter( "bytes read" );
+ *
+ * and updating it afterwards is as cheap as incrementing a variable.
+ * Counters may also be incremented from other threads, gauges and
+ * histograms only from the main thread.
+ ******************************************/
+
+class Metrics
+{
+  public :
+
+    // A value that only ever grows
+
+    class Counter
+    {
+      public :
+
+        Counter( )
+            : m_value( 0 )
+        { }
+
+
+        void
+        add( unsigned long n = 1 )
+        {
+            __sync_fetch_and_add( &m_value, n );
+        }
+
+
+        unsigned long
+        value( ) const  { return m_value; }
+
+
+      private :
+
+        unsigned long volatile m_value;
+    };
+
+
+    // A value that gets set to the current state of something
+
+    class Gauge
+    {
+      public :
+
+        Gauge( )
+            : m_value( 0 )
+        { }
+
+
+        void
+        set( long value )  { m_value = value; }
+
+
+        long
+        value( ) const  { return m_value; }
+
+
+      private :
+
+        long m_value;
+    };
+
+
+    // Return the metric registered under a name, creating it if necessary
+
+    static Counter &
+    counter( char const * name );
+
+
+    static Gauge &
+    gauge( char const * name );
+
+
+    static Histogram &
+    histogram( char const * name );
+
+
+    // Writes a line per metric (in the order they were registered)
+
+    static void
+    write( std::ostream & out );
+
+
+  private :
+
+    enum Type
+    {
+        Counter_Type,
+        Gauge_Type,
+        Histogram_Type
+    };
+
+
+    struct Entry
+    {
+        char const * name;
+        Type type;
+        void * metric;
+    };
+
+
+    static void *
+    find( char const * name,
+          Type         type );
+
+
+    static std::vector< Entry > &
+    entries( );
+};
+
+
+#endif
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
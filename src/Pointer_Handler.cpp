@@ -21,10 +21,27 @@
 #include "Pointer_Handler.hpp"
 #include "Messenger.hpp"
 #include "Defaults.hpp"
+#include "Utils.hpp"
 #include <cmath>
 #include <algorithm>
 
 
+// Definition of the static member used to find the Pointer_Handler
+// instance from within static member functions
+
+Pointer_Handler * Pointer_Handler::s_handling_pointer;
+
+
+/******************************************
+ * Destructor, stops the timer used while scrolling
+ ******************************************/
+
+Pointer_Handler::~Pointer_Handler( )
+{
+    ClearTimer( &Pointer_Handler::static_frame_handler );
+}
+
+
 /******************************************
  * Handler for all pointer events
  ******************************************/
@@ -67,11 +84,20 @@ Pointer_Handler::handle_pointer_down( int x,
     if ( m_pointer_is_down )
         return 0;
 
+    // Touching the screen while it's still scrolling stops it
+
+    m_stopped_fling = m_is_flinging;
+    stop_fling( );
+
     m_pointer_is_down = true;
     m_in_pinch = false;
+    m_is_dragging = false;
     m_start_x = x;
     m_start_y = y;
     m_max_excursion = 0;
+    m_current_y = m_applied_y = y;
+    m_num_samples = 0;
+    add_sample( y );
 
     return 1;
 }
@@ -102,7 +128,8 @@ Pointer_Handler::handle_pointer_long( int x,
 
 
 /******************************************
- * Handler for pointer move events
+ * Handler for pointer move events. Once the pointer has moved far enough
+ * for a swipe the display follows it, but only once per frame.
  ******************************************/
 
 int
@@ -114,6 +141,15 @@ Pointer_Handler::handle_pointer_move( int x,
 
     m_max_excursion = max_excursion( x, y );
 
+    if ( m_max_excursion > MAX_EXCURSION )
+        m_is_dragging = true;
+
+    m_current_y = y;
+    add_sample( y );
+
+    if ( m_is_dragging && ! m_is_frame_pending )
+        start_frame_timer( );
+
     return 1;
 }
 
@@ -199,15 +235,24 @@ Pointer_Handler::handle_pointer_up( int x,
  
     // Otherwise this was for scrolling
 
-   m_max_excursion = max_excursion( x, y );
+    m_max_excursion = max_excursion( x, y );
 
     // If the excursion wasn't too large treat it as a tap and either show
     // the keyboard or toggle recording (if the tap was in the upper right
     // hand corner) or close the program (if the tap was in the upper left
-    // hand corner). If this was a swipe instead shift the screen content.
+    // hand corner) - unless the tap just stopped the display from scrolling,
+    // then it only gets redrawn properly. If this was a swipe instead
+    // scroll what hasn't been scrolled yet and, if the finger was still
+    // moving fast, let the display continue to scroll by itself.
 
-    if ( m_max_excursion <= MAX_EXCURSION )
+    if ( ! m_is_dragging && m_max_excursion <= MAX_EXCURSION )
     {
+        if ( m_stopped_fling )
+        {
+            m_mess.send( message::Shift_Display( 0 ) );
+            return 1;
+        }
+
         if (    m_start_x >= m_display_width - ON_SCREEN_BUTTON_SIZE
              && m_start_y <= ON_SCREEN_BUTTON_SIZE )
             m_mess.send( message::Toggle_Recording( ) );
@@ -221,12 +266,161 @@ Pointer_Handler::handle_pointer_up( int x,
             m_mess.send( message::Show_Keyboard( ) );
     }
     else
-        m_mess.send( message::Shift_Display( y - m_start_y ) );
+    {
+        ClearTimer( &Pointer_Handler::static_frame_handler );
+        m_is_frame_pending = false;
+
+        add_sample( y );
+        m_fling_speed = swipe_speed( );
+
+        if ( std::fabs( m_fling_speed ) < FLING_MIN_SPEED )
+            m_mess.send( message::Shift_Display( y - m_applied_y ) );
+        else
+        {
+            if ( y != m_applied_y )
+                m_mess.send( message::Shift_Display( y - m_applied_y, true ) );
+
+            m_is_flinging = true;
+            m_fling_rest = 0;
+            start_frame_timer( );
+        }
+    }
 
     return 1;
 }
 
 
+/******************************************
+ * Helper function that can be called from C, redirects to the
+ * real handler function
+ ******************************************/
+
+void
+Pointer_Handler::static_frame_handler( )
+{
+    s_handling_pointer->frame_handler( );
+}
+
+
+/******************************************
+ * Called once per frame while scrolling. While the finger is on the
+ * screen the display gets shifted by how far it moved since the last
+ * frame. When scrolling by itself the display moves according to the
+ * current speed, which is then reduced. When it has become slow enough
+ * scrolling stops and the display gets redrawn properly.
+ ******************************************/
+
+void
+Pointer_Handler::frame_handler( )
+{
+    m_is_frame_pending = false;
+
+    if ( m_is_flinging )
+    {
+        double d = m_fling_speed * SCROLL_FRAME_INTERVAL / 1000.0
+                   + m_fling_rest;
+        int dist = static_cast< int >( d );
+        m_fling_rest = d - dist;
+
+        m_fling_speed = m_fling_speed * FLING_DECAY / 100.0;
+
+        if ( std::fabs( m_fling_speed ) < FLING_STOP_SPEED )
+        {
+            m_is_flinging = false;
+            m_mess.send( message::Shift_Display( dist ) );
+            return;
+        }
+
+        if ( dist )
+            m_mess.send( message::Shift_Display( dist, true ) );
+        start_frame_timer( );
+    }
+    else if (    m_pointer_is_down
+              && m_is_dragging
+              && ! m_in_pinch
+              && m_current_y != m_applied_y )
+    {
+        m_mess.send( message::Shift_Display( m_current_y - m_applied_y,
+                                             true ) );
+        m_applied_y = m_current_y;
+    }
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+Pointer_Handler::start_frame_timer( )
+{
+    m_is_frame_pending = true;
+    SetWeakTimer( APP_NAME "_scroll", &Pointer_Handler::static_frame_handler,
+                  SCROLL_FRAME_INTERVAL );
+}
+
+
+/******************************************
+ * Stops the display from scrolling by itself
+ ******************************************/
+
+void
+Pointer_Handler::stop_fling( )
+{
+    if ( m_is_frame_pending )
+        ClearTimer( &Pointer_Handler::static_frame_handler );
+
+    m_is_frame_pending = false;
+    m_is_flinging = false;
+}
+
+
+/******************************************
+ * Stores a pointer position together with the current time, dropping
+ * the oldest one if necessary
+ ******************************************/
+
+void
+Pointer_Handler::add_sample( int y )
+{
+    if ( m_num_samples == Max_Samples )
+    {
+        std::copy( m_samples + 1, m_samples + Max_Samples, m_samples );
+        m_num_samples--;
+    }
+
+    m_samples[ m_num_samples ].time = Utils::monotonic_microseconds( );
+    m_samples[ m_num_samples++ ].y = y;
+}
+
+
+/******************************************
+ * Calculates the speed from the positions recorded during the last
+ * moments of a swipe
+ ******************************************/
+
+double
+Pointer_Handler::swipe_speed( ) const
+{
+    if ( m_num_samples < 2 )
+        return 0;
+
+    Sample const & last = m_samples[ m_num_samples - 1 ];
+    std::size_t i = 0;
+
+    while (    i < m_num_samples - 2
+            &&   last.time - m_samples[ i ].time
+               > FLING_VELOCITY_WINDOW * 1000ULL )
+        i++;
+
+    unsigned long long dt = last.time - m_samples[ i ].time;
+
+    if ( dt == 0 )
+        return 0;
+
+    return ( last.y - m_samples[ i ].y ) * 1.0e6 / dt;
+}
+
+
 /******************************************
  * Informs the object that the display size changed
  ******************************************/
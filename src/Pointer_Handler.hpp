@@ -30,7 +30,11 @@ class Config;
 
 
 /******************************************
- * Class for handling pointer events from the reader
+ * Class for handling pointer events from the reader. Swipes scroll the
+ * display while the finger is moving (with movements combined into
+ * frames to keep the number of screen updates down) and, when the finger
+ * is lifted while still moving fast, the display continues to scroll
+ * for a while, slowing down.
  ******************************************/
 
 class Pointer_Handler
@@ -42,9 +46,19 @@ class Pointer_Handler
         : m_mess( mess )
         , m_pointer_is_down( false )
         , m_in_pinch( false )
+        , m_is_dragging( false )
+        , m_is_frame_pending( false )
+        , m_is_flinging( false )
+        , m_stopped_fling( false )
+        , m_num_samples( 0 )
         , m_display_width( ScreenWidth( ) )
         , m_display_height( ScreenHeight( ) )
-    { }
+    {
+        s_handling_pointer = this;
+    }
+
+
+    ~Pointer_Handler( );
 
 
     // Handler function for all pointer events
@@ -103,6 +117,38 @@ class Pointer_Handler
     two_fingers_done( );
 
 
+    // Helper function that can be called from C for the frame timer
+
+    static void
+    static_frame_handler( );
+
+
+    // Called once per frame while scrolling
+
+    void
+    frame_handler( );
+
+
+    void
+    start_frame_timer( );
+
+
+    void
+    stop_fling( );
+
+
+    // Records a pointer position for calculating the speed of a swipe
+
+    void
+    add_sample( int y );
+
+
+    // Returns the speed (in pixels per second) at the end of a swipe
+
+    double
+    swipe_speed( ) const;
+
+
     // Calculates difference from start position
 
     int
@@ -148,10 +194,69 @@ class Pointer_Handler
     int m_max_excursion;
 
 
+    // Flag, set when the pointer moved far enough for a swipe
+
+    bool m_is_dragging;
+
+
+    // Flag, set while the timer for the next frame is running
+
+    bool m_is_frame_pending;
+
+
+    // Flag, set while the display is scrolling by itself after a swipe
+
+    bool m_is_flinging;
+
+
+    // Flag, set when the current touch stopped the display from scrolling
+    // by itself (it's then not treated as a tap)
+
+    bool m_stopped_fling;
+
+
+    // Latest y-position of the pointer and the y-position up to which
+    // the display has been scrolled
+
+    int m_current_y,
+        m_applied_y;
+
+
+    // Speed (in pixels per second) while scrolling by itself and the
+    // fraction of a pixel not yet scrolled
+
+    double m_fling_speed,
+           m_fling_rest;
+
+
+    // Last few pointer positions (with times) for determining the speed
+    // at the end of a swipe
+
+    struct Sample
+    {
+        unsigned long long time;
+        int y;
+    };
+
+
+    static std::size_t const Max_Samples = 8;
+
+
+    Sample m_samples[ Max_Samples ];
+
+
+    std::size_t m_num_samples;
+
+
     // Current display width and height
 
     int m_display_width,
         m_display_height;
+
+
+    // Needed in static timer handler to call the real handler function
+
+    static Pointer_Handler * s_handling_pointer;
 };
 
 
@@ -0,0 +1,274 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "Relayout_Worker.hpp"
+#include "Text_Measure.hpp"
+#include "Line.hpp"
+#include "Defaults.hpp"
+
+
+/******************************************
+ * Constructor, the thread only gets started once there's something to do
+ ******************************************/
+
+Relayout_Worker::Relayout_Worker( )
+    : m_has_thread( false )
+    , m_next_job( 0 )
+    , m_generation( 0 )
+    , m_is_working( false )
+    , m_quit( false )
+{
+    pthread_mutex_init( &m_mutex, 0 );
+    pthread_cond_init( &m_cond, 0 );
+}
+
+
+/******************************************
+ * Destructor, stops the thread and throws away everything not yet done
+ ******************************************/
+
+Relayout_Worker::~Relayout_Worker( )
+{
+    pthread_mutex_lock( &m_mutex );
+    m_quit = true;
+    m_generation++;
+    pthread_cond_signal( &m_cond );
+    pthread_mutex_unlock( &m_mutex );
+
+    if ( m_has_thread )
+        pthread_join( m_thread, 0 );
+
+    delete m_next_job;
+    discard_blocks( );
+
+    pthread_cond_destroy( &m_cond );
+    pthread_mutex_destroy( &m_mutex );
+}
+
+
+/******************************************
+ * Passes a new job to the thread, starting it if necessary. Returns false
+ * if the thread can't be started (the job then gets deleted).
+ ******************************************/
+
+bool
+Relayout_Worker::start( Job * job )
+{
+    if ( ! m_has_thread )
+    {
+        if ( pthread_create( &m_thread, 0, thread_func, this ) != 0 )
+        {
+            delete job;
+            return false;
+        }
+
+        m_has_thread = true;
+    }
+
+    pthread_mutex_lock( &m_mutex );
+
+    delete m_next_job;
+    discard_blocks( );
+
+    m_next_job = job;
+    m_generation = job->generation;
+
+    pthread_cond_signal( &m_cond );
+    pthread_mutex_unlock( &m_mutex );
+
+    return true;
+}
+
+
+/******************************************
+ * Throws away the job the thread is working on (or is about to start
+ * with) and all results not yet fetched
+ ******************************************/
+
+void
+Relayout_Worker::cancel( )
+{
+    pthread_mutex_lock( &m_mutex );
+
+    delete m_next_job;
+    m_next_job = 0;
+    m_generation++;
+    discard_blocks( );
+
+    pthread_mutex_unlock( &m_mutex );
+}
+
+
+/******************************************
+ * Gets the oldest finished block of lines. Returns false if there's none.
+ ******************************************/
+
+bool
+Relayout_Worker::fetch( Block & block )
+{
+    Block * b = 0;
+
+    pthread_mutex_lock( &m_mutex );
+    if ( ! m_blocks.empty( ) )
+    {
+        b = m_blocks.front( );
+        m_blocks.pop_front( );
+    }
+    pthread_mutex_unlock( &m_mutex );
+
+    if ( ! b )
+        return false;
+
+    block.generation = b->generation;
+    block.first_id   = b->first_id;
+    block.break_pos.swap( b->break_pos );
+    delete b;
+
+    return true;
+}
+
+
+/******************************************
+ * Returns if a job is still being worked on or there are results
+ * that haven't been fetched yet
+ ******************************************/
+
+bool
+Relayout_Worker::is_busy( )
+{
+    pthread_mutex_lock( &m_mutex );
+    bool busy = m_next_job || m_is_working || ! m_blocks.empty( );
+    pthread_mutex_unlock( &m_mutex );
+
+    return busy;
+}
+
+
+/******************************************
+ * Function the thread gets started with, just redirects to run()
+ ******************************************/
+
+void *
+Relayout_Worker::thread_func( void * arg )
+{
+    static_cast< Relayout_Worker * >( arg )->run( );
+    return 0;
+}
+
+
+/******************************************
+ * Main loop of the thread, waits for jobs and processes them
+ ******************************************/
+
+void
+Relayout_Worker::run( )
+{
+    pthread_mutex_lock( &m_mutex );
+
+    while ( 1 )
+    {
+        while ( ! m_quit && ! m_next_job )
+            pthread_cond_wait( &m_cond, &m_mutex );
+
+        if ( m_quit )
+            break;
+
+        Job * job = m_next_job;
+        m_next_job = 0;
+        m_is_working = true;
+
+        pthread_mutex_unlock( &m_mutex );
+        process( *job );
+        delete job;
+        pthread_mutex_lock( &m_mutex );
+
+        m_is_working = false;
+    }
+
+    pthread_mutex_unlock( &m_mutex );
+}
+
+
+/******************************************
+ * Calculates the wrapping for all lines of a job, starting with the
+ * last line (which is the one nearest to what's shown on the screen).
+ * After each block it's checked if the job has become obsolete.
+ ******************************************/
+
+void
+Relayout_Worker::process( Job & job )
+{
+    Char_Width_Measure measure( job.char_widths );
+    std::size_t hi = job.texts.size( );
+
+    while ( hi > 0 )
+    {
+        std::size_t lo = hi > RELAYOUT_BLOCK_SIZE ?
+                         hi - RELAYOUT_BLOCK_SIZE : 0;
+
+        Block * block = new Block;
+        block->generation = job.generation;
+        block->first_id   = job.first_id + lo;
+        block->break_pos.resize( hi - lo );
+
+        for ( std::size_t i = lo; i < hi; ++i )
+            if ( ! Line::calc_break_pos( job.texts[ i ], measure,
+                                         job.available,
+                                         job.continuation_width,
+                                         block->break_pos[ i - lo ] ) )
+                block->break_pos[ i - lo ].clear( );
+
+        pthread_mutex_lock( &m_mutex );
+        bool is_obsolete = m_quit || m_generation != job.generation;
+        if ( ! is_obsolete )
+            m_blocks.push_back( block );
+        pthread_mutex_unlock( &m_mutex );
+
+        if ( is_obsolete )
+        {
+            delete block;
+            return;
+        }
+
+        hi = lo;
+    }
+}
+
+
+/******************************************
+ * Deletes all blocks not yet fetched (mutex must be held)
+ ******************************************/
+
+void
+Relayout_Worker::discard_blocks( )
+{
+    for ( std::deque< Block * >::iterator it = m_blocks.begin( );
+          it != m_blocks.end( ); ++it )
+        delete *it;
+    m_blocks.clear( );
+}
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,177 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#if ! defined RELAYOUT_WORKER_HPP_
+#define RELAYOUT_WORKER_HPP_
+
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <pthread.h>
+
+
+/******************************************
+ * Class for calculating the wrapping of lines in a thread of its own.
+ * It gets passed a copy of the texts of the lines together with all
+ * that's needed for measuring them (i.e. it never calls into libinkview,
+ * which isn't thread-safe). Lines are processed in blocks, starting with
+ * the last one, and each finished block is queued for the main thread
+ * to pick up.
+ ******************************************/
+
+class Relayout_Worker
+{
+  public :
+
+    // Everything needed for recalculating the wrapping of a set of lines
+
+    struct Job
+    {
+        unsigned long generation;
+        unsigned long first_id;
+        std::vector< std::string > texts;
+        std::vector< int > char_widths;
+        int available;
+        int continuation_width;
+    };
+
+
+    // Results for a block of consecutive lines. Lines for which the
+    // wrapping couldn't be determined have an empty vector.
+
+    struct Block
+    {
+        unsigned long generation;
+        unsigned long first_id;
+        std::vector< std::vector< std::size_t > > break_pos;
+    };
+
+
+    Relayout_Worker( );
+
+
+    ~Relayout_Worker( );
+
+
+    // Hands a new job to the worker, any older job still being worked on
+    // gets abandoned (the worker takes over ownership of the job)
+
+    bool
+    start( Job * job );
+
+
+    // Abandons the job currently being worked on
+
+    void
+    cancel( );
+
+
+    // Gets the next finished block, returns false if there's none
+
+    bool
+    fetch( Block & block );
+
+
+    // Returns if there's a job not yet completely dealt with
+
+    bool
+    is_busy( );
+
+
+  private :
+
+    // Copying or assigning a worker makes no sense
+
+    Relayout_Worker( Relayout_Worker const & );
+
+
+    Relayout_Worker &
+    operator = ( Relayout_Worker const & );
+
+
+    static void *
+    thread_func( void * arg );
+
+
+    void
+    run( );
+
+
+    void
+    process( Job & job );
+
+
+    void
+    discard_blocks( );
+
+
+    // Thread doing the work, only created when the first job arrives
+
+    pthread_t m_thread;
+
+
+    bool m_has_thread;
+
+
+    // Mutex and condition variable protecting all of the following members
+
+    pthread_mutex_t m_mutex;
+
+
+    pthread_cond_t m_cond;
+
+
+    // Job waiting to be worked on
+
+    Job * m_next_job;
+
+
+    // Generation of the newest job, lets the thread detect that it's
+    // working on an outdated job
+
+    unsigned long m_generation;
+
+
+    // Flag, set while the thread works on a job
+
+    bool m_is_working;
+
+
+    // Flag, set when the thread is to exit
+
+    bool m_quit;
+
+
+    // Blocks of finished lines not yet fetched by the main thread
+
+    std::deque< Block * > m_blocks;
+};
+
+
+#endif
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
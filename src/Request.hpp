@@ -33,6 +33,12 @@
 
 #include <string>
 #include <vector>
+#include <tr1/memory>
+#include "Alloc_Profile.hpp"
+
+
+class Command_History;
+class File_Content;
 
 
 namespace request 
@@ -62,7 +68,16 @@ namespace request
 
     struct Get_Command_List
     {
-        std::vector< std::string > const * result;
+        Command_History const * result;
+    };
+
+
+    // Request sent to obtain the commands most likely to be needed next,
+    // most likely first
+
+    struct Get_Suggestions
+    {
+        std::vector< std::string > result;
     };
 
 
@@ -74,12 +89,65 @@ namespace request
     };
 
 
+    // Request sent to inquire if there's a recording that can be played
+    // back (or one is being played)
+
+    struct Can_Play_Recording
+    {
+        bool result;
+    };
+
+
+    // Request sent to obtain the number of rows and columns that fit
+    // onto the screen
+
+    struct Get_Terminal_Size
+    {
+        int rows,
+            columns;
+    };
+
+
+    // Request sent to obtain the user commands as last read from the file
+    // with them (a Menu_Handler::User_Commands object or null) and how
+    // often the file has been read
+
+    struct Get_User_Commands
+    {
+        unsigned long version;
+        std::tr1::shared_ptr< File_Content const > result;
+    };
+
+
+    // Request sent to inquire if the custom keyboard layout file exists
+
+    struct Has_Custom_Keyboard
+    {
+        bool result;
+    };
+
+
     // Request sent to obtain the type of the active keyboard
 
     struct Get_Active_Keyboard
     {
         int result;
     };
+
+
+    // Request sent to obtain a text with all metrics (and latencies and
+    // allocations, if they're measured). The rates of allocations are
+    // for the time since the sender's previous request.
+
+    struct Get_Statistics
+    {
+        Get_Statistics( Alloc_Profile::Baseline & alloc_baseline )
+            : alloc_baseline( alloc_baseline )
+        { }
+
+        Alloc_Profile::Baseline & alloc_baseline;
+        std::string result;
+    };
 };
 
 
@@ -0,0 +1,895 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "Screen_Grid.hpp"
+#include <algorithm>
+
+
+// Distance between tab stops
+
+#define GRID_TAB_WIDTH  8
+
+
+/******************************************
+ * Constructor, the grid only gets its real size with resize()
+ ******************************************/
+
+Screen_Grid::Screen_Grid( )
+    : m_rows( 0 )
+    , m_columns( 0 )
+    , m_dirty_rows( 0 )
+    , m_x_margin( 0 )
+    , m_y_margin( 0 )
+    , m_cell_width( 1 )
+    , m_cell_height( 1 )
+{
+    reset( );
+}
+
+
+/******************************************
+ * Changes the number of rows and columns. Content is kept at the
+ * top left, the cursor gets moved into the new area if necessary.
+ ******************************************/
+
+void
+Screen_Grid::resize( int rows,
+                     int columns )
+{
+    rows    = std::max( rows, 1 );
+    columns = std::max( columns, 1 );
+
+    if ( rows == m_rows && columns == m_columns )
+        return;
+
+    Cell blank = { ' ', 0 };
+    std::vector< Cell > cells( rows * columns, blank );
+
+    for ( int r = 0; r < std::min( rows, m_rows ); ++r )
+        for ( int c = 0; c < std::min( columns, m_columns ); ++c )
+            cells[ r * columns + c ] = cell( r, c );
+
+    m_cells.swap( cells );
+    m_rows    = rows;
+    m_columns = columns;
+    m_dirty.resize( m_rows );
+
+    m_top    = 0;
+    m_bottom = m_rows - 1;
+    move_cursor( m_row, m_col );
+    m_saved_row = std::min( m_saved_row, m_rows - 1 );
+    m_saved_col = std::min( m_saved_col, m_columns - 1 );
+
+    mark_all_dirty( );
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+Screen_Grid::set_geometry( int x_margin,
+                           int y_margin,
+                           int cell_width,
+                           int cell_height )
+{
+    m_x_margin    = x_margin;
+    m_y_margin    = y_margin;
+    m_cell_width  = std::max( cell_width, 1 );
+    m_cell_height = std::max( cell_height, 1 );
+
+    mark_all_dirty( );
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+Screen_Grid::clear( )
+{
+    for ( int r = 0; r < m_rows; ++r )
+        erase( r, 0, m_columns - 1 );
+    move_cursor( 0, 0 );
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+Screen_Grid::reset( )
+{
+    m_row = m_col = 0;
+    m_is_wrap_pending = false;
+    m_saved_row = m_saved_col = 0;
+    m_saved_attr = 0;
+    m_is_cursor_visible = true;
+    m_attr = 0;
+    m_top = 0;
+    m_bottom = std::max( m_rows - 1, 0 );
+    m_scrolled_off.clear( );
+    clear( );
+}
+
+
+/******************************************
+ * Puts text into the cells at the cursor position. The text only
+ * contains complete UTF-8 sequences, anything invalid is replaced
+ * by a question mark.
+ ******************************************/
+
+void
+Screen_Grid::text( std::string const & txt )
+{
+    std::size_t len = txt.size( );
+
+    for ( std::size_t i = 0; i < len; )
+    {
+        unsigned char c = txt[ i++ ];
+        unsigned int ch = c;
+        int missing = 0;
+
+        if ( c >= 0xf0 && c < 0xf8 )
+        {
+            ch = c & 0x07;
+            missing = 3;
+        }
+        else if ( c >= 0xe0 )
+        {
+            ch = c & 0x0f;
+            missing = 2;
+        }
+        else if ( c >= 0xc0 )
+        {
+            ch = c & 0x1f;
+            missing = 1;
+        }
+        else if ( c >= 0x80 )
+        {
+            put( '?' );
+            continue;
+        }
+
+        for ( ; missing > 0 && i < len; --missing, ++i )
+        {
+            unsigned char n = txt[ i ];
+            if ( ( n & 0xc0 ) != 0x80 )
+                break;
+            ch = ( ch << 6 ) | ( n & 0x3f );
+        }
+
+        put( missing ? '?' : ch );
+    }
+}
+
+
+/******************************************
+ * Deals with control characters. Since output post-processing of the
+ * pseudo-terminal is switched off a line-feed also implies a carriage
+ * return (as it would on a normal terminal).
+ ******************************************/
+
+void
+Screen_Grid::control( char c )
+{
+    switch ( c )
+    {
+        case '\n' : case '\v' : case '\f' :
+            line_feed( );
+            move_cursor( m_row, 0 );
+            break;
+
+        case '\r' :
+            move_cursor( m_row, 0 );
+            break;
+
+        case '\b' :
+            move_cursor( m_row, m_col - 1 );
+            break;
+
+        case '\t' :
+            move_cursor( m_row,
+                         ( m_col / GRID_TAB_WIDTH + 1 ) * GRID_TAB_WIDTH );
+            break;
+
+        default :                      // everything else (e.g. the bell)
+            break;                     // gets ignored
+    }
+}
+
+
+/******************************************
+ * Deals with escape sequences consisting of ESC and a single character
+ ******************************************/
+
+void
+Screen_Grid::escape( char c )
+{
+    switch ( c )
+    {
+        case '7' :                     // save cursor
+            m_saved_row  = m_row;
+            m_saved_col  = m_col;
+            m_saved_attr = m_attr;
+            break;
+
+        case '8' :                     // restore cursor
+            move_cursor( m_saved_row, m_saved_col );
+            m_attr = m_saved_attr;
+            break;
+
+        case 'D' :                     // index
+            line_feed( );
+            break;
+
+        case 'E' :                     // next line
+            line_feed( );
+            move_cursor( m_row, 0 );
+            break;
+
+        case 'M' :                     // reverse index
+            reverse_line_feed( );
+            break;
+
+        case 'c' :                     // full reset
+            reset( );
+            break;
+    }
+}
+
+
+/******************************************
+ * Deals with control sequences. Parameters that are missing or zero
+ * default to 1 for everything that's counting something.
+ ******************************************/
+
+void
+Screen_Grid::csi( char                       priv,
+                  std::vector< int > const & params,
+                  char                       final )
+{
+    int p0 = params.size( ) > 0 ? params[ 0 ] : -1;
+    int p1 = params.size( ) > 1 ? params[ 1 ] : -1;
+    int n  = p0 > 0 ? p0 : 1;
+
+    if ( priv == '?' )
+    {
+        if ( p0 == 25 && ( final == 'h' || final == 'l' ) )
+        {
+            m_is_cursor_visible = final == 'h';
+            mark_dirty( m_row, m_col, m_col );
+        }
+        return;
+    }
+    else if ( priv != '\0' )
+        return;
+
+    switch ( final )
+    {
+        case 'A' :                     // cursor up
+            move_cursor( std::max( m_row - n,
+                                   m_row >= m_top ? m_top : 0 ), m_col );
+            break;
+
+        case 'B' : case 'e' :          // cursor down
+            move_cursor( std::min( m_row + n,
+                                   m_row <= m_bottom ? m_bottom : m_rows - 1 ),
+                         m_col );
+            break;
+
+        case 'C' : case 'a' :          // cursor forward
+            move_cursor( m_row, m_col + n );
+            break;
+
+        case 'D' :                     // cursor back
+            move_cursor( m_row, m_col - n );
+            break;
+
+        case 'E' :                     // cursor to start of next line
+            move_cursor( m_row + n, 0 );
+            break;
+
+        case 'F' :                     // cursor to start of previous line
+            move_cursor( m_row - n, 0 );
+            break;
+
+        case 'G' : case '`' :          // cursor to column
+            move_cursor( m_row, n - 1 );
+            break;
+
+        case 'd' :                     // cursor to row
+            move_cursor( n - 1, m_col );
+            break;
+
+        case 'H' : case 'f' :          // cursor to row and column
+            move_cursor( n - 1, ( p1 > 0 ? p1 : 1 ) - 1 );
+            break;
+
+        case 'J' :                     // erase in display
+            if ( p0 <= 0 )
+            {
+                erase( m_row, m_col, m_columns - 1 );
+                for ( int r = m_row + 1; r < m_rows; ++r )
+                    erase( r, 0, m_columns - 1 );
+            }
+            else if ( p0 == 1 )
+            {
+                for ( int r = 0; r < m_row; ++r )
+                    erase( r, 0, m_columns - 1 );
+                erase( m_row, 0, m_col );
+            }
+            else
+                for ( int r = 0; r < m_rows; ++r )
+                    erase( r, 0, m_columns - 1 );
+            break;
+
+        case 'K' :                     // erase in line
+            if ( p0 <= 0 )
+                erase( m_row, m_col, m_columns - 1 );
+            else if ( p0 == 1 )
+                erase( m_row, 0, m_col );
+            else
+                erase( m_row, 0, m_columns - 1 );
+            break;
+
+        case 'X' :                     // erase characters
+            erase( m_row, m_col, std::min( m_col + n, m_columns ) - 1 );
+            break;
+
+        case '@' :                     // insert blank characters
+        case 'P' :                     // delete characters
+        {
+            n = std::min( n, m_columns - m_col );
+            Cell * row = &cell( m_row, 0 );
+
+            if ( final == '@' )
+                std::copy_backward( row + m_col, row + m_columns - n,
+                                    row + m_columns );
+            else
+                std::copy( row + m_col + n, row + m_columns, row + m_col );
+
+            Cell blank = { ' ', static_cast< unsigned char >( m_attr
+                                                              & Reverse ) };
+            std::fill( final == '@' ? row + m_col : row + m_columns - n,
+                       final == '@' ? row + m_col + n : row + m_columns,
+                       blank );
+            mark_dirty( m_row, m_col, m_columns - 1 );
+            m_is_wrap_pending = false;
+            break;
+        }
+
+        case 'L' :                     // insert lines
+            if ( m_row >= m_top && m_row <= m_bottom )
+                scroll_down( m_row, m_bottom, n );
+            break;
+
+        case 'M' :                     // delete lines
+            if ( m_row >= m_top && m_row <= m_bottom )
+                scroll_up( m_row, m_bottom, n );
+            break;
+
+        case 'S' :                     // scroll up
+            scroll_up( m_top, m_bottom, n );
+            break;
+
+        case 'T' :                     // scroll down
+            scroll_down( m_top, m_bottom, n );
+            break;
+
+        case 'r' :                     // set scroll region
+        {
+            int top    = ( p0 > 0 ? p0 : 1 ) - 1;
+            int bottom = ( p1 > 0 ? std::min( p1, m_rows ) : m_rows ) - 1;
+
+            if ( top < bottom )
+            {
+                m_top    = top;
+                m_bottom = bottom;
+                move_cursor( 0, 0 );
+            }
+            break;
+        }
+
+        case 'm' :                     // set attributes
+            set_attributes( params );
+            break;
+
+        case 's' :                     // save cursor
+            escape( '7' );
+            break;
+
+        case 'u' :                     // restore cursor
+            escape( '8' );
+            break;
+    }
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+Screen_Grid::take_scrolled_off( std::string & dest )
+{
+    dest += m_scrolled_off;
+    m_scrolled_off.clear( );
+}
+
+
+/******************************************
+ * Appends the text of the rows (with trailing spaces removed) to the
+ * string, each row ending in a line-feed. Empty rows at the bottom
+ * (below the cursor) are left out.
+ ******************************************/
+
+void
+Screen_Grid::dump( std::string & dest ) const
+{
+    int last = m_rows - 1;
+
+    while ( last > m_row )
+    {
+        int c = 0;
+        while ( c < m_columns && cell( last, c ).ch == ' ' )
+            c++;
+        if ( c < m_columns )
+            break;
+        last--;
+    }
+
+    for ( int r = 0; r <= last; ++r )
+    {
+        row_text( r, dest );
+        dest += '\n';
+    }
+}
+
+
+/******************************************
+ * Draws all cells (the screen is expected to have been cleared)
+ ******************************************/
+
+void
+Screen_Grid::redraw( ifont * font )
+{
+    for ( int r = 0; r < m_rows; ++r )
+    {
+        draw_cells( font, r, 0, m_columns - 1 );
+        m_dirty[ r ].first = m_columns;
+        m_dirty[ r ].last  = -1;
+    }
+
+    m_dirty_rows = 0;
+}
+
+
+/******************************************
+ * Draws all cells changed since they were last drawn (after blanking
+ * them) and returns the rectangle covering all of them
+ ******************************************/
+
+bool
+Screen_Grid::draw_changes( ifont * font,
+                           irect & area )
+{
+    if ( m_dirty_rows == 0 )
+        return false;
+
+    int first_row = m_rows,
+        last_row  = -1,
+        first_col = m_columns,
+        last_col  = -1;
+
+    for ( int r = 0; r < m_rows; ++r )
+    {
+        Dirty & d = m_dirty[ r ];
+        if ( d.first > d.last )
+            continue;
+
+        FillArea( m_x_margin + d.first * m_cell_width,
+                  m_y_margin + r * m_cell_height,
+                  ( d.last - d.first + 1 ) * m_cell_width, m_cell_height,
+                  WHITE );
+        draw_cells( font, r, d.first, d.last );
+
+        first_row = std::min( first_row, r );
+        last_row  = r;
+        first_col = std::min( first_col, d.first );
+        last_col  = std::max( last_col, d.last );
+
+        d.first = m_columns;
+        d.last  = -1;
+    }
+
+    m_dirty_rows = 0;
+
+    area.x = m_x_margin + first_col * m_cell_width;
+    area.y = m_y_margin + first_row * m_cell_height;
+    area.w = ( last_col - first_col + 1 ) * m_cell_width;
+    area.h = ( last_row - first_row + 1 ) * m_cell_height;
+
+    return true;
+}
+
+
+/******************************************
+ * Puts a character at the cursor position and advances the cursor.
+ * When the last column has been written to the line only gets wrapped
+ * when the next character arrives (like it's done by the VT100).
+ ******************************************/
+
+void
+Screen_Grid::put( unsigned int ch )
+{
+    if ( m_is_wrap_pending )
+    {
+        line_feed( );
+        move_cursor( m_row, 0 );
+    }
+
+    Cell & c = cell( m_row, m_col );
+    c.ch   = ch;
+    c.attr = m_attr;
+    mark_dirty( m_row, m_col, m_col );
+
+    if ( m_col < m_columns - 1 )
+        move_cursor( m_row, m_col + 1 );
+    else
+        m_is_wrap_pending = true;
+}
+
+
+/******************************************
+ * Moves the cursor down a row, scrolling the scroll region if the
+ * cursor is at its bottom
+ ******************************************/
+
+void
+Screen_Grid::line_feed( )
+{
+    if ( m_row == m_bottom )
+        scroll_up( m_top, m_bottom, 1 );
+    else if ( m_row < m_rows - 1 )
+        move_cursor( m_row + 1, m_col );
+    m_is_wrap_pending = false;
+}
+
+
+/******************************************
+ * Moves the cursor up a row, scrolling the scroll region down if the
+ * cursor is at its top
+ ******************************************/
+
+void
+Screen_Grid::reverse_line_feed( )
+{
+    if ( m_row == m_top )
+        scroll_down( m_top, m_bottom, 1 );
+    else if ( m_row > 0 )
+        move_cursor( m_row - 1, m_col );
+    m_is_wrap_pending = false;
+}
+
+
+/******************************************
+ * Scrolls the rows between 'top' and 'bottom' up, new blank rows appear
+ * at the bottom. Rows scrolled off the top of the whole screen are kept
+ * for the scrollback.
+ ******************************************/
+
+void
+Screen_Grid::scroll_up( int top,
+                        int bottom,
+                        int count )
+{
+    count = std::min( count, bottom - top + 1 );
+
+    if ( top == 0 && bottom == m_rows - 1 )
+        for ( int r = 0; r < count; ++r )
+        {
+            row_text( r, m_scrolled_off );
+            m_scrolled_off += '\n';
+        }
+
+    std::copy( m_cells.begin( ) + ( top + count ) * m_columns,
+               m_cells.begin( ) + ( bottom + 1 ) * m_columns,
+               m_cells.begin( ) + top * m_columns );
+
+    for ( int r = bottom - count + 1; r <= bottom; ++r )
+        erase( r, 0, m_columns - 1 );
+    for ( int r = top; r <= bottom; ++r )
+        mark_dirty( r, 0, m_columns - 1 );
+}
+
+
+/******************************************
+ * Scrolls the rows between 'top' and 'bottom' down, new blank rows
+ * appear at the top
+ ******************************************/
+
+void
+Screen_Grid::scroll_down( int top,
+                          int bottom,
+                          int count )
+{
+    count = std::min( count, bottom - top + 1 );
+
+    std::copy_backward( m_cells.begin( ) + top * m_columns,
+                        m_cells.begin( ) + ( bottom + 1 - count ) * m_columns,
+                        m_cells.begin( ) + ( bottom + 1 ) * m_columns );
+
+    for ( int r = top; r < top + count; ++r )
+        erase( r, 0, m_columns - 1 );
+    for ( int r = top; r <= bottom; ++r )
+        mark_dirty( r, 0, m_columns - 1 );
+}
+
+
+/******************************************
+ * Blanks a range of cells within a row (cells already blank aren't
+ * marked as changed)
+ ******************************************/
+
+void
+Screen_Grid::erase( int row,
+                    int first,
+                    int last )
+{
+    first = std::max( first, 0 );
+    last  = std::min( last, m_columns - 1 );
+
+    unsigned char attr = m_attr & Reverse;
+
+    for ( int col = first; col <= last; ++col )
+    {
+        Cell & c = cell( row, col );
+        if ( c.ch != ' ' || c.attr != attr )
+        {
+            c.ch   = ' ';
+            c.attr = attr;
+            mark_dirty( row, col, col );
+        }
+    }
+
+    if ( row == m_row )
+        m_is_wrap_pending = false;
+}
+
+
+/******************************************
+ * Moves the cursor (restricted to the grid). The cells at the old and
+ * new cursor position are marked as changed since the cursor gets drawn.
+ ******************************************/
+
+void
+Screen_Grid::move_cursor( int row,
+                          int col )
+{
+    row = std::max( 0, std::min( row, m_rows - 1 ) );
+    col = std::max( 0, std::min( col, m_columns - 1 ) );
+
+    if ( m_is_cursor_visible && ( row != m_row || col != m_col ) )
+    {
+        mark_dirty( m_row, m_col, m_col );
+        mark_dirty( row, col, col );
+    }
+
+    m_row = row;
+    m_col = col;
+    m_is_wrap_pending = false;
+}
+
+
+/******************************************
+ * Sets the attributes for new characters from the parameters of a
+ * "select graphic rendition" sequence. Colors can't be shown and are
+ * ignored.
+ ******************************************/
+
+void
+Screen_Grid::set_attributes( std::vector< int > const & params )
+{
+    if ( params.empty( ) )
+    {
+        m_attr = 0;
+        return;
+    }
+
+    for ( std::size_t i = 0; i < params.size( ); ++i )
+        switch ( params[ i ] )
+        {
+            case -1 : case 0 :
+                m_attr = 0;
+                break;
+
+            case 1 :
+                m_attr |= Bold;
+                break;
+
+            case 4 :
+                m_attr |= Underline;
+                break;
+
+            case 7 :
+                m_attr |= Reverse;
+                break;
+
+            case 22 :
+                m_attr &= ~Bold;
+                break;
+
+            case 24 :
+                m_attr &= ~Underline;
+                break;
+
+            case 27 :
+                m_attr &= ~Reverse;
+                break;
+
+            case 38 : case 48 :        // skip extended color arguments
+                if ( i + 1 < params.size( ) )
+                    i += params[ i + 1 ] == 5 ? 2 : 4;
+                break;
+        }
+}
+
+
+/******************************************
+ * Adds a range of columns of a row to those needing redrawing
+ ******************************************/
+
+void
+Screen_Grid::mark_dirty( int row,
+                         int first,
+                         int last )
+{
+    if ( row < 0 || row >= m_rows )
+        return;
+
+    Dirty & d = m_dirty[ row ];
+
+    if ( d.first > d.last )
+        m_dirty_rows++;
+
+    d.first = std::min( d.first, first );
+    d.last  = std::max( d.last, last );
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+Screen_Grid::mark_all_dirty( )
+{
+    for ( int r = 0; r < m_rows; ++r )
+    {
+        m_dirty[ r ].first = 0;
+        m_dirty[ r ].last  = m_columns - 1;
+    }
+
+    m_dirty_rows = m_rows;
+}
+
+
+/******************************************
+ * Appends the text of a row, without trailing blanks, to a string
+ ******************************************/
+
+void
+Screen_Grid::row_text( int           row,
+                       std::string & dest ) const
+{
+    int last = m_columns - 1;
+
+    while ( last >= 0 && cell( row, last ).ch == ' ' )
+        last--;
+
+    for ( int c = 0; c <= last; ++c )
+        append_utf8( cell( row, c ).ch, dest );
+}
+
+
+/******************************************
+ * Draws a range of cells of a row. Each character is drawn at the
+ * position of its cell, so columns line up even with a proportional
+ * font. The cursor is shown by inverting its cell.
+ ******************************************/
+
+void
+Screen_Grid::draw_cells( ifont * font,
+                         int     row,
+                         int     first,
+                         int     last )
+{
+    int y = m_y_margin + row * m_cell_height;
+    std::string buf;
+
+    for ( int col = first; col <= last; ++col )
+    {
+        Cell const & c = cell( row, col );
+        int x = m_x_margin + col * m_cell_width;
+
+        if ( c.attr & Reverse )
+            FillArea( x, y, m_cell_width, m_cell_height, BLACK );
+
+        if ( c.ch != ' ' )
+        {
+            buf.clear( );
+            append_utf8( c.ch, buf );
+
+            if ( c.attr & Reverse )
+                SetFont( font, WHITE );
+            DrawString( x, y, buf.c_str( ) );
+            if ( c.attr & Bold )
+                DrawString( x + 1, y, buf.c_str( ) );
+            if ( c.attr & Reverse )
+                SetFont( font, BLACK );
+        }
+
+        if ( c.attr & Underline )
+            DrawLine( x, y + m_cell_height - 2,
+                      x + m_cell_width - 1, y + m_cell_height - 2,
+                      c.attr & Reverse ? WHITE : BLACK );
+
+        if ( m_is_cursor_visible && row == m_row && col == m_col )
+            InvertArea( x, y, m_cell_width, m_cell_height );
+    }
+}
+
+
+/******************************************
+ * Appends the UTF-8 encoding of a code point to a string
+ ******************************************/
+
+void
+Screen_Grid::append_utf8( unsigned int  ch,
+                          std::string & dest )
+{
+    if ( ch < 0x80 )
+        dest += static_cast< char >( ch );
+    else if ( ch < 0x800 )
+    {
+        dest += static_cast< char >( 0xc0 | ( ch >> 6 ) );
+        dest += static_cast< char >( 0x80 | ( ch & 0x3f ) );
+    }
+    else if ( ch < 0x10000 )
+    {
+        dest += static_cast< char >( 0xe0 | ( ch >> 12 ) );
+        dest += static_cast< char >( 0x80 | ( ( ch >> 6 ) & 0x3f ) );
+        dest += static_cast< char >( 0x80 | ( ch & 0x3f ) );
+    }
+    else
+    {
+        dest += static_cast< char >( 0xf0 | ( ch >> 18 ) );
+        dest += static_cast< char >( 0x80 | ( ( ch >> 12 ) & 0x3f ) );
+        dest += static_cast< char >( 0x80 | ( ( ch >> 6 ) & 0x3f ) );
+        dest += static_cast< char >( 0x80 | ( ch & 0x3f ) );
+    }
+}
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,340 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#if ! defined SCREEN_GRID_HPP_
+#define SCREEN_GRID_HPP_
+
+
+#include <string>
+#include <vector>
+#include "Ansi_Parser.hpp"
+#include "Inkview.hpp"
+
+
+/******************************************
+ * Class for a fixed-size grid of character cells as needed by programs
+ * that position the cursor (like vi, top or less). It's driven by the
+ * text, control characters and escape sequences found by the Ansi_Parser.
+ * For each row the range of columns changed since it was last drawn is
+ * tracked, so only those cells need to be redrawn.
+ ******************************************/
+
+class Screen_Grid : public Ansi_Sink
+{
+  public :
+
+    // Attributes of a cell
+
+    enum
+    {
+        Bold      = 1,
+        Underline = 2,
+        Reverse   = 4
+    };
+
+
+    Screen_Grid( );
+
+
+    // Sets the number of rows and columns, keeping as much of the
+    // content as fits
+
+    void
+    resize( int rows,
+            int columns );
+
+
+    // Sets where and how large the cells are drawn
+
+    void
+    set_geometry( int x_margin,
+                  int y_margin,
+                  int cell_width,
+                  int cell_height );
+
+
+    // Blanks all cells and puts the cursor into the upper left corner
+
+    void
+    clear( );
+
+
+    // Resets everything (also attributes and scroll region)
+
+    void
+    reset( );
+
+
+    // Ansi_Sink interface
+
+    void
+    text( std::string const & txt );
+
+
+    void
+    control( char c );
+
+
+    void
+    escape( char c );
+
+
+    void
+    csi( char                       priv,
+         std::vector< int > const & params,
+         char                       final );
+
+
+    // Appends the lines that were scrolled off the top since the last call
+    // to the string (they're meant to go into the scrollback)
+
+    void
+    take_scrolled_off( std::string & dest );
+
+
+    // Appends the text of all rows (up to the last one that isn't empty
+    // or contains the cursor) to the string
+
+    void
+    dump( std::string & dest ) const;
+
+
+    // Draws all cells
+
+    void
+    redraw( ifont * font );
+
+
+    // Draws the cells changed since they were last drawn and returns the
+    // area they cover (returns false if there weren't any)
+
+    bool
+    draw_changes( ifont * font,
+                  irect & area );
+
+
+    // Returns if there are cells that need to be drawn
+
+    bool
+    is_dirty( ) const  { return m_dirty_rows > 0; }
+
+
+    // Returns the number of rows
+
+    int
+    rows( ) const  { return m_rows; }
+
+
+    // Returns the number of columns
+
+    int
+    columns( ) const  { return m_columns; }
+
+
+  private :
+
+    // Content of a cell, a Unicode code point and its attributes
+
+    struct Cell
+    {
+        unsigned int  ch;
+        unsigned char attr;
+    };
+
+
+    // Range of columns in a row that need redrawing (empty if 'first'
+    // is larger than 'last')
+
+    struct Dirty
+    {
+        int first;
+        int last;
+    };
+
+
+    Cell &
+    cell( int row,
+          int col )  { return m_cells[ row * m_columns + col ]; }
+
+
+    Cell const &
+    cell( int row,
+          int col ) const  { return m_cells[ row * m_columns + col ]; }
+
+
+    void
+    put( unsigned int ch );
+
+
+    void
+    line_feed( );
+
+
+    void
+    reverse_line_feed( );
+
+
+    void
+    scroll_up( int top,
+               int bottom,
+               int count );
+
+
+    void
+    scroll_down( int top,
+                 int bottom,
+                 int count );
+
+
+    void
+    erase( int row,
+           int first,
+           int last );
+
+
+    void
+    move_cursor( int row,
+                 int col );
+
+
+    void
+    set_attributes( std::vector< int > const & params );
+
+
+    void
+    mark_dirty( int row,
+                int first,
+                int last );
+
+
+    void
+    mark_all_dirty( );
+
+
+    void
+    row_text( int           row,
+              std::string & dest ) const;
+
+
+    void
+    draw_cells( ifont * font,
+                int     row,
+                int     first,
+                int     last );
+
+
+    static void
+    append_utf8( unsigned int  ch,
+                 std::string & dest );
+
+
+    // Number of rows and columns
+
+    int m_rows;
+
+
+    int m_columns;
+
+
+    // All cells, row by row
+
+    std::vector< Cell > m_cells;
+
+
+    // Ranges of columns in need of redrawing for each row and the number
+    // of rows with such a range
+
+    std::vector< Dirty > m_dirty;
+
+
+    int m_dirty_rows;
+
+
+    // Position and size of the cells on the screen
+
+    int m_x_margin;
+
+
+    int m_y_margin;
+
+
+    int m_cell_width;
+
+
+    int m_cell_height;
+
+
+    // Cursor position and a flag, set when the cursor is in the last
+    // column and a character has already been written to it (the line
+    // only gets wrapped when the next character arrives)
+
+    int m_row;
+
+
+    int m_col;
+
+
+    bool m_is_wrap_pending;
+
+
+    // Saved cursor position and attributes
+
+    int m_saved_row;
+
+
+    int m_saved_col;
+
+
+    unsigned char m_saved_attr;
+
+
+    // Flag, set if the cursor is to be shown
+
+    bool m_is_cursor_visible;
+
+
+    // Attributes for new characters
+
+    unsigned char m_attr;
+
+
+    // First and last row of the scroll region
+
+    int m_top;
+
+
+    int m_bottom;
+
+
+    // Lines scrolled off the top of the screen not yet fetched
+
+    std::string m_scrolled_off;
+};
+
+
+#endif
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
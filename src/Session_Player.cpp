@@ -0,0 +1,235 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "Session_Player.hpp"
+#include "Messenger.hpp"
+#include "Utils.hpp"
+#include "Defaults.hpp"
+#include <algorithm>
+
+
+// Definition of the static member used to find the Session_Player instance
+// from within static member functions
+
+Session_Player * Session_Player::s_handling_player;
+
+
+/******************************************
+ ******************************************/
+
+Session_Player::Session_Player( Messenger & mess )
+    : m_mess( mess )
+    , m_next( 0 )
+    , m_position( 0 )
+    , m_resumed( 0 )
+    , m_speed( 1 )
+    , m_is_playing( false )
+{
+    s_handling_player = this;
+}
+
+
+/******************************************
+ ******************************************/
+
+Session_Player::~Session_Player( )
+{
+    stop( );
+}
+
+
+/******************************************
+ * Reads in the recording and starts playing it. Pauses longer than the
+ * maximum idle time get shortened right away.
+ ******************************************/
+
+bool
+Session_Player::start( std::string const & file_name,
+                       int                 speed )
+{
+    stop( );
+
+    if ( ! Session_Recorder::load( file_name, m_events ) )
+        return false;
+
+    double shift = 0;
+    double last = 0;
+
+    for ( std::size_t i = 0; i < m_events.size( ); ++i )
+    {
+        double time = m_events[ i ].time;
+
+        if ( time - last > PLAYBACK_MAX_IDLE / 1000.0 )
+            shift += time - last - PLAYBACK_MAX_IDLE / 1000.0;
+        last = std::max( last, time );
+        m_events[ i ].time = std::max( time - shift, 0.0 );
+    }
+
+    m_next       = 0;
+    m_position   = 0;
+    m_resumed    = Utils::microseconds( );
+    m_speed      = std::max( speed, 1 );
+    m_is_playing = true;
+
+    schedule( );
+    return true;
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+Session_Player::set_speed( int speed )
+{
+    if ( ! m_is_playing )
+        return;
+
+    m_position = position( );
+    m_resumed  = Utils::microseconds( );
+    m_speed    = std::max( speed, 1 );
+
+    schedule( );
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+Session_Player::skip( int seconds )
+{
+    if ( ! m_is_playing )
+        return;
+
+    double target = seconds < 0 ? m_events.back( ).time
+                                : position( ) + seconds;
+
+    play_until( target );
+
+    m_position = target;
+    m_resumed  = Utils::microseconds( );
+
+    schedule( );
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+Session_Player::stop( )
+{
+    if ( ! m_is_playing )
+        return;
+
+    ClearTimer( &Session_Player::static_timer_handler );
+
+    std::vector< Session_Recorder::Event >( ).swap( m_events );
+    m_is_playing = false;
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+Session_Player::static_timer_handler( )
+{
+    s_handling_player->timer_handler( );
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+Session_Player::timer_handler( )
+{
+    play_until( position( ) );
+    schedule( );
+}
+
+
+/******************************************
+ ******************************************/
+
+double
+Session_Player::position( ) const
+{
+    return   m_position
+           + ( Utils::microseconds( ) - m_resumed ) * 1.0e-6 * m_speed;
+}
+
+
+/******************************************
+ * Passes the output and input of all events up to the given time on in
+ * one piece (there's no point in having the display deal with them one
+ * by one)
+ ******************************************/
+
+void
+Session_Player::play_until( double time )
+{
+    std::string text;
+
+    for ( ; m_next < m_events.size( ) && m_events[ m_next ].time <= time;
+          ++m_next )
+        if (    m_events[ m_next ].type == Session_Recorder::Output
+             || m_events[ m_next ].type == Session_Recorder::Input )
+            text += m_events[ m_next ].data;
+
+    if ( ! text.empty( ) )
+        m_mess.send( message::New_Text( text ) );
+}
+
+
+/******************************************
+ * Sets the timer for when the next event is due (but not sooner than
+ * the frame interval), stops when all events have been played
+ ******************************************/
+
+void
+Session_Player::schedule( )
+{
+    ClearTimer( &Session_Player::static_timer_handler );
+
+    if ( m_next >= m_events.size( ) )
+    {
+        stop( );
+        return;
+    }
+
+    double wait = ( m_events[ m_next ].time - position( ) ) * 1000 / m_speed;
+    int ms = static_cast< int >( std::max( wait, PLAYBACK_FRAME_INTERVAL
+                                                 * 1.0 ) );
+
+    SetWeakTimer( APP_NAME "_play", &Session_Player::static_timer_handler,
+                  ms );
+}
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
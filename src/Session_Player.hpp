@@ -0,0 +1,147 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#if ! defined SESSION_PLAYER_HPP_
+#define SESSION_PLAYER_HPP_
+
+
+#include "Session_Recorder.hpp"
+#include <string>
+#include <vector>
+
+
+class Messenger;
+
+
+/******************************************
+ * Class for playing back a recorded session: output and input get passed
+ * to the Messenger as new text, just like output read from the shell, at
+ * the speed they were recorded with (or a multiple of it). Long pauses
+ * get shortened. Playing can also skip forward, everything skipped gets
+ * shown at once. Changes of the terminal size can't be played back and
+ * are ignored.
+ ******************************************/
+
+class Session_Player
+{
+  public :
+
+    Session_Player( Messenger & mess );
+
+
+    ~Session_Player( );
+
+
+    // Starts playing a recording from its start, returns false if it
+    // can't be read
+
+    bool
+    start( std::string const & file_name,
+           int                 speed );
+
+
+    // Changes the speed (as a multiple of the recorded speed)
+
+    void
+    set_speed( int speed );
+
+
+    // Skips forward by some seconds, or, if negative, to the end
+
+    void
+    skip( int seconds );
+
+
+    void
+    stop( );
+
+
+    bool
+    is_playing( ) const  { return m_is_playing; }
+
+
+  private :
+
+    static void
+    static_timer_handler( );
+
+
+    void
+    timer_handler( );
+
+
+    // Returns the current position in the recording (in seconds)
+
+    double
+    position( ) const;
+
+
+    // Shows all events up to a position in the recording
+
+    void
+    play_until( double time );
+
+
+    // Sets the timer for the next event
+
+    void
+    schedule( );
+
+
+    Messenger & m_mess;
+
+
+    std::vector< Session_Recorder::Event > m_events;
+
+
+    // Index of the next event to be played
+
+    std::size_t m_next;
+
+
+    // Position in the recording (in seconds) at the time the playback
+    // was started or its speed changed, and that time (in microseconds)
+
+    double m_position;
+
+
+    unsigned long long m_resumed;
+
+
+    int m_speed;
+
+
+    bool m_is_playing;
+
+
+    static Session_Player * s_handling_player;
+};
+
+
+#endif
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
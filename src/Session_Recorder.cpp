@@ -0,0 +1,521 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "Session_Recorder.hpp"
+#include "Async_Writer.hpp"
+#include "Utils.hpp"
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+
+namespace
+{
+
+/******************************************
+ * Returns the length of the UTF-8 sequence at the start of a text (with
+ * 'len' bytes available) or 0 if it's not a valid one. If the bytes
+ * available are the valid start of a longer sequence 'is_incomplete'
+ * gets set. The range allowed for the second byte depends on the first
+ * one, which excludes overlong forms, surrogates and code points above
+ * U+10FFFF.
+ ******************************************/
+
+std::size_t
+utf8_length( unsigned char const * s,
+             std::size_t           len,
+             bool                & is_incomplete )
+{
+    is_incomplete = false;
+
+    std::size_t need;
+    unsigned char low  = 0x80,
+                  high = 0xBF;
+
+    if ( s[ 0 ] < 0x80 )
+        return 1;
+    else if ( s[ 0 ] >= 0xC2 && s[ 0 ] <= 0xDF )
+        need = 2;
+    else if ( s[ 0 ] >= 0xE0 && s[ 0 ] <= 0xEF )
+        need = 3;
+    else if ( s[ 0 ] >= 0xF0 && s[ 0 ] <= 0xF4 )
+        need = 4;
+    else
+        return 0;
+
+    if ( s[ 0 ] == 0xE0 )
+        low = 0xA0;
+    else if ( s[ 0 ] == 0xED )
+        high = 0x9F;
+    else if ( s[ 0 ] == 0xF0 )
+        low = 0x90;
+    else if ( s[ 0 ] == 0xF4 )
+        high = 0x8F;
+
+    for ( std::size_t i = 1; i < need; ++i )
+    {
+        if ( i == len )
+        {
+            is_incomplete = true;
+            return 0;
+        }
+
+        if ( s[ i ] < low || s[ i ] > high )
+            return 0;
+
+        low  = 0x80;
+        high = 0xBF;
+    }
+
+    return need;
+}
+
+
+/******************************************
+ * Appends a character (given by its code point) in UTF-8 encoding
+ ******************************************/
+
+void
+append_utf8( std::string  & str,
+             unsigned long  c )
+{
+    if ( c < 0x80 )
+        str += static_cast< char >( c );
+    else if ( c < 0x800 )
+    {
+        str += static_cast< char >( 0xC0 | ( c >> 6 ) );
+        str += static_cast< char >( 0x80 | ( c & 0x3F ) );
+    }
+    else if ( c < 0x10000 )
+    {
+        str += static_cast< char >( 0xE0 | ( c >> 12 ) );
+        str += static_cast< char >( 0x80 | ( ( c >> 6 ) & 0x3F ) );
+        str += static_cast< char >( 0x80 | ( c & 0x3F ) );
+    }
+    else
+    {
+        str += static_cast< char >( 0xF0 | ( c >> 18 ) );
+        str += static_cast< char >( 0x80 | ( ( c >> 12 ) & 0x3F ) );
+        str += static_cast< char >( 0x80 | ( ( c >> 6 ) & 0x3F ) );
+        str += static_cast< char >( 0x80 | ( c & 0x3F ) );
+    }
+}
+
+
+/******************************************
+ * Reads the 4 hex digits of an \u escape, returns false if there aren't
+ * any
+ ******************************************/
+
+bool
+parse_hex4( std::string const & line,
+            std::size_t       & pos,
+            unsigned long     & c )
+{
+    if ( pos + 4 > line.size( ) )
+        return false;
+
+    c = 0;
+    for ( std::size_t end = pos + 4; pos < end; ++pos )
+    {
+        char h = line[ pos ];
+
+        c <<= 4;
+        if ( h >= '0' && h <= '9' )
+            c |= h - '0';
+        else if ( h >= 'a' && h <= 'f' )
+            c |= h - 'a' + 10;
+        else if ( h >= 'A' && h <= 'F' )
+            c |= h - 'A' + 10;
+        else
+            return false;
+    }
+
+    return true;
+}
+
+
+/******************************************
+ * Parses a JSON string starting at 'pos' (leading white space is skipped),
+ * on success 'pos' is set to the position following it
+ ******************************************/
+
+bool
+parse_json_string( std::string const & line,
+                   std::size_t       & pos,
+                   std::string       & str )
+{
+    pos = line.find_first_not_of( " \t", pos );
+    if ( pos == std::string::npos || line[ pos++ ] != '"' )
+        return false;
+
+    str.clear( );
+
+    while ( pos < line.size( ) )
+    {
+        char c = line[ pos++ ];
+
+        if ( c == '"' )
+            return true;
+
+        if ( c != '\\' )
+        {
+            str += c;
+            continue;
+        }
+
+        if ( pos == line.size( ) )
+            return false;
+
+        switch ( c = line[ pos++ ] )
+        {
+            case 'b' : str += '\b'; break;
+            case 'f' : str += '\f'; break;
+            case 'n' : str += '\n'; break;
+            case 'r' : str += '\r'; break;
+            case 't' : str += '\t'; break;
+
+            case 'u' :
+            {
+                unsigned long u;
+                if ( ! parse_hex4( line, pos, u ) )
+                    return false;
+
+                // Characters outside the BMP come as surrogate pairs
+
+                unsigned long low;
+                if (    u >= 0xD800 && u <= 0xDBFF
+                     && line.compare( pos, 2, "\\u" ) == 0 )
+                {
+                    std::size_t p = pos + 2;
+                    if (    parse_hex4( line, p, low )
+                         && low >= 0xDC00 && low <= 0xDFFF )
+                    {
+                        u = 0x10000 + ( ( u - 0xD800 ) << 10 )
+                            + ( low - 0xDC00 );
+                        pos = p;
+                    }
+                }
+
+                append_utf8( str, u );
+                break;
+            }
+
+            default :
+                str += c;
+        }
+    }
+
+    return false;
+}
+
+
+/******************************************
+ * Parses the line for an event, returns false if it's not one
+ ******************************************/
+
+bool
+parse_event( std::string const         & line,
+             Session_Recorder::Event   & event )
+{
+    std::size_t pos = line.find_first_not_of( " \t" );
+    if ( pos == std::string::npos || line[ pos ] != '[' )
+        return false;
+
+    char const * start = line.c_str( ) + pos + 1;
+    char * end;
+
+    event.time = std::strtod( start, &end );
+    if ( end == start || event.time < 0 )
+        return false;
+
+    pos = line.find_first_not_of( " \t", end - line.c_str( ) );
+    if ( pos == std::string::npos || line[ pos++ ] != ',' )
+        return false;
+
+    std::string type;
+    if ( ! parse_json_string( line, pos, type ) || type.size( ) != 1 )
+        return false;
+    event.type = type[ 0 ];
+
+    pos = line.find_first_not_of( " \t", pos );
+    if ( pos == std::string::npos || line[ pos++ ] != ',' )
+        return false;
+
+    return parse_json_string( line, pos, event.data );
+}
+
+}
+
+
+/******************************************
+ ******************************************/
+
+Session_Recorder::Session_Recorder( std::size_t max_size,
+                                    int         max_files )
+    : m_writer( 0 )
+    , m_max_size( max_size )
+    , m_max_files( max_files )
+    , m_start( 0 )
+{
+}
+
+
+/******************************************
+ ******************************************/
+
+Session_Recorder::~Session_Recorder( )
+{
+    close( );
+}
+
+
+/******************************************
+ * Creates the file, with the header at the start of it (and of each new
+ * file started when it gets too large, so each one can be played back)
+ ******************************************/
+
+bool
+Session_Recorder::open( std::string const & file_name,
+                        int                 columns,
+                        int                 rows )
+{
+    close( );
+
+    char header[ 256 ];
+    int len = std::snprintf( header, sizeof header,
+                             "{\"version\": 2, \"width\": %d, \"height\": %d, "
+                             "\"timestamp\": %lu, \"title\": \"pbterm\"}\n",
+                             columns, rows,
+                             static_cast< unsigned long >( std::time( 0 ) ) );
+
+    m_writer = new Async_Writer( );
+    if ( ! m_writer->open( file_name, m_max_size, m_max_files,
+                           std::string( header, len ) ) )
+    {
+        delete m_writer;
+        m_writer = 0;
+        return false;
+    }
+
+    m_start = Utils::microseconds( );
+    m_partial.clear( );
+    return true;
+}
+
+
+/******************************************
+ * Records what's left of an incomplete UTF-8 sequence and closes the
+ * file (once everything has been written)
+ ******************************************/
+
+void
+Session_Recorder::close( )
+{
+    if ( ! m_writer )
+        return;
+
+    if ( ! m_partial.empty( ) )
+        write_event( Output, m_partial.data( ), m_partial.size( ) );
+    m_partial.clear( );
+
+    delete m_writer;
+    m_writer = 0;
+}
+
+
+/******************************************
+ * Records an event. Output of the shell may end in the middle of an UTF-8
+ * sequence (the rest of it coming with the next output), so an incomplete
+ * sequence at the end is kept back until the next output arrives.
+ ******************************************/
+
+void
+Session_Recorder::add( Event_Type          type,
+                       std::string const & data )
+{
+    if ( ! m_writer )
+        return;
+
+    std::string joined;
+    std::string const * txt = &data;
+    std::size_t len = data.size( );
+
+    if ( type == Output )
+    {
+        if ( ! m_partial.empty( ) )
+        {
+            joined = m_partial + data;
+            txt = &joined;
+            m_partial.clear( );
+        }
+
+        len = txt->size( );
+        for ( std::size_t i = len > 3 ? len - 3 : 0; i < len; ++i )
+        {
+            bool is_incomplete;
+            utf8_length( reinterpret_cast< unsigned char const * >(
+                                                         txt->data( ) + i ),
+                         len - i, is_incomplete );
+            if ( is_incomplete )
+            {
+                m_partial.assign( *txt, i, len - i );
+                len = i;
+                break;
+            }
+        }
+    }
+
+    // Only output may have an incomplete sequence held back, input and
+    // size changes always get written in full
+
+    if ( len )
+        write_event( type, txt->data( ), len );
+}
+
+
+/******************************************
+ * Writes the line for an event
+ ******************************************/
+
+void
+Session_Recorder::write_event( Event_Type    type,
+                               char const  * data,
+                               std::size_t   len )
+{
+    char time[ 32 ];
+    std::snprintf( time, sizeof time, "%.6f",
+                   ( Utils::microseconds( ) - m_start ) / 1.0e6 );
+
+    m_line.clear( );
+    m_line += '[';
+    m_line += time;
+    m_line += ", \"";
+    m_line += static_cast< char >( type );
+    m_line += "\", ";
+    append_json_string( data, len );
+    m_line += "]\n";
+
+    m_writer->write( m_line.data( ), m_line.size( ) );
+}
+
+
+/******************************************
+ * Appends text as a JSON string to the line, with everything that's not
+ * part of a valid UTF-8 sequence replaced by U+FFFD
+ ******************************************/
+
+void
+Session_Recorder::append_json_string( char const  * data,
+                                      std::size_t   len )
+{
+    unsigned char const * s =
+                            reinterpret_cast< unsigned char const * >( data );
+
+    m_line += '"';
+
+    for ( std::size_t i = 0; i < len; )
+    {
+        unsigned char c = s[ i ];
+
+        if ( c == '"' || c == '\\' )
+        {
+            m_line += '\\';
+            m_line += c;
+        }
+        else if ( c == '\n' )
+            m_line += "\\n";
+        else if ( c == '\r' )
+            m_line += "\\r";
+        else if ( c == '\t' )
+            m_line += "\\t";
+        else if ( c < 0x20 || c == 0x7F )
+        {
+            char esc[ 8 ];
+            std::snprintf( esc, sizeof esc, "\\u%04x", c );
+            m_line += esc;
+        }
+        else if ( c >= 0x80 )
+        {
+            bool is_incomplete;
+            std::size_t n = utf8_length( s + i, len - i, is_incomplete );
+
+            if ( n )
+                m_line.append( data + i, n );
+            else
+            {
+                m_line += "\\ufffd";
+                n = 1;
+            }
+
+            i += n;
+            continue;
+        }
+        else
+            m_line += c;
+
+        ++i;
+    }
+
+    m_line += '"';
+}
+
+
+/******************************************
+ * Reads in a recording: the first line must be a header for version 2
+ * of the format, each following line is an event
+ ******************************************/
+
+bool
+Session_Recorder::load( std::string const    & file_name,
+                        std::vector< Event > & events )
+{
+    std::ifstream in( file_name.c_str( ) );
+    std::string line;
+
+    events.clear( );
+
+    if ( ! std::getline( in, line ) )
+        return false;
+
+    std::size_t pos = line.find( "\"version\"" );
+    if (    pos == std::string::npos
+         || ( pos = line.find( ':', pos ) ) == std::string::npos
+         || std::strtol( line.c_str( ) + pos + 1, 0, 10 ) != 2 )
+        return false;
+
+    Event event;
+
+    while ( std::getline( in, line ) )
+        if ( parse_event( line, event ) )
+            events.push_back( event );
+
+    return true;
+}
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
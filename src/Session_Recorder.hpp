@@ -0,0 +1,175 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#if ! defined SESSION_RECORDER_HPP_
+#define SESSION_RECORDER_HPP_
+
+
+#include <string>
+#include <vector>
+
+
+class Async_Writer;
+
+
+/******************************************
+ * Class for recording a session, i.e. the output of the shell, what the
+ * user entered and changes of the terminal size, each stamped with the
+ * time it happened, to a file in the asciicast (version 2) format used
+ * by asciinema. The first line of the file is a JSON object with the
+ * terminal size and the time the recording was started, followed by a
+ * line per event
+ *
+ *   [<seconds since start>, "<type>", "<data>"]
+ *
+ * with the type being "o" for output, "i" for input and "r" for a new
+ * terminal size ("<columns>x<rows>"). Since JSON strings must be valid
+ * UTF-8, bytes not belonging to a valid UTF-8 sequence are recorded as
+ * U+FFFD. The file gets written by a thread of its own, so recording
+ * costs hardly more than formatting the events.
+ ******************************************/
+
+class Session_Recorder
+{
+  public :
+
+    // Types of events
+
+    enum Event_Type
+    {
+        Output = 'o',
+        Input  = 'i',
+        Resize = 'r'
+    };
+
+
+    // An event read back in
+
+    struct Event
+    {
+        double time;
+        char type;
+        std::string data;
+    };
+
+
+    // The size of recording files (in bytes) can be limited, with that
+    // many older ones being kept (see Async_Writer)
+
+    Session_Recorder( std::size_t max_size = 0,
+                      int         max_files = 0 );
+
+
+    ~Session_Recorder( );
+
+
+    // Creates the file and writes the header, returns false on failure
+
+    bool
+    open( std::string const & file_name,
+          int                 columns,
+          int                 rows );
+
+
+    // Writes out what's still pending and closes the file
+
+    void
+    close( );
+
+
+    bool
+    is_open( ) const  { return m_writer != 0; }
+
+
+    // Records an event, stamped with the current time
+
+    void
+    add( Event_Type          type,
+         std::string const & data );
+
+
+    // Reads in a recording, returns false if the file can't be opened or
+    // isn't in asciicast version 2 format (lines with events that can't
+    // be parsed are skipped)
+
+    static bool
+    load( std::string const    & file_name,
+          std::vector< Event > & events );
+
+
+  private :
+
+    // Copying isn't allowed
+
+    Session_Recorder( Session_Recorder const & );
+
+
+    Session_Recorder &
+    operator = ( Session_Recorder const & );
+
+
+    void
+    write_event( Event_Type    type,
+                 char const  * data,
+                 std::size_t   len );
+
+
+    void
+    append_json_string( char const  * data,
+                        std::size_t   len );
+
+
+    Async_Writer * m_writer;
+
+
+    std::size_t m_max_size;
+
+
+    int m_max_files;
+
+
+    // Time the recording was started (in microseconds)
+
+    unsigned long long m_start;
+
+
+    // Start of an UTF-8 sequence at the end of the last output, still
+    // waiting for the rest of it
+
+    std::string m_partial;
+
+
+    // Buffer for assembling the line for an event (kept around to avoid
+    // allocations)
+
+    std::string m_line;
+};
+
+
+#endif
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,121 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "Stats_Writer.hpp"
+#include "Messenger.hpp"
+#include "Config.hpp"
+#include "Utils.hpp"
+#include "Defaults.hpp"
+#include <fstream>
+#include <cstdio>
+
+
+// Definition of the static member used to find the Stats_Writer instance
+// from within static member functions
+
+Stats_Writer * Stats_Writer::s_handling_writer;
+
+
+/******************************************
+ * Constructor, starts the timer if the file is to be written at all
+ ******************************************/
+
+Stats_Writer::Stats_Writer( Messenger & mess,
+                            Config    & config )
+    : m_mess( mess )
+    , m_interval( config.stats_interval( ) * 1000 )
+    , m_file_name( config.stats_file( ) )
+{
+    s_handling_writer = this;
+
+    if ( m_interval > 0 )
+        SetWeakTimer( APP_NAME "_stats", &Stats_Writer::static_timer_handler,
+                      m_interval );
+}
+
+
+/******************************************
+ ******************************************/
+
+Stats_Writer::~Stats_Writer( )
+{
+    if ( m_interval <= 0 )
+        return;
+
+    ClearTimer( &Stats_Writer::static_timer_handler );
+    write( );
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+Stats_Writer::static_timer_handler( )
+{
+    s_handling_writer->timer_handler( );
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+Stats_Writer::timer_handler( )
+{
+    write( );
+    SetWeakTimer( APP_NAME "_stats", &Stats_Writer::static_timer_handler,
+                  m_interval );
+}
+
+
+/******************************************
+ * Writes the statistics to a temporary file that then gets renamed to
+ * the real name (which replaces the old file in one go)
+ ******************************************/
+
+void
+Stats_Writer::write( )
+{
+    std::string path( Utils::prepare_file_creation( m_file_name ) );
+
+    if ( path.empty( ) )
+        return;
+
+    request::Get_Statistics gs( m_alloc_baseline );
+    m_mess.send( gs );
+
+    std::string tmp_name( path + ".tmp" );
+    std::ofstream ofs( tmp_name.c_str( ) );
+
+    ofs << gs.result;
+    ofs.close( );
+
+    if ( ofs.fail( ) || std::rename( tmp_name.c_str( ), path.c_str( ) ) )
+        std::remove( tmp_name.c_str( ) );
+}
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
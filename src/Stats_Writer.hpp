@@ -0,0 +1,94 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#if ! defined STATS_WRITER_HPP_
+#define STATS_WRITER_HPP_
+
+
+#include <string>
+#include "Alloc_Profile.hpp"
+
+
+class Messenger;
+class Config;
+
+
+/******************************************
+ * Class for periodically writing the statistics to a file. The file is
+ * replaced as a whole each time, so whoever reads it never sees a half
+ * written one.
+ ******************************************/
+
+class Stats_Writer
+{
+  public :
+
+    Stats_Writer( Messenger & mess,
+                  Config    & config );
+
+
+    // Writes the file a last time
+
+    ~Stats_Writer( );
+
+
+  private :
+
+    static void
+    static_timer_handler( );
+
+
+    void
+    timer_handler( );
+
+
+    void
+    write( );
+
+
+    Messenger & m_mess;
+
+
+    // Time (in ms) between writes, 0 if the file isn't to be written
+
+    int m_interval;
+
+
+    std::string m_file_name;
+
+
+    // Allocation counts of the previous write
+
+    Alloc_Profile::Baseline m_alloc_baseline;
+
+
+    static Stats_Writer * s_handling_writer;
+};
+
+
+#endif
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -80,6 +80,17 @@ Submenu::add( short int    type,
 }
 
 
+/***************************************
+ * Removes all entries but the sentinel
+ ***************************************/
+
+void
+Submenu::clear( )
+{
+    m_entries.erase( m_entries.begin( ), m_entries.end( ) - 1 );
+}
+
+
 /***************************************
  * Returns if a certain index (as returned by libinkview to the
  * handler function) exists in the submenu (assumes that they
@@ -53,6 +53,12 @@ class Submenu
          const char * text );
 
 
+    // Removes all entries (but keeps the memory for them)
+
+    void
+    clear( );
+
+
     int
     size( ) const  { return m_entries.size( ) - 1; }
 
@@ -85,6 +91,10 @@ class Submenu
     addr( );
 
 
+    int
+    start_index( ) const  { return m_start_index; }
+
+
     int
     next_free_index( ) const  { return m_start_index + size( ); }
 
@@ -24,8 +24,12 @@
 #include "Logger.hpp"
 #include "Utils.hpp"
 #include "Defaults.hpp"
+#include "Metrics.hpp"
+#include "Alloc_Profile.hpp"
+#include <sstream>
 #include <cerrno>
-#include <fstream>
+#include <cstdlib>
+#include <climits>
 #include <unistd.h>
 #include <termios.h>
 #include <sys/ioctl.h>
@@ -37,6 +41,18 @@
 Term * Term::s_handling_term;
 
 
+// Metrics about the communication with the shell
+
+namespace
+{
+
+Metrics::Counter & s_bytes_read    = Metrics::counter( "bytes read" );
+Metrics::Counter & s_bytes_written = Metrics::counter( "bytes written" );
+Histogram & s_reads_per_check      = Metrics::histogram( "reads per check" );
+
+}
+
+
 /******************************************
  * Constructor, starts the shell and tries to read in stored commands
  * from a previous session
@@ -46,25 +62,58 @@ Term::Term( Messenger & mess,
             Config    & config )
     : m_mess( mess )
     , m_check_interval( config.check_interval( ) )
+    , m_shell_pid( -1 )
     , m_write_fd( -1 )
     , m_read_fd( -1 )
+    , m_rows( 0 )
+    , m_columns( 0 )
+    , m_commands( config.max_history( ) )
     , m_logger( config.logger( ) )
-    , m_max_history( config.max_history( ) )
-    , m_cmd_file( config.cmd_file( ) )
+    , m_journal( config.cmd_file( ), config.max_history( ) )
+    , m_usage( config.cmd_file( ) + ".usage", config.max_history( ) )
+    , m_num_suggestions( config.suggestions( ) )
+    , m_session_commands( 0 )
 {
     s_handling_term = this;
 
+    // Get the size of the screen (in rows and columns), it's set for the
+    // pseudoterminal before the shell gets started
+
+    request::Get_Terminal_Size size;
+    m_mess.send( size );
+    m_rows    = size.rows;
+    m_columns = size.columns;
+
     // Start the shell, abort on any failures
 
-    if ( start_shell( config.shell( ) ) <= 0 )
+    if ( ( m_shell_pid = start_shell( config.shell( ) ) ) <= 0 )
     {
         m_mess.send( message::Close( ) );
         return;
     }
 
-    // Read in the file with the command history
+    // Read in the file with the command history. How often the commands
+    // were used is taken from the usage statistics where they're known,
+    // counting the entries in the file would only give the uses since it
+    // was last rewritten.
+
+    m_journal.load( m_commands );
+    m_usage.load( );
+
+    for ( Command_History::const_iterator it = m_commands.begin( );
+          it != m_commands.end( ); ++it )
+    {
+        double uses = m_usage.score( *it );
+        if ( uses > 0 )
+            m_commands.set_uses( *it, uses );
+    }
 
-    read_cmd_file( );
+    // Open the file for capturing the shell's output if requested
+
+    if (    ! config.capture_file( ).empty( )
+         && ! m_capture.open( config.capture_file( ) ) )
+        m_logger.warn( ) << "Can't open capture file '"
+                         << config.capture_file( ) << "'" << std::endl;
 
     // Start looking for messages from the shell
 
@@ -73,8 +122,8 @@ Term::Term( Messenger & mess,
 
 
 /***************************************
- * Destructor, stores the command history and closes connections to shell,
- * this in turn will make it quit (it's going to receive a SIGPIPE)
+ * Destructor, closes connections to shell, this in turn will make it
+ * quit (it's going to receive a SIGPIPE)
  ***************************************/
 
 Term::~Term( )
@@ -84,42 +133,63 @@ Term::~Term( )
         close( m_write_fd );
         if ( m_write_fd != m_read_fd )
             close( m_read_fd );
-        write_cmd_file( );
     }
 }
 
 
 /******************************************
- * Returns if communication with the shell uses a pseudoterminal
+ * Called when the number of rows and columns that fit onto the screen
+ * changed (due to a rotation or a different font size)
  ******************************************/
 
-bool
-Term::using_pty( )
+void
+Term::window_size_change( int rows,
+                          int columns )
 {
-    return m_write_fd == m_read_fd;
+    if ( rows == m_rows && columns == m_columns )
+        return;
+
+    m_rows    = rows;
+    m_columns = columns;
+
+    if ( m_write_fd >= 0 && using_pty( ) )
+        set_window_size( );
 }
 
 
 /******************************************
- * Stores a command at the end of the list of commands and erases earlier
- * entries of the same command. Keeps the list from getting longer than
- * is set by 'm_max_history'.
+ * Tells the pseudoterminal about the number of rows and columns. If the
+ * size changes while the shell is running the kernel sends a SIGWINCH
+ * to the foreground process group, so programs can find out about it.
  ******************************************/
 
 void
-Term::save_command( std::string const & cmd )
+Term::set_window_size( )
 {
-    for ( std::size_t i = 0; i < m_commands.size( ); ++i )
-        if ( cmd == m_commands[ i ] )
-        {
-            m_commands.erase( m_commands.begin( ) + i );
-            break;
-        }
+    if ( m_rows <= 0 || m_columns <= 0 )
+        return;
+
+    struct winsize ws;
 
-    while ( m_commands.size( ) >= m_max_history )
-        m_commands.erase( m_commands.begin( ) );
+    ws.ws_row    = m_rows;
+    ws.ws_col    = m_columns;
+    ws.ws_xpixel = 0;
+    ws.ws_ypixel = 0;
 
-    m_commands.push_back( cmd );
+    if ( ioctl( m_write_fd, TIOCSWINSZ, &ws ) == -1 )
+        m_logger.error( ) << "Setting window size failed: "
+                          << strerror( errno ) << std::endl;
+}
+
+
+/******************************************
+ * Returns if communication with the shell uses a pseudoterminal
+ ******************************************/
+
+bool
+Term::using_pty( )
+{
+    return m_write_fd == m_read_fd;
 }
 
 
@@ -127,7 +197,7 @@ Term::save_command( std::string const & cmd )
  * Returns list of all commands in the "history"
  ******************************************/
 
-std::vector< std::string > const &
+Command_History const &
 Term::command_list( ) const
 {
     return m_commands;
@@ -142,7 +212,22 @@ Term::command_list( ) const
 std::string
 Term::last_command( ) const
 {
-    return m_commands.empty( ) ? "" : m_commands.back( );
+    return m_commands.last( );
+}
+
+
+/******************************************
+ * Returns the commands most likely to be needed next (at most as many
+ * as are to be suggested), given the directory the shell is in and how
+ * many commands have been sent in this session
+ ******************************************/
+
+void
+Term::suggest_commands( std::vector< std::string > & commands )
+{
+    m_usage.suggest( shell_directory( ),
+                     m_session_commands < USAGE_EARLY_COMMANDS,
+                     m_num_suggestions, commands );
 }
 
 
@@ -154,8 +239,20 @@ Term::last_command( ) const
 void
 Term::send_command( std::string const & cmd )
 {
+    // The directory the command gets used in must be found out before
+    // the shell can change it
+
+    std::string dir( shell_directory( ) );
+
     if ( send( cmd.c_str( ), cmd.size( ) ) )
-        save_command( cmd.substr( 0, cmd.size( ) - 1 ) );
+    {
+        std::string entry( cmd, 0, cmd.size( ) - 1 );
+
+        m_commands.add( entry );
+        m_journal.append( entry, m_commands );
+        m_usage.record( entry, dir,
+                        m_session_commands++ < USAGE_EARLY_COMMANDS );
+    }
 }
 
 
@@ -193,8 +290,10 @@ Term::send( char const * data,
         }
 
         data += cnt;
+        s_bytes_written.add( cnt );
     }
 
+    m_mess.send( message::Trace_Point( message::Trace_Point::Command_Sent ) );
     return true;
 }
 
@@ -237,8 +336,11 @@ Term::timer_handler( )
     else if ( retval > 0 )
     {
         // Pass on any new text to the display and, if recording is on,
-        // write it to the log file
+        // write it to the log file. If capturing is on also store it
+        // as it came in.
 
+        m_capture.add( txt );
+        m_mess.send( message::Trace_Point( message::Trace_Point::Reply_Read ) );
         m_mess.send( message::New_Text( txt ) );
     }
 
@@ -249,68 +351,6 @@ Term::timer_handler( )
 }
 
 
-/***************************************
- * Tries to read in the file with commands used in a previous session
- ***************************************/
-
-void
-Term::read_cmd_file( )
-{
-    // Try to open the commamd file for reading
-
-    std::ifstream ifs( m_cmd_file.c_str( ), std::ifstream::in );
-
-    std::string  line;
-
-    // Keep reading until the end of the file is reached or as many
-    // commands have been found as fit into the history
-
-    while ( ifs.good( ) )
-    {
-        std::getline( ifs, line );
-
-        if ( ifs.fail( ) )
-            break;
-
-        // Remove empty lines and comments (lines starting with a hash mark)
-
-        if ( Utils::left_trim( line ).empty( ) || line[ 0 ] == '#' )
-            continue;
-
-        save_command( line );
-    }
-}
-
-
-/***************************************
- * Tries to write out a file with all commands stored in this session
- ***************************************/
-
-void
-Term::write_cmd_file( )
-{
-    // Create all necessary drectories (if possible)
-
-    std::string path( Utils::prepare_file_creation( m_cmd_file ) );
-
-    if ( path.empty( ) )
-        return;
-
-    // Try to open the commandd file for writing
-
-    std::ofstream ofs( path.c_str( ), std::ofstream::out );
-
-    if ( ofs.bad( ) )
-        return;
-
-    // Write out all commands to the file
-
-    for ( std::vector< std::string >::const_iterator it = m_commands.begin( );
-          it != m_commands.end( ); ++it )
-        ofs << *it << std::endl;
-}
-
-
 /******************************************                                     
  * Recreates a pseudoterminal and set it up and spawns the shell with all
  * standard file descriptors redirected to the slave part of the pseudo-
@@ -334,6 +374,11 @@ Term::start_shell( std::string const & shell )
     if ( m_write_fd == -2 )
         return start_piped_shell( shell );
 
+    // Set the window size before the shell starts, so it's known right
+    // from the start
+
+    set_window_size( );
+
     // Now that we have the master and the slave name (or a set of pipes)
     // we can start the child process
 
@@ -505,6 +550,11 @@ Term::setup_child( std::string const & slave_name,
     for ( int i = STDERR_FILENO + 1; i < getdtablesize( ); i++ )
         close( i );
 
+    // Tell programs what escape sequences they may use - the display
+    // understands what's needed for a VT100
+
+    setenv( "TERM", "vt100", 1 );
+
     // Finally replace the process by the shell
 
     execlp( shell.c_str( ), shell.c_str( ), "-i", ( char * ) 0 );
@@ -614,9 +664,12 @@ Term::start_piped_shell( std::string const & shell )
 ssize_t
 Term::get_shell_output( std::string & reply )
 {
+    Alloc_Profile::Scope scope( Alloc_Profile::Shell_Output );
+
     static int const buffer_len = 1024;
     ssize_t cnt = 0,
             retval;
+    int reads = 0;
 
     // Keep reading until we get less than a full buffers worth of data
 
@@ -626,6 +679,7 @@ Term::get_shell_output( std::string & reply )
 
         errno = 0;
         retval = read( m_read_fd, tmp_buffer, buffer_len );
+        reads++;
 
         // Since the PTY is in non-blocking mode failure with EAGAIN is ok,
         // it just means that no data are available at the moment while a
@@ -633,17 +687,47 @@ Term::get_shell_output( std::string & reply )
         // that means its dead for all our purposes)
 
         if ( retval <= 0 )
+        {
+            s_reads_per_check.add( reads );
+            s_bytes_read.add( cnt );
             return errno == EAGAIN || errno == EWOULDBLOCK ? cnt : -1;
+        }
 
         tmp_buffer[ retval ] = '\0';
         reply += tmp_buffer;
         cnt   += retval;
     } while ( retval == buffer_len );
 
+    s_reads_per_check.add( reads );
+    s_bytes_read.add( cnt );
     return cnt;
 }
 
 
+/******************************************
+ * Returns the directory the shell is currently in (or an empty string if
+ * that can't be found out)
+ ******************************************/
+
+std::string
+Term::shell_directory( ) const
+{
+    if ( m_shell_pid <= 0 )
+        return "";
+
+    std::ostringstream link;
+    link << "/proc/" << m_shell_pid << "/cwd";
+
+    char dir[ PATH_MAX ];
+    ssize_t len = readlink( link.str( ).c_str( ), dir, sizeof dir );
+
+    if ( len <= 0 || len >= static_cast< ssize_t >( sizeof dir ) )
+        return "";
+
+    return std::string( dir, len );
+}
+
+
 /*
  * Local variables:
  * tab-width: 4
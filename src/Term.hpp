@@ -22,8 +22,13 @@
 #define TERM_HPP_
 
 
+#include "Capture.hpp"
+#include "Command_Journal.hpp"
+#include "Command_History.hpp"
+#include "Usage_Stats.hpp"
 #include <string>
 #include <vector>
+#include <sys/types.h>
 
 
 class Messenger;
@@ -59,7 +64,7 @@ class Term
     send_control( char crtl );
 
 
-    std::vector< std::string > const &
+    Command_History const &
     command_list( ) const;
 
 
@@ -67,6 +72,19 @@ class Term
     last_command( ) const;
 
 
+    void
+    suggest_commands( std::vector< std::string > & commands );
+
+
+    void
+    window_size_change( int rows,
+                        int columns );
+
+
+    void
+    set_check_interval( int interval )  { m_check_interval = interval; }
+
+
   private :
 
     static void
@@ -83,15 +101,7 @@ class Term
 
 
     void
-    read_cmd_file( );
-
-
-    void
-    save_command( std::string const & cmd );
-
-
-    void
-    write_cmd_file( );
+    set_window_size( );
 
 
     pid_t
@@ -115,6 +125,10 @@ class Term
     get_shell_output( std::string & reply );
 
 
+    std::string
+    shell_directory( ) const;
+
+
     // Messenger object we have to notify about new shell output
 
     Messenger & m_mess;
@@ -125,6 +139,11 @@ class Term
     int m_check_interval;
 
 
+    // Process ID of the shell
+
+    pid_t m_shell_pid;
+
+
     // File descriptors for reading and writing to the child running the shell.
     // If a pseudoterminal can be used they are the same.
 
@@ -132,9 +151,15 @@ class Term
         m_read_fd;
 
 
+    // Number of rows and columns that fit onto the screen
+
+    int m_rows,
+        m_columns;
+
+
     // List of all commands already send to the shell
 
-    std::vector< std::string > m_commands;
+    Command_History m_commands;
 
 
     // Object for logging
@@ -142,14 +167,27 @@ class Term
     Logger & m_logger;
 
 
-    // Maximum number of commands in history
+    // File the history gets read from and each command appended to
+
+    Command_Journal m_journal;
+
+
+    // Statistics about the use of commands, the number of commands to
+    // suggest and how many commands have been sent in this session
+
+    Usage_Stats m_usage;
+
+
+    std::size_t m_num_suggestions;
+
 
-    std::size_t m_max_history;
+    int m_session_commands;
 
 
-    // Name of file to read histiry from and write it to
+    // For capturing the chunks of output read from the shell (if the
+    // user asked for it)
 
-    std::string m_cmd_file;
+    Capture m_capture;
 
 
     // Callback handling terminal
@@ -0,0 +1,57 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "Text_Measure.hpp"
+#include <algorithm>
+
+
+/******************************************
+ * Sums up the widths of the characters of (a part of) a text. Returns -1
+ * if the text contains a character for which the width isn't known.
+ ******************************************/
+
+int
+Char_Width_Measure::width( std::string const & txt,
+                           std::size_t         start,
+                           std::size_t         len ) const
+{
+    start = std::min( start, txt.size( ) );
+    std::size_t end = len < txt.size( ) - start ? start + len : txt.size( );
+    int w = 0;
+
+    for ( std::size_t i = start; i < end; ++i )
+    {
+        unsigned char c = txt[ i ];
+
+        if ( c >= m_widths.size( ) || m_widths[ c ] < 0 )
+            return -1;
+        w += m_widths[ c ];
+    }
+
+    return w;
+}
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
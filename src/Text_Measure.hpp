@@ -0,0 +1,89 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#if ! defined TEXT_MEASURE_HPP_
+#define TEXT_MEASURE_HPP_
+
+
+#include <string>
+#include <vector>
+
+
+/******************************************
+ * Interface for objects that can tell how wide a text is on the screen
+ ******************************************/
+
+class Text_Measure
+{
+  public :
+
+    virtual
+    ~Text_Measure( )
+    { }
+
+
+    // Returns the width of the part of the text starting at 'start' with
+    // a length of 'len' or -1 if the width can't be determined
+
+    virtual int
+    width( std::string const & txt,
+           std::size_t         start,
+           std::size_t         len ) const = 0;
+};
+
+
+/******************************************
+ * Class for measuring texts using nothing but a table of character
+ * widths. Since it never calls into libinkview it can also be used
+ * from threads other than the main thread.
+ ******************************************/
+
+class Char_Width_Measure : public Text_Measure
+{
+  public :
+
+    Char_Width_Measure( std::vector< int > const & widths )
+        : m_widths( widths )
+    { }
+
+
+    int
+    width( std::string const & txt,
+           std::size_t         start,
+           std::size_t         len ) const;
+
+
+  private :
+
+    // Widths of characters, negative for those with unknown width
+
+    std::vector< int > const & m_widths;
+};
+
+
+#endif
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,432 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "Usage_Stats.hpp"
+#include "Defaults.hpp"
+#include "Utils.hpp"
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+
+namespace
+{
+
+// How much the score for the directory the shell is in and for uses
+// early in a session count compared to the overall score
+
+double const Dir_Weight   = 2;
+double const Early_Weight = 1;
+
+
+// Scores below this get dropped when saving, as do directories beyond
+// the maximum number per command (the ones with the lowest scores)
+
+double const Min_Score = 0.01;
+
+std::size_t const Max_Dirs = 4;
+
+
+/******************************************
+ * Compares (score, command) pairs, higher scores first
+ ******************************************/
+
+bool
+higher( std::pair< double, std::string const * > const & a,
+        std::pair< double, std::string const * > const & b )
+{
+    return a.first > b.first;
+}
+
+}
+
+
+/******************************************
+ ******************************************/
+
+Usage_Stats::Usage_Stats( std::string const & file_name,
+                          std::size_t         max_commands )
+    : m_file_name( file_name )
+    , m_max_commands( max_commands )
+    , m_unsaved( 0 )
+    , m_is_loaded( false )
+    , m_has_thread( false )
+    , m_is_saving( false )
+{
+    pthread_mutex_init( &m_mutex, 0 );
+}
+
+
+/******************************************
+ * Uses recorded while the file was still being written get saved after
+ * the thread is done
+ ******************************************/
+
+Usage_Stats::~Usage_Stats( )
+{
+    if ( m_has_thread )
+    {
+        pthread_join( m_thread, 0 );
+        m_has_thread = false;
+    }
+
+    if ( m_is_loaded && m_unsaved )
+        save( );
+
+    if ( m_has_thread )
+        pthread_join( m_thread, 0 );
+
+    pthread_mutex_destroy( &m_mutex );
+}
+
+
+/******************************************
+ * Reads in the file with the statistics (a missing file just means
+ * there are none yet). The file starts with the time it was written
+ * at, followed by a line per command ("c <score> <early score>", a tab
+ * and the command) and a line per directory it was used in ("d <score>",
+ * a tab and the directory).
+ ******************************************/
+
+void
+Usage_Stats::load( )
+{
+    m_is_loaded = true;
+    m_usages.clear( );
+
+    if ( ! m_max_commands )
+        return;
+
+    std::ifstream ifs( m_file_name.c_str( ), std::ifstream::in );
+    std::string line;
+    std::time_t time = std::time( 0 );
+    Command_Usage * cur = 0;
+
+    while ( std::getline( ifs, line ) )
+    {
+        std::size_t tab = line.find( '\t' );
+        std::istringstream is( line.substr( 0, tab ) );
+        char type = 0;
+        double score = 0,
+               early = 0;
+
+        is >> type;
+
+        if ( type == 't' )
+            is >> time;
+        else if ( type == 'c' && tab != std::string::npos )
+        {
+            is >> score >> early;
+            if ( ! is )
+                continue;
+
+            cur = &m_usages[ line.substr( tab + 1 ) ];
+            cur->total.score = score;
+            cur->total.time  = time;
+            cur->early.score = early;
+            cur->early.time  = time;
+        }
+        else if ( type == 'd' && tab != std::string::npos && cur )
+        {
+            if ( ! ( is >> score ) )
+                continue;
+
+            Usage & u = cur->dirs[ line.substr( tab + 1 ) ];
+            u.score = score;
+            u.time  = time;
+        }
+    }
+}
+
+
+/******************************************
+ * Puts together what's to be written to the file and starts the thread
+ * writing it (or writes it directly if the thread can't be started).
+ * While the file is still being written nothing happens, the uses not
+ * yet saved then get saved with the next one recorded.
+ ******************************************/
+
+void
+Usage_Stats::save( )
+{
+    pthread_mutex_lock( &m_mutex );
+    bool is_saving = m_is_saving;
+    pthread_mutex_unlock( &m_mutex );
+
+    if ( is_saving )
+        return;
+
+    if ( m_has_thread )
+    {
+        pthread_join( m_thread, 0 );
+        m_has_thread = false;
+    }
+
+    m_unsaved = 0;
+
+    std::time_t now = std::time( 0 );
+    prune( now );
+
+    std::ostringstream os;
+
+    os.precision( 4 );
+    os << "# " APP_NAME " command usage\nt " << now << '\n';
+
+    for ( Usages::const_iterator it = m_usages.begin( );
+          it != m_usages.end( ); ++it )
+    {
+        os << "c " << it->second.total.value( now ) << ' '
+           << it->second.early.value( now ) << '\t' << it->first << '\n';
+
+        for ( std::map< std::string, Usage >::const_iterator
+                                             d = it->second.dirs.begin( );
+              d != it->second.dirs.end( ); ++d )
+            os << "d " << d->second.value( now ) << '\t' << d->first << '\n';
+    }
+
+    m_snapshot = os.str( );
+    m_is_saving = true;
+
+    if ( pthread_create( &m_thread, 0, thread_func, this ) == 0 )
+        m_has_thread = true;
+    else
+        write( );
+}
+
+
+/******************************************
+ * Function the thread gets started with, just redirects to write()
+ ******************************************/
+
+void *
+Usage_Stats::thread_func( void * arg )
+{
+    static_cast< Usage_Stats * >( arg )->write( );
+    return 0;
+}
+
+
+/******************************************
+ * Writes out the statistics, to a temporary file that then replaces
+ * the old one
+ ******************************************/
+
+void
+Usage_Stats::write( )
+{
+    std::string path( Utils::prepare_file_creation( m_file_name ) );
+
+    if ( ! path.empty( ) )
+    {
+        std::string tmp_name( path + ".tmp" );
+        std::ofstream ofs( tmp_name.c_str( ), std::ofstream::out );
+
+        ofs << m_snapshot;
+        ofs.close( );
+
+        if ( ofs.fail( ) || std::rename( tmp_name.c_str( ), path.c_str( ) ) )
+            std::remove( tmp_name.c_str( ) );
+    }
+
+    m_snapshot.clear( );
+
+    pthread_mutex_lock( &m_mutex );
+    m_is_saving = false;
+    pthread_mutex_unlock( &m_mutex );
+}
+
+
+/******************************************
+ * Counts a use of a command. If it has been used in too many directories
+ * the one with the lowest score gets dropped.
+ ******************************************/
+
+void
+Usage_Stats::record( std::string const & cmd,
+                     std::string const & dir,
+                     bool                is_early )
+{
+    if ( ! m_max_commands )
+        return;
+
+    std::time_t now = std::time( 0 );
+    Command_Usage & u = m_usages[ cmd ];
+
+    u.total.add( now );
+    if ( is_early )
+        u.early.add( now );
+
+    if ( ! dir.empty( ) )
+    {
+        u.dirs[ dir ].add( now );
+
+        if ( u.dirs.size( ) > Max_Dirs )
+        {
+            std::map< std::string, Usage >::iterator lowest = u.dirs.begin( );
+
+            for ( std::map< std::string, Usage >::iterator it = lowest;
+                  it != u.dirs.end( ); ++it )
+                if ( it->second.value( now ) < lowest->second.value( now ) )
+                    lowest = it;
+
+            u.dirs.erase( lowest );
+        }
+    }
+
+    if ( m_is_loaded && ++m_unsaved >= USAGE_SAVE_INTERVAL )
+        save( );
+}
+
+
+/******************************************
+ ******************************************/
+
+double
+Usage_Stats::score( std::string const & cmd ) const
+{
+    Usages::const_iterator it = m_usages.find( cmd );
+
+    return it != m_usages.end( ) ? it->second.total.value( std::time( 0 ) )
+                                 : 0;
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+Usage_Stats::suggest( std::string const          & dir,
+                      bool                         is_early,
+                      std::size_t                  max_results,
+                      std::vector< std::string > & results ) const
+{
+    results.clear( );
+
+    std::time_t now = std::time( 0 );
+    std::vector< std::pair< double, std::string const * > > scores;
+
+    for ( Usages::const_iterator it = m_usages.begin( );
+          it != m_usages.end( ); ++it )
+    {
+        double score = it->second.total.value( now );
+
+        std::map< std::string, Usage >::const_iterator d =
+                                                   it->second.dirs.find( dir );
+        if ( d != it->second.dirs.end( ) )
+            score += Dir_Weight * d->second.value( now );
+
+        if ( is_early )
+            score += Early_Weight * it->second.early.value( now );
+
+        scores.push_back( std::make_pair( score, &it->first ) );
+    }
+
+    std::size_t cnt = std::min( max_results, scores.size( ) );
+    std::partial_sort( scores.begin( ), scores.begin( ) + cnt, scores.end( ),
+                       higher );
+
+    for ( std::size_t i = 0; i < cnt; ++i )
+        results.push_back( *scores[ i ].second );
+}
+
+
+/******************************************
+ * Drops commands and directories with negligible scores and, if there are
+ * still too many commands, the ones with the lowest scores
+ ******************************************/
+
+void
+Usage_Stats::prune( std::time_t now )
+{
+    std::vector< std::pair< double, std::string const * > > scores;
+
+    for ( Usages::iterator it = m_usages.begin( ); it != m_usages.end( ); )
+    {
+        double score = it->second.total.value( now );
+
+        if ( score < Min_Score )
+        {
+            m_usages.erase( it++ );
+            continue;
+        }
+
+        std::map< std::string, Usage > & dirs = it->second.dirs;
+        for ( std::map< std::string, Usage >::iterator d = dirs.begin( );
+              d != dirs.end( ); )
+            if ( d->second.value( now ) < Min_Score )
+                dirs.erase( d++ );
+            else
+                ++d;
+
+        scores.push_back( std::make_pair( score, &it->first ) );
+        ++it;
+    }
+
+    if ( scores.size( ) <= m_max_commands )
+        return;
+
+    std::nth_element( scores.begin( ), scores.begin( ) + m_max_commands,
+                      scores.end( ), higher );
+
+    std::vector< std::string > dropped;
+    for ( std::size_t i = m_max_commands; i < scores.size( ); ++i )
+        dropped.push_back( *scores[ i ].second );
+
+    for ( std::size_t i = 0; i < dropped.size( ); ++i )
+        m_usages.erase( dropped[ i ] );
+}
+
+
+/******************************************
+ * Returns the score, reduced by the time passed since it was set
+ ******************************************/
+
+double
+Usage_Stats::Usage::value( std::time_t now ) const
+{
+    if ( score == 0 || now <= time )
+        return score;
+
+    return score * std::pow( 2.0, - static_cast< double >( now - time )
+                                  / USAGE_HALF_LIFE );
+}
+
+
+/******************************************
+ * Adds a use at the given time
+ ******************************************/
+
+void
+Usage_Stats::Usage::add( std::time_t now )
+{
+    score = value( now ) + 1;
+    time  = now;
+}
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
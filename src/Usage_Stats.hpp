@@ -0,0 +1,203 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#if ! defined USAGE_STATS_HPP_
+#define USAGE_STATS_HPP_
+
+
+#include <string>
+#include <vector>
+#include <map>
+#include <ctime>
+#include <tr1/unordered_map>
+#include <pthread.h>
+
+
+/******************************************
+ * Class for keeping statistics about how often commands get used, for
+ * suggesting the ones most likely to be needed next. Each use of a
+ * command adds one to its score, and the score halves with every
+ * USAGE_HALF_LIFE seconds that pass, so commands used often and recently
+ * score highest. Scores are also kept per directory the shell was in
+ * and for uses in the first few commands of a session, which get added
+ * when the shell is in that directory or a session has just started.
+ *
+ * The statistics are stored in a file of their own, with all scores
+ * given for the time the file was written. Commands whose score has
+ * dropped to nearly nothing (or that don't fit into the limit on the
+ * number of commands) are left out. Since there may be lots of commands
+ * the file gets written by a thread of its own.
+ ******************************************/
+
+class Usage_Stats
+{
+  public :
+
+    Usage_Stats( std::string const & file_name,
+                 std::size_t         max_commands );
+
+
+    // Waits for the file to be written (if that's just being done) and
+    // saves the statistics (if they were ever loaded)
+
+    ~Usage_Stats( );
+
+
+    void
+    load( );
+
+
+    // Starts writing the statistics to the file (unless that's already
+    // under way)
+
+    void
+    save( );
+
+
+    // Counts a use of a command with the shell in the given directory,
+    // possibly early in the session
+
+    void
+    record( std::string const & cmd,
+            std::string const & dir,
+            bool                is_early );
+
+
+    // Returns the overall score of a command (0 if it's unknown)
+
+    double
+    score( std::string const & cmd ) const;
+
+
+    // Returns the (at most 'max_results') commands with the highest scores
+    // for the directory and the time in the session, highest first
+
+    void
+    suggest( std::string const          & dir,
+             bool                         is_early,
+             std::size_t                  max_results,
+             std::vector< std::string > & results ) const;
+
+
+  private :
+
+    // Copying isn't allowed
+
+    Usage_Stats( Usage_Stats const & );
+
+
+    Usage_Stats &
+    operator = ( Usage_Stats const & );
+
+
+    // Score at a certain time
+
+    struct Usage
+    {
+        Usage( )
+            : score( 0 )
+            , time( 0 )
+        { }
+
+        double
+        value( std::time_t now ) const;
+
+        void
+        add( std::time_t now );
+
+        double score;
+        std::time_t time;
+    };
+
+
+    struct Command_Usage
+    {
+        Usage total;
+        Usage early;
+        std::map< std::string, Usage > dirs;
+    };
+
+
+    typedef std::tr1::unordered_map< std::string, Command_Usage > Usages;
+
+
+    void
+    prune( std::time_t now );
+
+
+    static void *
+    thread_func( void * arg );
+
+
+    void
+    write( );
+
+
+    // Name of the file and the maximum number of commands kept
+
+    std::string m_file_name;
+
+
+    std::size_t m_max_commands;
+
+
+    Usages m_usages;
+
+
+    // Number of uses recorded since the last save
+
+    int m_unsaved;
+
+
+    // Flag, set once the file has been read in (or tried to)
+
+    bool m_is_loaded;
+
+
+    // Thread writing the file (if there's one) and what it writes
+
+    pthread_t m_thread;
+
+
+    bool m_has_thread;
+
+
+    std::string m_snapshot;
+
+
+    // Mutex protecting the flag that's set while the file gets written
+
+    pthread_mutex_t m_mutex;
+
+
+    bool m_is_saving;
+};
+
+
+#endif
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -19,12 +19,15 @@
 
 
 #include "Utils.hpp"
+#include "Alloc_Profile.hpp"
 #include <limits>
 #include <cerrno>
 #include <cstdlib>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <sys/time.h>
+#include <time.h>
 
 
 namespace Utils {
@@ -153,6 +156,8 @@ std::vector< std::string >
 split_string( std::string const & str,
               std::string const & delimiters )
 {
+    Alloc_Profile::Scope scope( Alloc_Profile::Split_String );
+
     std::vector< std::string > comp;
     std::size_t start = 0;
     std::size_t pos;
@@ -164,8 +169,7 @@ split_string( std::string const & str,
         start = pos + 1;
     }
 
-
-    if ( start <= str.size( ) - 1 )
+    if ( start < str.size( ) )
         comp.push_back( str.substr( start ) );
 
     return comp;
@@ -276,6 +280,34 @@ prepare_file_creation( std::string const & name )
 }
 
 
+/******************************************
+ * Returns the current time in microseconds
+ ******************************************/
+
+unsigned long long
+microseconds( )
+{
+    struct timeval tv;
+
+    gettimeofday( &tv, 0 );
+    return tv.tv_sec * 1000000ULL + tv.tv_usec;
+}
+
+
+/******************************************
+ * Returns the time of the monotonic clock in microseconds
+ ******************************************/
+
+unsigned long long
+monotonic_microseconds( )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+
 } // namespace Utils
 
 /*
@@ -86,6 +86,21 @@ split_string( std::string const & str,
 std::string
 prepare_file_creation( std::string const & name );
 
+
+// Returns the current time in microseconds (only good for measuring
+// time differences)
+
+unsigned long long
+microseconds( );
+
+
+// Returns the time in microseconds from a clock that never jumps (e.g.
+// when the system time gets set), for time stamps of events that get
+// compared or replayed later on
+
+unsigned long long
+monotonic_microseconds( );
+
 }
 
 
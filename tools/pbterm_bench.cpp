@@ -0,0 +1,563 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/******************************************
+ * Throughput benchmark for the way from the shell to the screen. It runs
+ * the real Messenger (and thus Term, Lines and Display) on top of the
+ * headless libinkview backend, makes the shell output synthetic data and
+ * measures how long it takes until the end of it has been drawn.
+ *
+ * Usage: pbterm_bench [--quick] [--check-redraw] [workload ...]
+ *
+ * Without workload names all of them are run, '--quick' makes them ten
+ * times smaller. The backend's virtual clock is used, so the timer that
+ * has Term look for output from the shell expires as soon as the event
+ * loop is idle and the numbers aren't limited by the 'check_interval'.
+ *
+ * With '--check-redraw' (and no workloads) it instead fills the screen
+ * and then checks that redrawing it doesn't allocate any memory, failing
+ * if it does. When built with ALLOC_PROFILE the allocations are also
+ * shown per subsystem.
+ ******************************************/
+
+
+#include "Messenger.hpp"
+#include "Headless.hpp"
+#include "Utils.hpp"
+#include "Alloc_Profile.hpp"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <new>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+
+namespace
+{
+
+// Counters for calls of operator new (unless the allocation profiler
+// does the counting)
+
+#if ! defined ALLOC_PROFILE
+unsigned long s_allocs;
+unsigned long long s_alloc_bytes;
+#endif
+
+
+// Number of redraws done when checking for allocations
+
+int const Redraw_Count = 100;
+
+
+// Number of commands run, used to make the marker the shell outputs at
+// the end of each one unique
+
+int s_commands;
+
+
+// Give up on a workload after that many seconds
+
+unsigned long long const Timeout = 1200;
+
+
+// Description of a workload: either a file that gets cat'ed or (if
+// 'file_size' is 0) a shell command that produces the output itself
+
+struct Workload
+{
+    char const * name;
+    char const * description;
+    unsigned long long file_size;
+    void ( * generate )( std::FILE * fp, unsigned long long size );
+};
+
+
+// The one Messenger instance
+
+Messenger * s_mess;
+
+
+/******************************************
+ * Writes lines of 79 printable characters
+ ******************************************/
+
+void
+gen_bulk( std::FILE         * fp,
+          unsigned long long  size )
+{
+    char line[ 81 ];
+    unsigned int seed = 1;
+
+    for ( unsigned long long n = 0; n < size; n += 80 )
+    {
+        for ( int i = 0; i < 79; ++i )
+        {
+            seed = seed * 1103515245 + 12345;
+            line[ i ] = ' ' + ( seed >> 16 ) % 95;
+        }
+        line[ 79 ] = '\n';
+        std::fwrite( line, 1, 80, fp );
+    }
+}
+
+
+/******************************************
+ * Writes lots of short lines
+ ******************************************/
+
+void
+gen_short( std::FILE         * fp,
+           unsigned long long  size )
+{
+    unsigned long long n = 0;
+
+    for ( unsigned long i = 0; n < size; ++i )
+        n += std::fprintf( fp, "%lu\n", i % 100000 );
+}
+
+
+/******************************************
+ * Writes lines of 20000 characters that have to be wrapped many times
+ ******************************************/
+
+void
+gen_long( std::FILE         * fp,
+          unsigned long long  size )
+{
+    std::string line;
+
+    for ( int i = 0; i < 20000; ++i )
+        line += i % 7 ? static_cast< char >( 'a' + i % 26 ) : ' ';
+    line += '\n';
+
+    for ( unsigned long long n = 0; n < size; n += line.size( ) )
+        std::fwrite( line.data( ), 1, line.size( ), fp );
+}
+
+
+/******************************************
+ * Writes lines with lots of tabs in them, like tables
+ ******************************************/
+
+void
+gen_tabs( std::FILE         * fp,
+          unsigned long long  size )
+{
+    unsigned long long n = 0;
+
+    for ( unsigned long i = 0; n < size; ++i )
+        n += std::fprintf( fp, "%lu\t%lu\tx\t\tyy\t%lu\tzzz\t\t%lu\n",
+                           i, i * 7, i % 13, i % 100003 );
+}
+
+
+Workload const s_workloads[ ] =
+{
+    { "bulk10",  "cat of 10 MB of 80 character lines",
+      10000000ULL, gen_bulk },
+    { "bulk100", "cat of 100 MB of 80 character lines",
+      100000000ULL, gen_bulk },
+    { "short",   "cat of 10 MB of very short lines",
+      10000000ULL, gen_short },
+    { "long",    "cat of 10 MB of 20000 character lines",
+      10000000ULL, gen_long },
+    { "tabs",    "cat of 10 MB of lines with many tabs",
+      10000000ULL, gen_tabs },
+    { "trickle", "100000 words printed one by one without a newline",
+      0, 0 }
+};
+
+
+/******************************************
+ * Handler for libinkview events, like the one of pbterm itself
+ ******************************************/
+
+int
+bench_handler( int type,
+               int par1,
+               int par2 )
+{
+    switch ( type )
+    {
+        case EVT_INIT :
+            s_mess = new Messenger( );
+            return 1;
+
+        case EVT_EXIT :
+            delete s_mess;
+            s_mess = 0;
+            return 1;
+
+        default :
+            request::Handle_Event he( type, par1, par2 );
+            return s_mess->send( he ).result;
+    }
+
+    return 0;
+}
+
+
+/******************************************
+ * Returns the number of allocations made so far
+ ******************************************/
+
+unsigned long
+allocations( )
+{
+#if defined ALLOC_PROFILE
+    return Alloc_Profile::total_allocations( );
+#else
+    return s_allocs;
+#endif
+}
+
+
+/******************************************
+ * Returns the number of bytes allocated so far
+ ******************************************/
+
+unsigned long long
+allocated_bytes( )
+{
+#if defined ALLOC_PROFILE
+    return Alloc_Profile::total_bytes( );
+#else
+    return s_alloc_bytes;
+#endif
+}
+
+
+/******************************************
+ * Returns the peak resident set size in kB
+ ******************************************/
+
+long
+peak_rss( )
+{
+    struct rusage ru;
+    return getrusage( RUSAGE_SELF, &ru ) ? 0 : ru.ru_maxrss;
+}
+
+
+/******************************************
+ * Has the shell run a command and then print the marker, keeps the
+ * event loop going until the marker was drawn. Returns false if the
+ * application stopped or it took too long.
+ ******************************************/
+
+bool
+run_command( std::string const & cmd )
+{
+    // The marker is split in the command so that its echo doesn't match
+
+    char marker[ 50 ];
+    char done[ 50 ];
+
+    std::sprintf( marker, "__BENCH_DONE_%d__", ++s_commands );
+    std::sprintf( done, "echo __BENCH\"\"_DONE_%d__\n", s_commands );
+
+    Headless::watch_text( marker );
+    s_mess->send( message::New_Command( cmd + "; " + done ) );
+
+    unsigned long long start = Utils::microseconds( );
+
+    while ( ! Headless::watched_text_drawn( ) )
+        if (    ! Headless::process( 10 )
+             || Utils::microseconds( ) - start > Timeout * 1000000ULL )
+            return false;
+
+    Headless::watch_text( "" );
+    return true;
+}
+
+
+/******************************************
+ * Creates the data for a workload, runs it and prints the results
+ ******************************************/
+
+bool
+run_workload( Workload const    & w,
+              std::string const & dir,
+              int                 divisor )
+{
+    std::string cmd;
+    unsigned long long bytes = 0,
+                       lines = 0;
+
+    if ( w.file_size )
+    {
+        std::string name = dir + "/" + w.name;
+        std::FILE * fp = std::fopen( name.c_str( ), "w" );
+        if ( ! fp )
+        {
+            std::perror( name.c_str( ) );
+            return false;
+        }
+
+        w.generate( fp, w.file_size / divisor );
+        std::fclose( fp );
+
+        // Count what was really written
+
+        fp = std::fopen( name.c_str( ), "r" );
+        int c;
+        while ( fp && ( c = std::getc( fp ) ) != EOF )
+        {
+            bytes++;
+            lines += c == '\n';
+        }
+        if ( fp )
+            std::fclose( fp );
+
+        cmd = "cat " + name;
+    }
+    else
+    {
+        unsigned long count = 100000 / divisor;
+        char buf[ 200 ];
+
+        std::sprintf( buf, "i=0; while [ $i -lt %lu ]; do printf 'word%%d ' "
+                      "$i; i=$((i+1)); done; echo", count );
+        cmd = buf;
+
+        for ( unsigned long i = 0; i < count; ++i )
+            bytes += std::sprintf( buf, "word%lu ", i );
+        bytes++;
+        lines = 1;
+    }
+
+    Headless::reset_stats( );
+    unsigned long allocs = allocations( );
+    unsigned long long alloc_bytes = allocated_bytes( );
+    unsigned long long start = Utils::microseconds( );
+
+    bool ok = run_command( cmd );
+
+    double secs = ( Utils::microseconds( ) - start ) / 1.0e6;
+    allocs = allocations( ) - allocs;
+    alloc_bytes = allocated_bytes( ) - alloc_bytes;
+
+    if ( ! ok )
+    {
+        std::printf( "%-8s  failed (application stopped or timeout)\n",
+                     w.name );
+        return false;
+    }
+
+    Headless::Stats const & st = Headless::stats( );
+
+    std::printf( "%-8s  %9.2f MB/s %11.0f lines/s %8.3f s %10lu allocs "
+                 "%8.1f MB alloc'ed %7ld kB peak RSS %8lu draws "
+                 "%6lu updates\n",
+                 w.name, secs > 0 ? bytes / secs / 1.0e6 : 0.0,
+                 secs > 0 ? lines / secs : 0.0, secs, allocs,
+                 alloc_bytes / 1.0e6, peak_rss( ), st.draw_string,
+                 st.full_updates + st.soft_updates + st.partial_updates
+                 + st.dynamic_updates );
+    std::fflush( stdout );
+
+    return true;
+}
+
+
+/******************************************
+ * Fills the screen with lines, some of them wrapped and with tabs, and
+ * then redraws it a number of times. After the first redraw everything
+ * needed should be set up, so the further ones must not allocate any
+ * memory. Returns false if they do.
+ ******************************************/
+
+bool
+check_redraw( )
+{
+    if ( ! run_command( "i=0; while [ $i -lt 100 ]; do printf "
+                        "'%d\\tline with a tab\\n' $i; printf '%0300d\\n' "
+                        "$i; i=$((i+1)); done" ) )
+    {
+        std::printf( "redraw    failed (application stopped or timeout)\n" );
+        return false;
+    }
+
+    request::Handle_Event he( EVT_SHOW, 0, 0 );
+    s_mess->send( he );
+
+    unsigned long allocs = allocations( );
+    unsigned long long alloc_bytes = allocated_bytes( );
+    Alloc_Profile::Baseline alloc_baseline;
+
+    if ( Alloc_Profile::is_enabled( ) )
+        Alloc_Profile::write( std::cout, alloc_baseline );
+
+    unsigned long long start = Utils::microseconds( );
+
+    for ( int i = 0; i < Redraw_Count; ++i )
+        s_mess->send( he );
+
+    double secs = ( Utils::microseconds( ) - start ) / 1.0e6;
+
+    if ( Alloc_Profile::is_enabled( ) )
+        Alloc_Profile::write( std::cout, alloc_baseline );
+
+    allocs = allocations( ) - allocs;
+    alloc_bytes = allocated_bytes( ) - alloc_bytes;
+
+    std::printf( "redraw    %d redraws in %.3f s, %lu allocs, %llu bytes "
+                 "alloc'ed: %s\n", Redraw_Count, secs, allocs, alloc_bytes,
+                 allocs ? "FAILED" : "ok" );
+    std::fflush( stdout );
+
+    return ! allocs;
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+usage( char const * name )
+{
+    std::fprintf( stderr, "Usage: %s [--quick] [--check-redraw] "
+                  "[workload ...]\n\nWorkloads:\n", name );
+    for ( std::size_t i = 0;
+          i < sizeof s_workloads / sizeof *s_workloads; ++i )
+        std::fprintf( stderr, "  %-8s  %s\n", s_workloads[ i ].name,
+                      s_workloads[ i ].description );
+}
+
+}   // unnamed namespace
+
+
+#if ! defined ALLOC_PROFILE
+
+/******************************************
+ * Counting replacements for the global operator new and delete (the
+ * array versions of the standard library call these)
+ ******************************************/
+
+void *
+operator new( std::size_t size ) throw( std::bad_alloc )
+{
+    __sync_fetch_and_add( &s_allocs, 1 );
+    __sync_fetch_and_add( &s_alloc_bytes, size );
+
+    void * p = std::malloc( size ? size : 1 );
+    if ( ! p )
+        throw std::bad_alloc( );
+    return p;
+}
+
+
+void
+operator delete( void * p ) throw( )
+{
+    std::free( p );
+}
+
+#endif
+
+
+/******************************************
+ ******************************************/
+
+int
+main( int     argc,
+      char ** argv )
+{
+    int divisor = 1;
+    bool is_redraw_check = false;
+    std::vector< Workload const * > selected;
+
+    for ( int i = 1; i < argc; ++i )
+    {
+        if ( ! std::strcmp( argv[ i ], "--quick" ) )
+        {
+            divisor = 10;
+            continue;
+        }
+
+        if ( ! std::strcmp( argv[ i ], "--check-redraw" ) )
+        {
+            is_redraw_check = true;
+            continue;
+        }
+
+        Workload const * w = 0;
+        for ( std::size_t j = 0;
+              j < sizeof s_workloads / sizeof *s_workloads; ++j )
+            if ( ! std::strcmp( argv[ i ], s_workloads[ j ].name ) )
+                w = s_workloads + j;
+
+        if ( ! w )
+        {
+            usage( argv[ 0 ] );
+            return EXIT_FAILURE;
+        }
+
+        selected.push_back( w );
+    }
+
+    if ( selected.empty( ) && ! is_redraw_check )
+        for ( std::size_t j = 0;
+              j < sizeof s_workloads / sizeof *s_workloads; ++j )
+            selected.push_back( s_workloads + j );
+
+    char dir[ ] = "/tmp/pbterm_bench.XXXXXX";
+    if ( ! mkdtemp( dir ) )
+    {
+        std::perror( "mkdtemp" );
+        return EXIT_FAILURE;
+    }
+
+    setenv( "PBTERM_HEADLESS_CLOCK", "virtual", 1 );
+    Headless::start( bench_handler );
+
+    // Wait for the shell to be up and running
+
+    bool ok = s_mess && run_command( "true" );
+
+    if ( ok && is_redraw_check )
+        ok = check_redraw( );
+
+    for ( std::size_t i = 0; ok && i < selected.size( ); ++i )
+    {
+        ok = run_workload( *selected[ i ], dir, divisor );
+        if ( selected[ i ]->file_size )
+            unlink( ( std::string( dir ) + "/"
+                      + selected[ i ]->name ).c_str( ) );
+    }
+
+    if ( s_mess )
+        Headless::finish( );
+    rmdir( dir );
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
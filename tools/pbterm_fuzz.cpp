@@ -0,0 +1,592 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/******************************************
+ * Fuzz and stress tests for the way output of the shell takes until it
+ * ends up in the lines: the Ansi_Parser (escape sequences and UTF-8) and
+ * Lines::add(). Each input is checked in two ways:
+ *
+ *  - it's fed to the parser in one piece and in chunks of random sizes,
+ *    what the parser reports must be the same in both cases (with runs
+ *    of text merged) and text must never contain control characters
+ *  - it's added to Lines in chunks of random sizes (with random limits
+ *    for lines, memory and line length), with the font size changed and
+ *    the lines scrolled now and then, and after each step Lines::check()
+ *    must find the bookkeeping to be consistent
+ *
+ * Usage: pbterm_fuzz file ...
+ *        pbterm_fuzz --stress [seconds [seed]]
+ *
+ * With file names each file is used as an input (e.g. to reproduce a
+ * failure), with '--stress' random and pathological inputs (huge single
+ * lines, only tabs, only newlines, lots of escape sequences or UTF-8)
+ * are generated until the time (default is 10 s) is up. A failing input
+ * gets written to 'pbterm_fuzz.fail'.
+ *
+ * When built with LIBFUZZER defined (with clang, run cmake with
+ * '-DLIBFUZZER=ON') there's no main() but the entry point for libFuzzer.
+ ******************************************/
+
+
+#include "Lines.hpp"
+#include "Ansi_Parser.hpp"
+#include "Inkview.hpp"
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <algorithm>
+#include <unistd.h>
+
+
+namespace
+{
+
+// Simple (xorshift) random number generator, so that runs can be repeated
+// by using the same seed
+
+class Random
+{
+  public :
+
+    explicit
+    Random( unsigned long long seed )
+        : m_state( seed ? seed : 0x9e3779b97f4a7c15ULL )
+    { }
+
+
+    unsigned long long
+    next( )
+    {
+        m_state ^= m_state << 13;
+        m_state ^= m_state >> 7;
+        m_state ^= m_state << 17;
+        return m_state;
+    }
+
+
+    // Returns a number between 0 and n - 1
+
+    std::size_t
+    below( std::size_t n )
+    {
+        return n ? next( ) % n : 0;
+    }
+
+
+  private :
+
+    unsigned long long m_state;
+};
+
+
+/******************************************
+ * Sink for the parser that records everything in a string, with runs of
+ * text merged (the parser passes on text at the end of each chunk, so
+ * how text gets split depends on the chunks). Events other than text are
+ * introduced by a byte of 1, which can't appear within text.
+ ******************************************/
+
+class Recording_Sink : public Ansi_Sink
+{
+  public :
+
+    void
+    text( std::string const & txt )
+    {
+        for ( std::size_t i = 0; i < txt.size( ); ++i )
+            if (    static_cast< unsigned char >( txt[ i ] ) < 0x20
+                 || txt[ i ] == 0x7f )
+                error = "control character in text";
+
+        if ( txt.empty( ) )
+            error = "empty text";
+
+        log += txt;
+    }
+
+
+    void
+    control( char c )
+    {
+        log += '\1';
+        log += 'C';
+        log += c;
+    }
+
+
+    void
+    escape( char c )
+    {
+        log += '\1';
+        log += 'E';
+        log += c;
+    }
+
+
+    void
+    csi( char                       priv,
+         std::vector< int > const & params,
+         char                       final )
+    {
+        std::ostringstream os;
+
+        os << '\1' << 'S' << priv;
+        for ( std::size_t i = 0; i < params.size( ); ++i )
+            os << params[ i ] << ';';
+        os << final;
+        log += os.str( );
+    }
+
+
+    std::string log;
+    std::string error;
+};
+
+
+/******************************************
+ * Splits data into chunks of random sizes (sometimes tiny ones, so that
+ * sequences get split everywhere, sometimes large ones). Large inputs
+ * aren't cut into tiny pieces, appending to a huge line means wrapping
+ * it again each time, which would take forever.
+ ******************************************/
+
+std::vector< std::string >
+make_chunks( std::string const & data,
+             Random            & rnd )
+{
+    static std::size_t const Max_Sizes[ ] = { 2, 16, 1024, 65536 };
+    std::size_t max_size = Max_Sizes[ rnd.below( 4 ) ];
+
+    if ( data.size( ) > 100 * max_size )
+        max_size = std::max< std::size_t >( max_size, data.size( ) / 100 );
+    std::vector< std::string > chunks;
+
+    for ( std::size_t pos = 0; pos < data.size( ); )
+    {
+        std::size_t len = 1 + rnd.below( max_size );
+        chunks.push_back( data.substr( pos, len ) );
+        pos += len;
+    }
+
+    return chunks;
+}
+
+
+/******************************************
+ * Feeds the data to the parser in one piece and in chunks and compares
+ * the results
+ ******************************************/
+
+std::string
+check_parser( std::string const & data,
+              Random            & rnd )
+{
+    Ansi_Parser whole_parser;
+    Recording_Sink whole;
+
+    whole_parser.feed( data, whole );
+
+    Ansi_Parser chunk_parser;
+    Recording_Sink chunked;
+    std::vector< std::string > chunks = make_chunks( data, rnd );
+
+    for ( std::size_t i = 0; i < chunks.size( ); ++i )
+        chunk_parser.feed( chunks[ i ], chunked );
+
+    if ( ! whole.error.empty( ) )
+        return "parser: " + whole.error;
+    if ( ! chunked.error.empty( ) )
+        return "parser (chunked): " + chunked.error;
+    if ( whole.log != chunked.log )
+        return "parser: results differ when fed in chunks";
+    if ( whole_parser.is_idle( ) != chunk_parser.is_idle( ) )
+        return "parser: state differs when fed in chunks";
+
+    return "";
+}
+
+
+/******************************************
+ * Sets a font of the given size, needed by Lines for measuring text
+ ******************************************/
+
+void
+set_font( int size )
+{
+    static ifont * font;
+
+    if ( font )
+        CloseFont( font );
+    font = OpenFont( "fuzz", size, 1 );
+    SetFont( font, BLACK );
+}
+
+
+/******************************************
+ * Waits for the worker thread of the lines to finish recalculations
+ ******************************************/
+
+void
+wait_for_relayout( Lines & lines )
+{
+    while ( lines.collect_relayout_results( ) )
+        usleep( 100 );
+}
+
+
+/******************************************
+ * Adds the data in chunks to lines with random settings and checks
+ * them after each step
+ ******************************************/
+
+std::string
+check_lines( std::string const & data,
+             Random            & rnd )
+{
+    static std::size_t const Max_Lines[ ]   = { 20, 200, 100000 };
+    static std::size_t const Max_Bytes[ ]   = { 0, 4096, 1000000 };
+    static std::size_t const Max_Lengths[ ] = { 0, 1, 100, 5000 };
+
+    int font_size = 10 + rnd.below( 30 );
+    set_font( font_size );
+
+    Lines lines( font_size, rnd.below( 5 ), 1 + rnd.below( 8 ),
+                 rnd.below( 20 ), rnd.below( 20 ), Max_Lines[ rnd.below( 3 ) ],
+                 Max_Bytes[ rnd.below( 3 ) ], Max_Lengths[ rnd.below( 4 ) ] );
+
+    // Sometimes use a table of character widths, like with a real font
+
+    std::vector< int > widths( 128, ( font_size * 3 + 2 ) / 5 );
+    if ( rnd.below( 2 ) )
+        lines.set_char_widths( &widths );
+
+    std::vector< std::string > chunks = make_chunks( data, rnd );
+    std::string err;
+
+    for ( std::size_t i = 0; i < chunks.size( ) && err.empty( ); ++i )
+    {
+        lines.add( chunks[ i ] );
+
+        switch ( rnd.below( 20 ) )
+        {
+            case 0 :
+                font_size = 10 + rnd.below( 30 );
+                widths.assign( 128, ( font_size * 3 + 2 ) / 5 );
+                set_font( font_size );
+                lines.change_font_size( font_size );
+                if ( rnd.below( 2 ) )
+                    wait_for_relayout( lines );
+                break;
+
+            case 1 :
+                lines.shift( static_cast< int >( rnd.below( 2001 ) ) - 1000 );
+                break;
+
+            case 2 :
+                lines.prepare_visible( );
+                break;
+        }
+
+        err = lines.check( );
+    }
+
+    wait_for_relayout( lines );
+    if ( err.empty( ) )
+        err = lines.check( );
+
+    return err.empty( ) ? "" : "lines: " + err;
+}
+
+
+/******************************************
+ * Runs all checks on an input, returns what went wrong (if anything)
+ ******************************************/
+
+std::string
+check_input( std::string const & data,
+             unsigned long long  seed )
+{
+    Random rnd( seed );
+    std::string err = check_parser( data, rnd );
+
+    if ( err.empty( ) )
+        err = check_lines( data, rnd );
+    return err;
+}
+
+
+#if ! defined LIBFUZZER
+
+/******************************************
+ * Returns a random UTF-8 character (including some invalid sequences)
+ ******************************************/
+
+std::string
+random_utf8( Random & rnd )
+{
+    static char const * const Chars[ ] = { "a", "\xc3\xa4", "\xe2\x82\xac",
+                                           "\xf0\x9f\x98\x80", "\xc3",
+                                           "\xe2\x82", "\x80", "\xff" };
+    return Chars[ rnd.below( sizeof Chars / sizeof *Chars ) ];
+}
+
+
+/******************************************
+ * Returns a random escape sequence (including broken ones)
+ ******************************************/
+
+std::string
+random_escape( Random & rnd )
+{
+    static char const * const Seqs[ ] = { "\x1b[0m", "\x1b[1;31m", "\x1b[2J",
+                                          "\x1b[H", "\x1b[?1049h",
+                                          "\x1b[?1049l", "\x1b[10;20H",
+                                          "\x1b]0;title\x07", "\x1b]2;t\x1b\\",
+                                          "\x1b(B", "\x1b=", "\x1b[", "\x1b",
+                                          "\x1b[99999999;;;;;;;;;;;;;;;;;;m",
+                                          "\x1b[1\x1b[2m", "\x1b[5\n;3H" };
+    return Seqs[ rnd.below( sizeof Seqs / sizeof *Seqs ) ];
+}
+
+
+/******************************************
+ * Creates an input of one of several kinds
+ ******************************************/
+
+std::string
+generate( Random & rnd )
+{
+    std::string data;
+    std::size_t len = rnd.below( 4 ) ? 1 + rnd.below( 4096 )
+                                     : 1 + rnd.below( 200000 );
+
+    switch ( rnd.below( 8 ) )
+    {
+        case 0 :                         // random bytes
+            while ( data.size( ) < len )
+                data += static_cast< char >( rnd.next( ) );
+            break;
+
+        case 1 :                         // a single huge line
+            data.assign( 100000 + rnd.below( 10000 ), 'x' );
+            if ( rnd.below( 2 ) )
+                data += '\n';
+            break;
+
+        case 2 :                         // only tabs
+            data.assign( len, '\t' );
+            break;
+
+        case 3 :                         // only newlines
+            data.assign( len, '\n' );
+            break;
+
+        case 4 :                         // lots of escape sequences
+            while ( data.size( ) < len )
+                data += rnd.below( 2 ) ? random_escape( rnd ) : "text ";
+            break;
+
+        case 5 :                         // lots of UTF-8
+            while ( data.size( ) < len )
+                data += rnd.below( 30 ) ? random_utf8( rnd ) : "\n";
+            break;
+
+        case 6 :                         // carriage returns and backspaces
+            while ( data.size( ) < len )
+                data += "abc\r\b\x7f\n\r\n"[ rnd.below( 9 ) ];
+            break;
+
+        default :                        // a mixture of all of it
+            while ( data.size( ) < len )
+                switch ( rnd.below( 6 ) )
+                {
+                    case 0  : data += random_escape( rnd ); break;
+                    case 1  : data += random_utf8( rnd );   break;
+                    case 2  : data += '\t';                 break;
+                    case 3  : data += '\n';                 break;
+                    default : data += "word ";              break;
+                }
+    }
+
+    return data;
+}
+
+
+/******************************************
+ * Writes an input that failed to a file
+ ******************************************/
+
+void
+save_failure( std::string const & data )
+{
+    std::ofstream ofs( "pbterm_fuzz.fail", std::ios::binary );
+    ofs.write( data.data( ), data.size( ) );
+}
+
+
+/******************************************
+ * Runs on random inputs for the given time
+ ******************************************/
+
+int
+stress( unsigned long      seconds,
+        unsigned long long seed )
+{
+    std::printf( "Stress test for %lu s with seed %llu\n", seconds, seed );
+
+    Random rnd( seed );
+    std::time_t end = std::time( 0 ) + seconds;
+    unsigned long count = 0;
+    unsigned long long bytes = 0;
+
+    while ( std::time( 0 ) < end )
+    {
+        std::string data = generate( rnd );
+        unsigned long long input_seed = rnd.next( );
+        std::string err = check_input( data, input_seed );
+
+        count++;
+        bytes += data.size( );
+
+        if ( ! err.empty( ) )
+        {
+            save_failure( data );
+            std::printf( "Input %lu (%lu bytes, check seed %llu) failed:\n%s",
+                         count, static_cast< unsigned long >( data.size( ) ),
+                         input_seed, err.c_str( ) );
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::printf( "%lu inputs with %llu bytes ok\n", count, bytes );
+    return EXIT_SUCCESS;
+}
+
+
+/******************************************
+ * Checks each of the files with a few different seeds
+ ******************************************/
+
+int
+check_files( int     argc,
+             char ** argv )
+{
+    int result = EXIT_SUCCESS;
+
+    for ( int i = 1; i < argc; ++i )
+    {
+        std::ifstream ifs( argv[ i ], std::ios::binary );
+        if ( ! ifs )
+        {
+            std::perror( argv[ i ] );
+            result = EXIT_FAILURE;
+            continue;
+        }
+
+        std::ostringstream os;
+        os << ifs.rdbuf( );
+        std::string data = os.str( );
+
+        for ( unsigned long long seed = 1; seed <= 10; ++seed )
+        {
+            std::string err = check_input( data, seed );
+
+            if ( ! err.empty( ) )
+            {
+                std::printf( "%s (seed %llu) failed:\n%s", argv[ i ], seed,
+                             err.c_str( ) );
+                result = EXIT_FAILURE;
+                break;
+            }
+        }
+    }
+
+    return result;
+}
+
+#endif
+
+}   // unnamed namespace
+
+
+#if defined LIBFUZZER
+
+/******************************************
+ * Entry point for libFuzzer
+ ******************************************/
+
+extern "C"
+int
+LLVMFuzzerTestOneInput( unsigned char const * data,
+                        std::size_t           size )
+{
+    std::string input( reinterpret_cast< char const * >( data ), size );
+    std::string err = check_input( input, size + 1 );
+
+    if ( ! err.empty( ) )
+    {
+        std::fputs( err.c_str( ), stderr );
+        std::abort( );
+    }
+
+    return 0;
+}
+
+#else
+
+/******************************************
+ ******************************************/
+
+int
+main( int     argc,
+      char ** argv )
+{
+    if ( argc > 1 && ! std::strcmp( argv[ 1 ], "--stress" ) )
+        return stress( argc > 2 ? std::strtoul( argv[ 2 ], 0, 10 ) : 10,
+                       argc > 3 ? std::strtoull( argv[ 3 ], 0, 10 )
+                                : static_cast< unsigned long long >(
+                                                          std::time( 0 ) ) );
+
+    if ( argc < 2 || argv[ 1 ][ 0 ] == '-' )
+    {
+        std::fprintf( stderr, "Usage: %s file ...\n"
+                      "       %s --stress [seconds [seed]]\n",
+                      argv[ 0 ], argv[ 0 ] );
+        return EXIT_FAILURE;
+    }
+
+    return check_files( argc, argv );
+}
+
+#endif
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,386 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+/******************************************
+ * Micro-benchmarks for what's done with each line of output: expanding
+ * tabs when a line gets stored (Line::store_detabbed() via the Line
+ * constructor), storing it again when more text gets appended to an
+ * unfinished line (Line::append()) and calculating where it must be
+ * wrapped (Line::calc_break_pos()). Each is run for a range of line
+ * lengths, tab densities, font sizes and both orientations, using the
+ * headless libinkview whose StringWidth() is a cheap fake, so mostly
+ * the cost of the algorithms themselves gets measured.
+ *
+ * Usage: pbterm_line_bench [--min-time ms] [--char-widths] [filter]
+ *
+ * Each benchmark is repeated until it ran for at least the minimum time
+ * (default 100 ms). Only benchmarks whose name contains the filter text
+ * (e.g. 'wrap/' or 'landscape') get run. With '--char-widths' the width
+ * of text is calculated from a table of character widths (as pbterm does
+ * when it got one from the font) instead of by calling StringWidth().
+ *
+ * Besides the time per line it reports, per line, how often the width
+ * of (a part of) the text was requested, how many bytes got measured
+ * in total and how often StringWidth() was called. The latter numbers
+ * don't depend on the machine, so they are what to compare when trying
+ * to improve the algorithm for wrapping lines.
+ ******************************************/
+
+
+#include "Lines.hpp"
+#include "Headless.hpp"
+#include "Utils.hpp"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+
+
+namespace
+{
+
+// Size of the pieces lines get assembled from in the 'append' benchmark
+
+std::size_t const Chunk_Size = 64;
+
+
+// Parameters the benchmarks get run with
+
+std::size_t const Lengths[ ] = { 20, 80, 400, 4000 };
+int const Tab_Percentages[ ] = { 0, 5, 25 };
+int const Font_Sizes[ ]      = { 12, 24 };
+
+
+/******************************************
+ * Lines that count how often they get asked for the width of some text
+ * and how many bytes that involved - the Line class does all its
+ * measuring via the Lines object it belongs to
+ ******************************************/
+
+class Counting_Lines : public Lines
+{
+  public :
+
+    Counting_Lines( int font_size )
+        : Lines( font_size, 0, 8, 5, 5, 1000, 0, 0 )
+        , m_calls( 0 )
+        , m_bytes( 0 )
+    { }
+
+
+    int
+    width( std::string const & txt,
+           std::size_t         start,
+           std::size_t         len ) const
+    {
+        start = std::min( start, txt.size( ) );
+
+        ++m_calls;
+        m_bytes += std::min( len, txt.size( ) - start );
+        return text_width( txt, start, len );
+    }
+
+
+    void
+    reset_counts( )
+    {
+        m_calls = 0;
+        m_bytes = 0;
+    }
+
+
+    unsigned long long
+    calls( ) const  { return m_calls; }
+
+
+    unsigned long long
+    bytes( ) const  { return m_bytes; }
+
+
+  private :
+
+    mutable unsigned long long m_calls;
+    mutable unsigned long long m_bytes;
+};
+
+
+// What a benchmark is given to work on
+
+struct Setup
+{
+    Counting_Lines * lines;
+    std::string text;
+};
+
+
+/******************************************
+ * Creates a line of printable characters with the given percentage of
+ * tabs in it (at pseudo-random positions), spaces now and then
+ ******************************************/
+
+std::string
+make_text( std::size_t len,
+           int         tab_percentage )
+{
+    std::string txt;
+    unsigned int seed = len * 31 + tab_percentage;
+
+    while ( txt.size( ) < len )
+    {
+        seed = seed * 1103515245 + 12345;
+        unsigned int r = ( seed >> 16 ) % 100;
+
+        if ( static_cast< int >( r ) < tab_percentage )
+            txt += '\t';
+        else if ( r % 7 == 0 )
+            txt += ' ';
+        else
+            txt += static_cast< char >( 'a' + r % 26 );
+    }
+
+    return txt;
+}
+
+
+/******************************************
+ * Stores a line (expanding tabs and calculating the wrapping)
+ ******************************************/
+
+void
+bench_store( Setup & s )
+{
+    Line line( s.text, s.lines, 0 );
+}
+
+
+/******************************************
+ * Assembles a line from pieces, like output arriving from the shell
+ * in chunks without a newline in between
+ ******************************************/
+
+void
+bench_append( Setup & s )
+{
+    Line line( s.text.substr( 0, Chunk_Size ), s.lines, 0 );
+
+    for ( std::size_t pos = Chunk_Size; pos < s.text.size( );
+          pos += Chunk_Size )
+        line.append( s.text.substr( pos, Chunk_Size ) );
+}
+
+
+/******************************************
+ * Calculates where an already detabbed line needs to be wrapped
+ ******************************************/
+
+void
+bench_wrap( Setup & s )
+{
+    std::vector< std::size_t > break_pos;
+
+    Line::calc_break_pos( s.text, *s.lines, s.lines->screen_width( ),
+                          s.lines->continuation_symbol_width( ), break_pos );
+}
+
+
+// The benchmarks
+
+struct Benchmark
+{
+    char const * name;
+    void ( * run )( Setup & s );
+    bool needs_detabbed_text;
+};
+
+
+Benchmark const Benchmarks[ ] =
+{
+    { "store",  bench_store,  false },
+    { "append", bench_append, false },
+    { "wrap",   bench_wrap,   true  }
+};
+
+
+/******************************************
+ * Sets a font of the given size (the fake StringWidth() only depends on
+ * the size)
+ ******************************************/
+
+void
+set_font( int size )
+{
+    static ifont * font;
+
+    if ( font )
+        CloseFont( font );
+    font = OpenFont( "bench", size, 1 );
+    SetFont( font, BLACK );
+}
+
+
+/******************************************
+ * Runs a benchmark with one set of parameters and prints the results
+ ******************************************/
+
+void
+run( Benchmark const          & bench,
+     std::size_t                len,
+     int                        tab_percentage,
+     int                        font_size,
+     bool                       is_landscape,
+     bool                       use_char_widths,
+     unsigned long long         min_time,
+     std::string const        & filter )
+{
+    std::ostringstream name;
+
+    name << bench.name << "/len:" << len << "/tabs:" << tab_percentage
+         << "%/font:" << font_size
+         << ( is_landscape ? "/landscape" : "/portrait" );
+
+    if ( name.str( ).find( filter ) == std::string::npos )
+        return;
+
+    SetOrientation( is_landscape ? ROTATE90 : ROTATE0 );
+    set_font( font_size );
+
+    Counting_Lines lines( font_size );
+    std::vector< int > widths( 128, ( font_size * 3 + 2 ) / 5 );
+    if ( use_char_widths )
+        lines.set_char_widths( &widths );
+
+    Setup s;
+    s.lines = &lines;
+    s.text  = make_text( len, tab_percentage );
+
+    if ( bench.needs_detabbed_text )
+        s.text = Line( s.text, &lines, 0 ).text( );
+
+    // One run to warm up and for counting, the counts are the same for
+    // each run
+
+    lines.reset_counts( );
+    Headless::reset_stats( );
+    bench.run( s );
+
+    unsigned long long calls = lines.calls( );
+    unsigned long long bytes = lines.bytes( );
+    unsigned long string_widths = Headless::stats( ).string_width;
+
+    // Repeat, doubling the number of iterations, until it took long enough
+
+    unsigned long long iterations = 1;
+    unsigned long long elapsed;
+
+    while ( 1 )
+    {
+        unsigned long long start = Utils::microseconds( );
+
+        for ( unsigned long long i = 0; i < iterations; ++i )
+            bench.run( s );
+
+        elapsed = Utils::microseconds( ) - start;
+
+        if ( elapsed >= min_time || iterations >= 1ULL << 40 )
+            break;
+        iterations *= 2;
+    }
+
+    std::cout << std::left << std::setw( 42 ) << name.str( ) << std::right
+              << std::fixed << std::setprecision( 0 )
+              << std::setw( 11 ) << 1000.0 * elapsed / iterations
+              << std::setw( 10 ) << calls
+              << std::setw( 12 ) << bytes
+              << std::setw( 13 ) << string_widths
+              << std::setw( 12 ) << iterations << std::endl;
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+usage( char const * name )
+{
+    std::cerr << "Usage: " << name
+              << " [--min-time ms] [--char-widths] [filter]\n"
+                 "Benchmarks are named <function>/len:<bytes>/tabs:<percent>"
+                 "/font:<size>/<orientation>\nwith function one of 'store', "
+                 "'append' and 'wrap'\n";
+}
+
+}
+
+
+/******************************************
+ ******************************************/
+
+int
+main( int     argc,
+      char ** argv )
+{
+    unsigned long long min_time = 100000;
+    bool use_char_widths = false;
+    std::string filter;
+
+    for ( int i = 1; i < argc; ++i )
+    {
+        if ( ! std::strcmp( argv[ i ], "--min-time" ) && i + 1 < argc )
+            min_time = 1000ULL * std::strtoul( argv[ ++i ], 0, 10 );
+        else if ( ! std::strcmp( argv[ i ], "--char-widths" ) )
+            use_char_widths = true;
+        else if ( argv[ i ][ 0 ] != '-' && filter.empty( ) )
+            filter = argv[ i ];
+        else
+        {
+            usage( argv[ 0 ] );
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::cout << std::left << std::setw( 42 ) << "Benchmark" << std::right
+              << "    ns/line  widths/l    bytes/l  StringWidth/l"
+                 "  iterations\n";
+
+    for ( std::size_t b = 0; b < sizeof Benchmarks / sizeof *Benchmarks; ++b )
+        for ( std::size_t l = 0; l < sizeof Lengths / sizeof *Lengths; ++l )
+            for ( std::size_t t = 0;
+                  t < sizeof Tab_Percentages / sizeof *Tab_Percentages; ++t )
+                for ( std::size_t f = 0;
+                      f < sizeof Font_Sizes / sizeof *Font_Sizes; ++f )
+                    for ( int o = 0; o < 2; ++o )
+                        run( Benchmarks[ b ], Lengths[ l ],
+                             Tab_Percentages[ t ], Font_Sizes[ f ], o,
+                             use_char_widths, min_time, filter );
+
+    return EXIT_SUCCESS;
+}
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,214 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+/******************************************
+ * Checks that the Session_Recorder writes events so that they're read
+ * back unchanged, in particular when output ends in the middle of an
+ * UTF-8 sequence and input or a size change gets recorded before the
+ * rest of the sequence arrives, and that bytes not forming valid UTF-8
+ * (overlong forms, surrogates, code points above U+10FFFF) get replaced.
+ *
+ * Usage: pbterm_recorder_test [file]
+ *
+ * The recording is written to the file (default is a temporary file
+ * that gets removed afterwards). Returns 0 if all checks succeed.
+ ******************************************/
+
+
+#include "Session_Recorder.hpp"
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+
+
+namespace
+{
+
+struct Expected
+{
+    char type;
+    char const * data;
+};
+
+
+/******************************************
+ * Reads back a recording and compares the events with the expected ones
+ ******************************************/
+
+bool
+read_back( std::string const & file_name,
+           Expected const    * expected,
+           std::size_t         count )
+{
+    std::vector< Session_Recorder::Event > events;
+
+    if ( ! Session_Recorder::load( file_name, events ) )
+    {
+        std::fprintf( stderr, "Can't read back '%s'\n", file_name.c_str( ) );
+        return false;
+    }
+
+    bool ok = events.size( ) == count;
+    if ( ! ok )
+        std::fprintf( stderr, "Got %lu events instead of %lu\n",
+                      static_cast< unsigned long >( events.size( ) ),
+                      static_cast< unsigned long >( count ) );
+
+    for ( std::size_t i = 0; i < count && i < events.size( ); ++i )
+        if (    events[ i ].type != expected[ i ].type
+             || events[ i ].data != expected[ i ].data )
+        {
+            std::fprintf( stderr, "Event %lu is '%c' \"%s\" instead of "
+                          "'%c' \"%s\"\n", static_cast< unsigned long >( i ),
+                          events[ i ].type, events[ i ].data.c_str( ),
+                          expected[ i ].type, expected[ i ].data );
+            ok = false;
+        }
+
+    return ok;
+}
+
+
+/******************************************
+ * Records a sequence of events with output split in the middle of UTF-8
+ * sequences and checks what gets read back
+ ******************************************/
+
+bool
+check_split_output( std::string const & file_name )
+{
+    Session_Recorder rec;
+
+    if ( ! rec.open( file_name, 80, 24 ) )
+    {
+        std::fprintf( stderr, "Can't create '%s'\n", file_name.c_str( ) );
+        return false;
+    }
+
+    // "\xc3\xa9" is an 'e' with an acute accent, split over two outputs,
+    // with input shorter than the held back byte in between
+
+    rec.add( Session_Recorder::Output, "ab\xc3" );
+    rec.add( Session_Recorder::Input,  "ls\n" );
+    rec.add( Session_Recorder::Resize, "80x24" );
+    rec.add( Session_Recorder::Input,  "x" );
+    rec.add( Session_Recorder::Output, "\xa9" "cd" );
+    rec.add( Session_Recorder::Output, "\xe2\x82" );
+    rec.add( Session_Recorder::Input,  "\x03" );
+    rec.add( Session_Recorder::Output, "\xac" );
+    rec.close( );
+
+    Expected const expected[ ] = { { 'o', "ab" },
+                                   { 'i', "ls\n" },
+                                   { 'r', "80x24" },
+                                   { 'i', "x" },
+                                   { 'o', "\xc3\xa9" "cd" },
+                                   { 'i', "\x03" },
+                                   { 'o', "\xe2\x82\xac" } };
+
+    return read_back( file_name, expected,
+                      sizeof expected / sizeof *expected );
+}
+
+
+/******************************************
+ * Records output with invalid UTF-8 sequences, each of their bytes must
+ * come back as U+FFFD (while the largest valid code point is kept)
+ ******************************************/
+
+bool
+check_invalid_utf8( std::string const & file_name )
+{
+    Session_Recorder rec;
+
+    if ( ! rec.open( file_name, 80, 24 ) )
+    {
+        std::fprintf( stderr, "Can't create '%s'\n", file_name.c_str( ) );
+        return false;
+    }
+
+    rec.add( Session_Recorder::Output, "\xe0\x80\xaf" );
+    rec.add( Session_Recorder::Output, "\xf0\x8f\xbf\xbf" );
+    rec.add( Session_Recorder::Output, "\xed\xa0\x80" );
+    rec.add( Session_Recorder::Output, "\xf4\x90\x80\x80" );
+    rec.add( Session_Recorder::Output, "\xf4\x8f\xbf\xbf" );
+    rec.close( );
+
+#define FFFD "\xef\xbf\xbd"
+
+    Expected const expected[ ] = { { 'o', FFFD FFFD FFFD },
+                                   { 'o', FFFD FFFD FFFD FFFD },
+                                   { 'o', FFFD FFFD FFFD },
+                                   { 'o', FFFD FFFD FFFD FFFD },
+                                   { 'o', "\xf4\x8f\xbf\xbf" } };
+
+#undef FFFD
+
+    return read_back( file_name, expected,
+                      sizeof expected / sizeof *expected );
+}
+
+}
+
+
+/******************************************
+ ******************************************/
+
+int
+main( int    argc,
+      char * argv[ ] )
+{
+    std::string file_name;
+
+    if ( argc > 1 )
+        file_name = argv[ 1 ];
+    else
+    {
+        char tmp[ ] = "/tmp/pbterm_recorder_test.XXXXXX";
+        int fd = mkstemp( tmp );
+        if ( fd == -1 )
+        {
+            std::perror( "mkstemp" );
+            return 1;
+        }
+        close( fd );
+        file_name = tmp;
+    }
+
+    bool ok = check_split_output( file_name );
+    ok = check_invalid_utf8( file_name ) && ok;
+
+    if ( argc <= 1 )
+        unlink( file_name.c_str( ) );
+
+    std::printf( "%s\n", ok ? "OK" : "FAILED" );
+    return ok ? 0 : 1;
+}
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
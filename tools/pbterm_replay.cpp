@@ -0,0 +1,228 @@
+/*
+ *  Copyright (C) 2013 Jens Thoms Toerring <jt@toerring.de>
+ *
+ *  This file is part of the pbterm program.
+ *
+ *  pbterm is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  pbterm is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with pbterm.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/******************************************
+ * Replays a file with shell output captured by pbterm (see the
+ * 'capture_file' setting) on top of the headless libinkview backend.
+ * The chunks are passed to the Messenger in New_Text messages, just as
+ * the Term object does when it reads them from the shell, either with
+ * the original timing or, with '--fast', as quickly as possible (but
+ * still letting the event loop deliver everything that's due between
+ * chunks).
+ *
+ * Usage: pbterm_replay [--fast] [--dump file.pgm] capture_file
+ ******************************************/
+
+
+#include "Messenger.hpp"
+#include "Capture.hpp"
+#include "Headless.hpp"
+#include "Utils.hpp"
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+
+namespace
+{
+
+// Time the shell gets to print its prompt before the replay starts (in ms)
+
+int const Settle_Time = 500;
+
+
+// The one Messenger instance
+
+Messenger * s_mess;
+
+
+/******************************************
+ * Handler for libinkview events, like the one of pbterm itself
+ ******************************************/
+
+int
+replay_handler( int type,
+                int par1,
+                int par2 )
+{
+    switch ( type )
+    {
+        case EVT_INIT :
+            s_mess = new Messenger( );
+            return 1;
+
+        case EVT_EXIT :
+            delete s_mess;
+            s_mess = 0;
+            return 1;
+
+        default :
+            request::Handle_Event he( type, par1, par2 );
+            return s_mess->send( he ).result;
+    }
+
+    return 0;
+}
+
+
+/******************************************
+ * Keeps the event loop running until the given time (in microseconds),
+ * returns false if the application stopped
+ ******************************************/
+
+bool
+run_until( unsigned long long t )
+{
+    unsigned long long now;
+
+    while ( ( now = Utils::microseconds( ) ) < t )
+        if ( ! Headless::process( ( t - now + 999 ) / 1000 ) )
+            return false;
+
+    return true;
+}
+
+
+/******************************************
+ * Delivers everything that's due, returns false if the application
+ * stopped
+ ******************************************/
+
+bool
+run_due( )
+{
+    while ( Headless::has_due_events( ) )
+        if ( ! Headless::process( 0 ) )
+            return false;
+
+    return true;
+}
+
+
+/******************************************
+ ******************************************/
+
+void
+usage( char const * name )
+{
+    std::fprintf( stderr, "Usage: %s [--fast] [--dump file.pgm] "
+                  "capture_file\n", name );
+}
+
+}   // unnamed namespace
+
+
+/******************************************
+ ******************************************/
+
+int
+main( int     argc,
+      char ** argv )
+{
+    bool fast = false;
+    char const * dump = 0;
+    char const * name = 0;
+
+    for ( int i = 1; i < argc; ++i )
+    {
+        if ( ! std::strcmp( argv[ i ], "--fast" ) )
+            fast = true;
+        else if ( ! std::strcmp( argv[ i ], "--dump" ) && i + 1 < argc )
+            dump = argv[ ++i ];
+        else if ( ! name && argv[ i ][ 0 ] != '-' )
+            name = argv[ i ];
+        else
+        {
+            usage( argv[ 0 ] );
+            return EXIT_FAILURE;
+        }
+    }
+
+    if ( ! name )
+    {
+        usage( argv[ 0 ] );
+        return EXIT_FAILURE;
+    }
+
+    // Read in the whole capture before anything else happens (pbterm
+    // might be configured to write a capture itself)
+
+    std::vector< Capture::Chunk > chunks;
+
+    if ( ! Capture::load( name, chunks ) )
+    {
+        std::fprintf( stderr, "Can't read capture file '%s'\n", name );
+        return EXIT_FAILURE;
+    }
+
+    unsigned long long bytes = 0;
+    for ( std::size_t i = 0; i < chunks.size( ); ++i )
+        bytes += chunks[ i ].data.size( );
+
+    Headless::start( replay_handler );
+
+    bool ok =    s_mess
+              && run_until( Utils::microseconds( ) + Settle_Time * 1000ULL );
+
+    Headless::reset_stats( );
+    unsigned long long start = Utils::microseconds( );
+
+    for ( std::size_t i = 0; ok && i < chunks.size( ); ++i )
+    {
+        if ( ! fast )
+            ok = run_until( start + chunks[ i ].time );
+        if ( ok )
+            s_mess->send( message::New_Text( chunks[ i ].data ) );
+        ok = ok && run_due( );
+    }
+
+    double secs = ( Utils::microseconds( ) - start ) / 1.0e6;
+
+    if ( ! ok )
+        std::fprintf( stderr, "Application stopped during replay\n" );
+    else
+    {
+        std::printf( "%lu chunks, %llu bytes, recorded in %.3f s, replayed "
+                     "in %.3f s (%.2f MB/s, %.0f chunks/s)\n",
+                     static_cast< unsigned long >( chunks.size( ) ), bytes,
+                     chunks.empty( ) ? 0.0 : chunks.back( ).time / 1.0e6,
+                     secs, secs > 0 ? bytes / secs / 1.0e6 : 0.0,
+                     secs > 0 ? chunks.size( ) / secs : 0.0 );
+        Headless::print_stats( stdout );
+
+        if ( dump && ! Headless::dump_screen( dump ) )
+            std::fprintf( stderr, "Can't write '%s'\n", dump );
+    }
+
+    if ( s_mess )
+        Headless::finish( );
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+/*
+ * Local variables:
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */